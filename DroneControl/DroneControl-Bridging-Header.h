@@ -7,5 +7,6 @@
 #define DroneControl_Bridging_Header_h
 
 #include "common/mavlink.h"
+#include "mavlink_rate.h"
 
 #endif
@@ -201,11 +201,20 @@ class MAVLinkManager: ObservableObject, MAVLinkMessageHandler {
     private var connectionWatchdogTimer: Timer?
     private let connectionTimeout: TimeInterval = 5.0
     
+    // Telemetry rates are fitted to the slowest hop, the 57600 baud UART
+    // between the ESP32 bridge and the flight controller
+    private let linkCapacity: UInt32 = 57600 / 10  // bytes/s
+    private var rateController = mavlink_rate_ctrl_t()
+    private var rateControlActive = false
+    
     init(host: String = "192.168.4.1", port: UInt16 = 14550, localPort: UInt16 = 14550) {
         self.udpConnection = UDPConnection(host: host, port: port, localPort: localPort)
         self.mavlinkProtocol = MAVLinkProtocol()
         
         mavlinkProtocol.messageHandler = self
+        mavlinkProtocol.onMessage = { [weak self] msg in
+            self?.observeLinkTraffic(msg)
+        }
         
         udpConnection.onDataReceived = { [weak self] data in
             self?.mavlinkProtocol.parseData(data)
@@ -233,20 +242,55 @@ class MAVLinkManager: ObservableObject, MAVLinkMessageHandler {
     private func requestTelemetryMessages() {
         print("📡 Requesting telemetry messages...")
         
-        // Message ID -> Rate in microseconds (1000000 = 1Hz, 250000 = 4Hz, 100000 = 10Hz)
-        let messages: [(UInt32, Int32)] = [
-            (1, 500000),    // SYS_STATUS at 2Hz
-            (24, 200000),   // GPS_RAW_INT at 5Hz
-            (30, 100000),   // ATTITUDE at 10Hz
-            (33, 200000),   // GLOBAL_POSITION_INT at 5Hz
-            (36, 100000),   // SERVO_OUTPUT_RAW at 10Hz - ÖNEMLİ!
-            (74, 200000),   // VFR_HUD at 5Hz
-            (29, 500000),   // SCALED_PRESSURE at 2Hz
+        // Message ID -> wanted and slowest interval in microseconds (1000000 = 1Hz, 250000 = 4Hz,
+        // 100000 = 10Hz), priority. When the link fills up, higher priorities keep their rate longest.
+        let messages: [(UInt32, UInt32, UInt32, UInt8)] = [
+            (30, 100000, 250000, 200),    // ATTITUDE at 10Hz, at least 4Hz
+            (33, 200000, 500000, 200),    // GLOBAL_POSITION_INT at 5Hz, at least 2Hz
+            (1, 500000, 2000000, 100),    // SYS_STATUS at 2Hz
+            (24, 200000, 1000000, 100),   // GPS_RAW_INT at 5Hz
+            (74, 200000, 1000000, 100),   // VFR_HUD at 5Hz
+            (36, 100000, 1000000, 50),    // SERVO_OUTPUT_RAW at 10Hz - ÖNEMLİ!
+            (29, 500000, 2000000, 50),    // SCALED_PRESSURE at 2Hz
         ]
         
-        for (msgId, intervalUs) in messages {
-            setMessageInterval(messageId: msgId, intervalUs: intervalUs)
+        mavlink_rate_init(&rateController, linkCapacity, targetSystemID, targetComponentID, uptimeMs())
+        for (msgId, desiredUs, slowestUs, priority) in messages {
+            mavlink_rate_add_stream(&rateController, msgId, desiredUs, slowestUs, priority)
+        }
+        rateControlActive = true
+        sendRateRequests()
+    }
+    
+    // Measure throughput and loss from every received frame, and once a second
+    // re-request the intervals that no longer fit the link
+    private func observeLinkTraffic(_ message: mavlink_message_t) {
+        guard rateControlActive else { return }
+        
+        var msg = message
+        mavlink_rate_observe_msg(&rateController, &msg)
+        if mavlink_rate_update(&rateController, uptimeMs()) {
+            sendRateRequests()
+        }
+    }
+    
+    private func sendRateRequests() {
+        var msgId: UInt32 = 0
+        var intervalUs: UInt32 = 0
+        var requested = 0
+        
+        while mavlink_rate_next_request(&rateController, &msgId, &intervalUs) {
+            setMessageInterval(messageId: msgId, intervalUs: Int32(intervalUs))
+            requested += 1
         }
+        if requested > 0 {
+            print("📶 Link: \(rateController.throughput) B/s, loss \(String(format: "%.1f", rateController.loss * 100))%, " +
+                  "budget \(rateController.budget) B/s, \(requested) rate(s) changed")
+        }
+    }
+    
+    private func uptimeMs() -> UInt32 {
+        return UInt32(truncatingIfNeeded: Int64(ProcessInfo.processInfo.systemUptime * 1000))
     }
     
     private func setMessageInterval(messageId: UInt32, intervalUs: Int32) {
@@ -270,6 +314,7 @@ class MAVLinkManager: ObservableObject, MAVLinkMessageHandler {
     }
     
     func disconnect() {
+        rateControlActive = false
         stopHeartbeat()
         stopConnectionWatchdog()
         udpConnection.disconnect()
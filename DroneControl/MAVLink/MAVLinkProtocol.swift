@@ -46,6 +46,9 @@ class MAVLinkProtocol {
     // Handler delegate
     weak var messageHandler: MAVLinkMessageHandler?
     
+    // Called for every complete message before it is decoded
+    var onMessage: ((mavlink_message_t) -> Void)?
+    
     // Lock for thread safety
     private let parseLock = NSLock()
     
@@ -73,6 +76,7 @@ class MAVLinkProtocol {
             if mavlink_parse_char(UInt8(channel.rawValue), byte, &message, &status) != 0 {
                 // Complete message received
                 messagesReceived += 1
+                onMessage?(message)
                 processMessage(message)
             }
         }
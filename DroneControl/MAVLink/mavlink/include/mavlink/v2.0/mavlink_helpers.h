@@ -70,6 +70,23 @@ MAVLINK_HELPER void mavlink_reset_channel_status(uint8_t chan)
 	status->parse_state = MAVLINK_PARSE_STATE_IDLE;
 }
 
+#if !defined(MAVLINK_NO_SIGN_PACKET) || !defined(MAVLINK_NO_SIGNATURE_CHECK)
+/*
+  get the hashing state for the signing key, recomputing it when the
+  application has changed secret_key
+ */
+MAVLINK_HELPER const mavlink_sha256_key_state_t *_mav_signing_key_state(mavlink_signing_t *signing)
+{
+	if (!signing->key_state_valid ||
+	    memcmp(signing->key_state_key, signing->secret_key, sizeof(signing->secret_key)) != 0) {
+		mavlink_sha256_key_init(&signing->key_state, signing->secret_key);
+		memcpy(signing->key_state_key, signing->secret_key, sizeof(signing->secret_key));
+		signing->key_state_valid = true;
+	}
+	return &signing->key_state;
+}
+#endif
+
 #ifndef MAVLINK_NO_SIGN_PACKET
 /**
  * @brief create a signature block for a packet
@@ -80,11 +97,12 @@ MAVLINK_HELPER uint8_t mavlink_sign_packet(mavlink_signing_t *signing,
 					   const uint8_t *packet, uint8_t packet_len,
 					   const uint8_t crc[2])
 {
-	mavlink_sha256_ctx ctx;
 	union {
 	    uint64_t t64;
 	    uint8_t t8[8];
 	} tstamp;
+	uint8_t buf[MAVLINK_NUM_HEADER_BYTES + MAVLINK_MAX_PAYLOAD_LEN + MAVLINK_NUM_CHECKSUM_BYTES + 7];
+	uint16_t len = 0;
 	if (signing == NULL || !(signing->flags & MAVLINK_SIGNING_FLAG_SIGN_OUTGOING)) {
 	    return 0;
 	}
@@ -93,13 +111,16 @@ MAVLINK_HELPER uint8_t mavlink_sign_packet(mavlink_signing_t *signing,
 	memcpy(&signature[1], tstamp.t8, 6);
 	signing->timestamp++;
 	
-	mavlink_sha256_init(&ctx);
-	mavlink_sha256_update(&ctx, signing->secret_key, sizeof(signing->secret_key));
-	mavlink_sha256_update(&ctx, header, header_len);
-	mavlink_sha256_update(&ctx, packet, packet_len);
-	mavlink_sha256_update(&ctx, crc, 2);
-	mavlink_sha256_update(&ctx, signature, 7);
-	mavlink_sha256_final_48(&ctx, &signature[7]);
+	// the key is hashed from its cached state, the rest in one pass
+	memcpy(&buf[len], header, header_len);
+	len += header_len;
+	memcpy(&buf[len], packet, packet_len);
+	len += packet_len;
+	memcpy(&buf[len], crc, 2);
+	len += 2;
+	memcpy(&buf[len], signature, 7);
+	len += 7;
+	mavlink_sha256_key_48(_mav_signing_key_state(signing), buf, len, &signature[7]);
 	
 	return MAVLINK_SIGNATURE_BLOCK_LEN;
 }
@@ -122,40 +143,187 @@ MAVLINK_HELPER uint8_t _mav_trim_payload(const char *payload, uint8_t length)
 
 #ifndef MAVLINK_NO_SIGNATURE_CHECK
 /**
- * @brief check a signature block for a packet
+ * @brief Set up a hash table of signing streams in user supplied slots
+ *
+ * Attach it with signing_streams->table = table. Up to 3/4 of the slots
+ * are used, streams that have been quiet for longer than
+ * MAVLINK_SIGNING_TIMESTAMP_LIMIT are dropped when the table fills up.
+ *
+ * @param slots storage for the table
+ * @param num_slots number of slots, rounded down to a power of two
  */
-MAVLINK_HELPER bool mavlink_signature_check(mavlink_signing_t *signing,
-					    mavlink_signing_streams_t *signing_streams,
-					    const mavlink_message_t *msg)
+MAVLINK_HELPER void mavlink_signing_stream_table_init(mavlink_signing_stream_table_t *table,
+						      mavlink_signing_stream_slot_t *slots, uint32_t num_slots)
 {
-	if (signing == NULL) {
-		return true;
+	uint32_t size = 1;
+	while (size <= num_slots / 2) {
+		size *= 2;
 	}
-        const uint8_t *p = (const uint8_t *)&msg->magic;
-	const uint8_t *psig = msg->signature;
-        const uint8_t *incoming_signature = psig+7;
-	mavlink_sha256_ctx ctx;
-	uint8_t signature[6];
+	memset(table, 0, sizeof(*table));
+	memset(slots, 0, size * sizeof(*slots));
+	table->slots = slots;
+	table->mask = size - 1;
+}
+
+MAVLINK_HELPER uint32_t _mav_signing_stream_hash(const mavlink_signing_stream_table_t *table, uint32_t key)
+{
+	uint32_t h = key * 2654435761U;
+	return (h ^ (h >> 15)) & table->mask;
+}
+
+/*
+  slot holding key, or the empty slot where it would go
+ */
+MAVLINK_HELPER mavlink_signing_stream_slot_t *_mav_signing_stream_slot(mavlink_signing_stream_table_t *table, uint32_t key)
+{
+	uint32_t i = _mav_signing_stream_hash(table, key);
+	while (table->slots[i].key != key && table->slots[i].key != 0) {
+		i = (i + 1) & table->mask;
+	}
+	return &table->slots[i];
+}
+
+/*
+  empty slot i, moving later entries of the same probe run back so they
+  can still be found
+ */
+MAVLINK_HELPER void _mav_signing_stream_remove(mavlink_signing_stream_table_t *table, uint32_t i)
+{
+	uint32_t j = i;
+	for (;;) {
+		uint32_t home;
+		j = (j + 1) & table->mask;
+		if (table->slots[j].key == 0) {
+			break;
+		}
+		home = _mav_signing_stream_hash(table, table->slots[j].key);
+		// entry j stays if its home slot lies cyclically in (i, j]
+		if (((j - home) & table->mask) >= ((j - i) & table->mask)) {
+			table->slots[i] = table->slots[j];
+			i = j;
+		}
+	}
+	table->slots[i].key = 0;
+	table->count--;
+}
+
+/**
+ * @brief Drop streams whose last timestamp is older than
+ * MAVLINK_SIGNING_TIMESTAMP_LIMIT before now
+ *
+ * A replayed packet of a dropped stream is still rejected, because a new
+ * stream is only accepted with a timestamp inside that limit.
+ *
+ * @param now current signing timestamp, e.g. signing->timestamp
+ * @return number of streams dropped
+ */
+MAVLINK_HELPER uint32_t mavlink_signing_stream_table_expire(mavlink_signing_stream_table_t *table, uint64_t now)
+{
+	uint32_t dropped = 0;
+	uint32_t i = 0;
+	table->last_expire = now;
+	while (i <= table->mask) {
+		union {
+		    uint64_t t64;
+		    uint8_t t8[8];
+		} last;
+		last.t64 = 0;
+		memcpy(last.t8, table->slots[i].timestamp_bytes, 6);
+		if (table->slots[i].key != 0 &&
+		    last.t64 + MAVLINK_SIGNING_TIMESTAMP_LIMIT*100000UL < now) {
+			// an entry from further on may have moved into i, look again
+			_mav_signing_stream_remove(table, i);
+			dropped++;
+		} else {
+			i++;
+		}
+	}
+	table->evicted += dropped;
+	return dropped;
+}
+
+/*
+  timestamp of an existing stream, or NULL
+ */
+MAVLINK_HELPER uint8_t *_mav_signing_stream_find(mavlink_signing_streams_t *signing_streams,
+						 uint8_t sysid, uint8_t compid, uint8_t link_id)
+{
 	uint16_t i;
-        
-	mavlink_sha256_init(&ctx);
-	mavlink_sha256_update(&ctx, signing->secret_key, sizeof(signing->secret_key));
-	mavlink_sha256_update(&ctx, p, MAVLINK_NUM_HEADER_BYTES);
-	mavlink_sha256_update(&ctx, _MAV_PAYLOAD(msg), msg->len);
-	mavlink_sha256_update(&ctx, msg->ck, 2);
-	mavlink_sha256_update(&ctx, psig, 1+6);
-	mavlink_sha256_final_48(&ctx, signature);
-        if (memcmp(signature, incoming_signature, 6) != 0) {
-                signing->last_status = MAVLINK_SIGNING_STATUS_BAD_SIGNATURE;
-		return false;
+	if (signing_streams->table != NULL) {
+		const uint32_t key = (1UL<<24) | ((uint32_t)link_id<<16) | ((uint32_t)sysid<<8) | compid;
+		mavlink_signing_stream_slot_t *slot = _mav_signing_stream_slot(signing_streams->table, key);
+		return slot->key != 0 ? slot->timestamp_bytes : NULL;
+	}
+	for (i=0; i<signing_streams->num_signing_streams; i++) {
+		if (sysid == signing_streams->stream[i].sysid &&
+		    compid == signing_streams->stream[i].compid &&
+		    link_id == signing_streams->stream[i].link_id) {
+			return signing_streams->stream[i].timestamp_bytes;
+		}
 	}
+	return NULL;
+}
 
-	// now check timestamp
+/*
+  check there is room for another stream, dropping stale streams from a
+  table at most once a second
+ */
+MAVLINK_HELPER bool _mav_signing_stream_room(const mavlink_signing_t *signing,
+					     mavlink_signing_streams_t *signing_streams)
+{
+	mavlink_signing_stream_table_t *table = signing_streams->table;
+	if (table == NULL) {
+		return signing_streams->num_signing_streams < MAVLINK_MAX_SIGNING_STREAMS;
+	}
+	// keep at least one slot empty so lookups terminate
+	const uint32_t max_count = (table->mask + 1) - (table->mask + 1 + 3) / 4;
+	if (table->count < max_count) {
+		return true;
+	}
+	if (signing->timestamp >= table->last_expire + 100000UL) {
+		mavlink_signing_stream_table_expire(table, signing->timestamp);
+	}
+	return table->count < max_count;
+}
+
+/*
+  add a stream, after _mav_signing_stream_room(). Returns its timestamp
+ */
+MAVLINK_HELPER uint8_t *_mav_signing_stream_add(mavlink_signing_streams_t *signing_streams,
+						uint8_t sysid, uint8_t compid, uint8_t link_id)
+{
+	if (signing_streams->table != NULL) {
+		const uint32_t key = (1UL<<24) | ((uint32_t)link_id<<16) | ((uint32_t)sysid<<8) | compid;
+		mavlink_signing_stream_slot_t *slot = _mav_signing_stream_slot(signing_streams->table, key);
+		slot->key = key;
+		signing_streams->table->count++;
+		return slot->timestamp_bytes;
+	}
+	const uint16_t i = signing_streams->num_signing_streams++;
+	signing_streams->stream[i].sysid = sysid;
+	signing_streams->stream[i].compid = compid;
+	signing_streams->stream[i].link_id = link_id;
+	return signing_streams->stream[i].timestamp_bytes;
+}
+
+/**
+ * @brief timestamp and stream checks for a packet whose signature hash matched
+ *
+ * @param sysid sending system
+ * @param compid sending component
+ * @param psig the signature block
+ */
+MAVLINK_HELPER bool _mav_signature_check_replay(mavlink_signing_t *signing,
+						mavlink_signing_streams_t *signing_streams,
+						uint8_t sysid, uint8_t compid,
+						const uint8_t *psig)
+{
 	union tstamp {
 	    uint64_t t64;
 	    uint8_t t8[8];
 	} tstamp;
 	uint8_t link_id = psig[0];
+	uint8_t *stream_tstamp;
 	tstamp.t64 = 0;
 	memcpy(tstamp.t8, psig+1, 6);
 
@@ -165,15 +333,9 @@ MAVLINK_HELPER bool mavlink_signature_check(mavlink_signing_t *signing,
 	}
 	
 	// find stream
-	for (i=0; i<signing_streams->num_signing_streams; i++) {
-		if (msg->sysid == signing_streams->stream[i].sysid &&
-		    msg->compid == signing_streams->stream[i].compid &&
-		    link_id == signing_streams->stream[i].link_id) {
-			break;
-		}
-	}
-	if (i == signing_streams->num_signing_streams) {
-		if (signing_streams->num_signing_streams >= MAVLINK_MAX_SIGNING_STREAMS) {
+	stream_tstamp = _mav_signing_stream_find(signing_streams, sysid, compid, link_id);
+	if (stream_tstamp == NULL) {
+		if (!_mav_signing_stream_room(signing, signing_streams)) {
 			// over max number of streams
                         signing->last_status = MAVLINK_SIGNING_STATUS_TOO_MANY_STREAMS;
                         return false;
@@ -184,14 +346,11 @@ MAVLINK_HELPER bool mavlink_signature_check(mavlink_signing_t *signing,
                         return false;
 		}
 		// add new stream
-		signing_streams->stream[i].sysid = msg->sysid;
-		signing_streams->stream[i].compid = msg->compid;
-		signing_streams->stream[i].link_id = link_id;
-		signing_streams->num_signing_streams++;
+		stream_tstamp = _mav_signing_stream_add(signing_streams, sysid, compid, link_id);
 	} else {
 		union tstamp last_tstamp;
 		last_tstamp.t64 = 0;
-		memcpy(last_tstamp.t8, signing_streams->stream[i].timestamp_bytes, 6);
+		memcpy(last_tstamp.t8, stream_tstamp, 6);
 		if (tstamp.t64 <= last_tstamp.t64) {
 			// repeating old timestamp
                         signing->last_status = MAVLINK_SIGNING_STATUS_REPLAY;
@@ -200,7 +359,7 @@ MAVLINK_HELPER bool mavlink_signature_check(mavlink_signing_t *signing,
 	}
 
 	// remember last timestamp
-	memcpy(signing_streams->stream[i].timestamp_bytes, psig+1, 6);
+	memcpy(stream_tstamp, psig+1, 6);
 
 	// our next timestamp must be at least this timestamp
 	if (tstamp.t64 > signing->timestamp) {
@@ -209,6 +368,60 @@ MAVLINK_HELPER bool mavlink_signature_check(mavlink_signing_t *signing,
         signing->last_status = MAVLINK_SIGNING_STATUS_OK;
         return true;
 }
+
+/**
+ * @brief check a signature block for a packet given as its parts
+ *
+ * @param header the MAVLINK_NUM_HEADER_BYTES header bytes, starting with the magic marker
+ * @param payload payload bytes as sent
+ * @param len payload length
+ * @param ck the two checksum bytes
+ * @param psig the signature block
+ */
+MAVLINK_HELPER bool _mav_signature_check_parts(mavlink_signing_t *signing,
+					       mavlink_signing_streams_t *signing_streams,
+					       const uint8_t *header,
+					       const uint8_t *payload, uint8_t len,
+					       const uint8_t *ck, const uint8_t *psig)
+{
+	if (signing == NULL) {
+		return true;
+	}
+        const uint8_t *incoming_signature = psig+7;
+	uint8_t signature[6];
+	const uint16_t signed_len = MAVLINK_NUM_HEADER_BYTES + len + MAVLINK_NUM_CHECKSUM_BYTES + 7;
+
+	if (payload == header + MAVLINK_NUM_HEADER_BYTES && ck == payload + len &&
+	    psig == ck + MAVLINK_NUM_CHECKSUM_BYTES) {
+		// a frame straight from the receive buffer
+		mavlink_sha256_key_48(_mav_signing_key_state(signing), header, signed_len, signature);
+	} else {
+		uint8_t buf[MAVLINK_NUM_HEADER_BYTES + MAVLINK_MAX_PAYLOAD_LEN + MAVLINK_NUM_CHECKSUM_BYTES + 7];
+		memcpy(buf, header, MAVLINK_NUM_HEADER_BYTES);
+		memcpy(&buf[MAVLINK_NUM_HEADER_BYTES], payload, len);
+		memcpy(&buf[MAVLINK_NUM_HEADER_BYTES + len], ck, MAVLINK_NUM_CHECKSUM_BYTES);
+		memcpy(&buf[MAVLINK_NUM_HEADER_BYTES + len + MAVLINK_NUM_CHECKSUM_BYTES], psig, 7);
+		mavlink_sha256_key_48(_mav_signing_key_state(signing), buf, signed_len, signature);
+	}
+        if (memcmp(signature, incoming_signature, 6) != 0) {
+                signing->last_status = MAVLINK_SIGNING_STATUS_BAD_SIGNATURE;
+		return false;
+	}
+
+	return _mav_signature_check_replay(signing, signing_streams, header[5], header[6], psig);
+}
+
+/**
+ * @brief check a signature block for a packet
+ */
+MAVLINK_HELPER bool mavlink_signature_check(mavlink_signing_t *signing,
+					    mavlink_signing_streams_t *signing_streams,
+					    const mavlink_message_t *msg)
+{
+	return _mav_signature_check_parts(signing, signing_streams, (const uint8_t *)&msg->magic,
+					  (const uint8_t *)_MAV_PAYLOAD(msg), msg->len,
+					  msg->ck, msg->signature);
+}
 #endif
 
 
@@ -300,6 +513,94 @@ MAVLINK_HELPER uint16_t mavlink_finalize_message_chan(mavlink_message_t* msg, ui
 	return mavlink_finalize_message_buffer(msg, system_id, component_id, status, min_length, length, crc_extra);
 }
 
+/**
+ * @brief Finalize a message straight into a send buffer
+ *
+ * Does the work of mavlink_finalize_message_buffer() followed by
+ * mavlink_msg_to_send_buffer() without going through a mavlink_message_t.
+ * The header is written first, the payload is copied behind it while the
+ * CRC runs over it, then the checksum and signature follow. The CRC covers
+ * the length byte before the payload, so the trimmed length is found
+ * first, which only looks at the trailing zero bytes.
+ *
+ * @param buf at least MAVLINK_NUM_NON_PAYLOAD_BYTES + length + MAVLINK_SIGNATURE_BLOCK_LEN bytes
+ * @param status sequence number, MAVLink 1 flag and signing to use
+ * @param msgid message ID
+ * @param packet payload in wire format, e.g. the buffer built by the generated
+ * pack functions. On little endian hosts the message struct can be used as is,
+ * see MAVLINK_MSG_STRUCT_TO_SEND_BUFFER()
+ * @return length of the frame in buf
+ */
+MAVLINK_HELPER uint16_t mavlink_finalize_message_to_send_buffer(uint8_t *buf, mavlink_status_t* status,
+								uint8_t system_id, uint8_t component_id,
+								uint32_t msgid, const char *packet,
+								uint8_t min_length, uint8_t length, uint8_t crc_extra)
+{
+	bool mavlink1 = (status->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1) != 0;
+#ifndef MAVLINK_NO_SIGN_PACKET
+	bool signing = 	(!mavlink1) && status->signing && (status->signing->flags & MAVLINK_SIGNING_FLAG_SIGN_OUTGOING);
+#else
+	bool signing = false;
+#endif
+	uint8_t header_len;
+	uint8_t len = mavlink1?min_length:_mav_trim_payload(packet, length);
+	uint8_t *ck;
+
+	buf[1] = len;
+	if (mavlink1) {
+		header_len = MAVLINK_CORE_HEADER_MAVLINK1_LEN+1;
+		buf[0] = MAVLINK_STX_MAVLINK1;
+		buf[2] = status->current_tx_seq;
+		buf[3] = system_id;
+		buf[4] = component_id;
+		buf[5] = msgid & 0xFF;
+	} else {
+		header_len = MAVLINK_CORE_HEADER_LEN+1;
+		buf[0] = MAVLINK_STX;
+		buf[2] = signing ? MAVLINK_IFLAG_SIGNED : 0;
+		buf[3] = 0;
+		buf[4] = status->current_tx_seq;
+		buf[5] = system_id;
+		buf[6] = component_id;
+		buf[7] = msgid & 0xFF;
+		buf[8] = (msgid >> 8) & 0xFF;
+		buf[9] = (msgid >> 16) & 0xFF;
+	}
+	status->current_tx_seq = status->current_tx_seq + 1;
+
+	uint16_t checksum = crc_calculate(&buf[1], header_len-1);
+	checksum = crc_accumulate_copy(checksum, &buf[header_len], (const uint8_t *)packet, len);
+	crc_accumulate(crc_extra, &checksum);
+	ck = &buf[header_len + len];
+	ck[0] = (uint8_t)(checksum & 0xFF);
+	ck[1] = (uint8_t)(checksum >> 8);
+
+#ifndef MAVLINK_NO_SIGN_PACKET
+	if (signing) {
+		mavlink_sign_packet(status->signing, &ck[2],
+				    buf, header_len,
+				    &buf[header_len], len,
+				    ck);
+		return header_len + len + 2 + MAVLINK_SIGNATURE_BLOCK_LEN;
+	}
+#endif
+	return header_len + len + 2;
+}
+
+#if !MAVLINK_NEED_BYTE_SWAP
+/*
+  finalize a message struct straight into a send buffer. The generated
+  structs have their fields in wire order, so without byte swapping the
+  struct is the payload, e.g.
+    len = MAVLINK_MSG_STRUCT_TO_SEND_BUFFER(buf, status, 1, 1, HEARTBEAT, &heartbeat);
+ */
+#define MAVLINK_MSG_STRUCT_TO_SEND_BUFFER(buf, status, system_id, component_id, NAME, s) \
+	mavlink_finalize_message_to_send_buffer(buf, status, system_id, component_id, \
+						MAVLINK_MSG_ID_##NAME, (const char *)(s), \
+						MAVLINK_MSG_ID_##NAME##_MIN_LEN, MAVLINK_MSG_ID_##NAME##_LEN, \
+						MAVLINK_MSG_ID_##NAME##_CRC)
+#endif
+
 /**
  * @brief Finalize a MAVLink message with MAVLINK_COMM_0 as default channel
  */
@@ -312,6 +613,7 @@ MAVLINK_HELPER uint16_t mavlink_finalize_message(mavlink_message_t* msg, uint8_t
 static inline void _mav_parse_error(mavlink_status_t *status)
 {
     status->parse_error++;
+    status->frames_rejected++;
 }
 
 #ifdef MAVLINK_USE_CONVENIENCE_FUNCTIONS
@@ -515,6 +817,167 @@ MAVLINK_HELPER void mavlink_update_checksum(mavlink_message_t* msg, uint8_t c)
 	msg->checksum = checksum;
 }
 
+/*
+  count the set bits in a 64 bit word
+*/
+static inline uint8_t _mav_popcount64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (uint8_t)__builtin_popcountll(v);
+#else
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (uint8_t)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * @brief Set up a table for per (sysid, compid) sequence accounting
+ *
+ * Attach it with status->seq_table = table, every good frame is then
+ * counted with mavlink_seq_table_update(). Up to 3/4 of the streams are
+ * used, frames of further new streams are only counted in untracked.
+ *
+ * @param streams storage for the table
+ * @param num_streams number of streams, rounded down to a power of two
+ */
+MAVLINK_HELPER void mavlink_seq_table_init(mavlink_seq_table_t *table,
+					   mavlink_seq_stream_t *streams, uint32_t num_streams)
+{
+	uint32_t size = 1;
+	while (size <= num_streams / 2) {
+		size *= 2;
+	}
+	memset(table, 0, sizeof(*table));
+	memset(streams, 0, size * sizeof(*streams));
+	table->streams = streams;
+	table->mask = size - 1;
+}
+
+/*
+  stream of key, or the empty stream where it would go
+ */
+MAVLINK_HELPER mavlink_seq_stream_t *_mav_seq_stream_slot(const mavlink_seq_table_t *table, uint32_t key)
+{
+	uint32_t h = key * 2654435761U;
+	uint32_t i = (h ^ (h >> 15)) & table->mask;
+	while (table->streams[i].key != key && table->streams[i].key != 0) {
+		i = (i + 1) & table->mask;
+	}
+	return &table->streams[i];
+}
+
+/**
+ * @brief Accounting of one stream, NULL if no frame of it was counted
+ */
+MAVLINK_HELPER const mavlink_seq_stream_t *mavlink_seq_table_find(const mavlink_seq_table_t *table,
+								   uint8_t sysid, uint8_t compid)
+{
+	const mavlink_seq_stream_t *stream = _mav_seq_stream_slot(table, (1U<<16) | (sysid<<8) | compid);
+	return stream->key != 0 ? stream : NULL;
+}
+
+/*
+  age the history by n sequence numbers
+ */
+MAVLINK_HELPER void _mav_seq_history_shift(uint64_t history[2], uint8_t n)
+{
+	if (n >= 128) {
+		history[0] = history[1] = 0;
+	} else if (n >= 64) {
+		history[1] = history[0] << (n - 64);
+		history[0] = 0;
+	} else if (n > 0) {
+		history[1] = (history[1] << n) | (history[0] >> (64 - n));
+		history[0] <<= n;
+	}
+}
+
+/*
+  count one frame of a stream. Sequence numbers up to 127 ahead of the
+  highest one seen are taken as new, skipping some counts them as lost.
+  Older ones within the history either fill a gap (reordered, no longer
+  lost) or were already received (duplicate). Anything older cannot be
+  placed, e.g. after the sender restarted, and the stream starts over
+  from this frame.
+ */
+MAVLINK_HELPER void _mav_seq_stream_update(mavlink_seq_stream_t *stream, uint8_t seq)
+{
+	uint8_t ahead = (uint8_t)(seq - stream->last_seq);
+	uint8_t behind = (uint8_t)(stream->last_seq - seq);
+
+	if (stream->span != 0 && ahead == 0) {
+		stream->duplicate++;
+		return;
+	}
+	if (stream->span != 0 && ahead < 128) {
+		stream->lost += ahead - 1U;
+		_mav_seq_history_shift(stream->history, ahead);
+		stream->history[0] |= 1;
+		stream->last_seq = seq;
+		stream->span = (uint8_t)(stream->span + ahead > 128 ? 128 : stream->span + ahead);
+		stream->received++;
+		return;
+	}
+	if (stream->span != 0 && behind < stream->span) {
+		uint64_t *word = &stream->history[behind >> 6];
+		uint64_t bit = 1ULL << (behind & 63);
+		if (*word & bit) {
+			stream->duplicate++;
+		} else {
+			*word |= bit;
+			stream->reordered++;
+			stream->lost--;
+			stream->received++;
+		}
+		return;
+	}
+	stream->history[0] = 1;
+	stream->history[1] = 0;
+	stream->last_seq = seq;
+	stream->span = 1;
+	stream->received++;
+}
+
+/**
+ * @brief Count a good frame in its (sysid, compid) stream
+ *
+ * Called by the parsers for each good frame if status->seq_table is set.
+ */
+MAVLINK_HELPER void mavlink_seq_table_update(mavlink_seq_table_t *table, uint8_t sysid, uint8_t compid, uint8_t seq)
+{
+	const uint32_t key = (1U<<16) | (sysid<<8) | compid;
+	mavlink_seq_stream_t *stream = _mav_seq_stream_slot(table, key);
+	if (stream->key == 0) {
+		const uint32_t size = table->mask + 1;
+		if (table->count >= size - (size + 3) / 4) {
+			table->untracked++;
+			return;
+		}
+		memset(stream, 0, sizeof(*stream));
+		stream->key = key;
+		table->count++;
+	}
+	_mav_seq_stream_update(stream, seq);
+}
+
+/**
+ * @brief Share of the last (up to 128) sequence numbers of a stream that
+ * were not received, 0..1
+ *
+ * Frames still in flight out of order count as lost until they arrive.
+ */
+MAVLINK_HELPER float mavlink_seq_stream_loss_rate(const mavlink_seq_stream_t *stream)
+{
+	uint8_t received;
+	if (stream->span == 0) {
+		return 0.0f;
+	}
+	received = (uint8_t)(_mav_popcount64(stream->history[0]) + _mav_popcount64(stream->history[1]));
+	return (float)(stream->span - received) / (float)stream->span;
+}
+
 /*
   return the crc_entry value for a msgid
 */
@@ -522,8 +985,30 @@ MAVLINK_HELPER void mavlink_update_checksum(mavlink_message_t* msg, uint8_t c)
 MAVLINK_HELPER const mavlink_msg_entry_t *mavlink_get_msg_entry(uint32_t msgid)
 {
 	static const mavlink_msg_entry_t mavlink_message_crcs[] = MAVLINK_MESSAGE_CRCS;
+#ifdef MAVLINK_MESSAGE_CRC_PAGES
+	/*
+	  msgids below 65536 are looked up directly: the page map gives the
+	  rank index of the 256 msgid page, and counting the bits below the
+	  msgid in that page gives its position in the sorted table
+	*/
+	static const uint8_t mavlink_message_crc_pages[256] = MAVLINK_MESSAGE_CRC_PAGES;
+	static const mavlink_msg_entry_page_t mavlink_message_crc_page_index[] = MAVLINK_MESSAGE_CRC_PAGE_INDEX;
+	if (msgid < 65536) {
+		const uint8_t page = mavlink_message_crc_pages[msgid >> 8];
+		if (page == 0) {
+			return NULL;
+		}
+		const mavlink_msg_entry_page_t *p = &mavlink_message_crc_page_index[page-1];
+		const uint8_t w = (msgid >> 6) & 3;
+		const uint64_t bit = 1ULL << (msgid & 63);
+		if ((p->bits[w] & bit) == 0) {
+			return NULL;
+		}
+		return &mavlink_message_crcs[p->base[w] + _mav_popcount64(p->bits[w] & (bit - 1))];
+	}
+#endif
         /*
-	  use a bisection search to find the right entry. A perfect hash may be better
+	  use a bisection search to find the right entry.
 	  Note that this assumes the table is sorted by msgid
 	*/
         uint32_t low=0, high=sizeof(mavlink_message_crcs)/sizeof(mavlink_message_crcs[0]) - 1;
@@ -840,11 +1325,10 @@ MAVLINK_HELPER uint8_t mavlink_frame_char_buffer(mavlink_message_t* rxmsg,
 	// If a message has been successfully decoded, check index
 	if (status->msg_received == MAVLINK_FRAMING_OK)
 	{
-		//while(status->current_seq != rxmsg->seq)
-		//{
-		//	status->packet_rx_drop_count++;
-		//               status->current_seq++;
-		//}
+		// sequence gaps only mean something per (sysid, compid) stream
+		if (status->seq_table != NULL) {
+			mavlink_seq_table_update(status->seq_table, rxmsg->sysid, rxmsg->compid, rxmsg->seq);
+		}
 		status->current_rx_seq = rxmsg->seq;
 		// Initial condition: If no packet has been received so far, drop count is undefined
 		if (status->packet_rx_success_count == 0) status->packet_rx_drop_count = 0;
@@ -1023,6 +1507,428 @@ MAVLINK_HELPER uint8_t mavlink_parse_char(uint8_t chan, uint8_t c, mavlink_messa
     return msg_received;
 }
 
+/**
+ * @brief Get the zero-extended payload of a frame view
+ *
+ * Generated decoders expect payloads to be at least max_msg_len bytes long,
+ * with truncated trailing zeros restored. If the frame was sent untruncated
+ * this is the received payload itself, otherwise it is zero-extended into
+ * the parser's message buffer on the first call. Messages not in the
+ * dialect (view->entry NULL) have no known length and get the received
+ * payload as is.
+ */
+MAVLINK_HELPER const char *mavlink_frame_view_payload(mavlink_frame_view_t *view)
+{
+	if (view->scratch_valid) {
+		return _MAV_PAYLOAD(view->scratch);
+	}
+	if (view->entry == NULL || view->len >= view->entry->max_msg_len) {
+		return (const char *)view->payload;
+	}
+	memcpy(_MAV_PAYLOAD_NON_CONST(view->scratch), view->payload, view->len);
+	memset(&_MAV_PAYLOAD_NON_CONST(view->scratch)[view->len], 0, view->entry->max_msg_len - view->len);
+	view->scratch_valid = true;
+	return _MAV_PAYLOAD(view->scratch);
+}
+
+/**
+ * @brief Copy a frame view into a mavlink_message_t, as mavlink_parse_char() would have produced it
+ */
+MAVLINK_HELPER void mavlink_frame_view_to_message(mavlink_frame_view_t *view, mavlink_message_t *msg)
+{
+	msg->magic = view->magic;
+	msg->len = view->len;
+	msg->incompat_flags = view->incompat_flags;
+	msg->compat_flags = view->compat_flags;
+	msg->seq = view->seq;
+	msg->sysid = view->sysid;
+	msg->compid = view->compid;
+	msg->msgid = view->msgid;
+	if (msg != view->scratch || !view->scratch_valid) {
+		memcpy(_MAV_PAYLOAD_NON_CONST(msg), view->payload, view->len);
+		// zero-fill the packet to cope with short incoming packets
+		if (view->entry != NULL && view->len < view->entry->max_msg_len) {
+			memset(&_MAV_PAYLOAD_NON_CONST(msg)[view->len], 0, view->entry->max_msg_len - view->len);
+		}
+	}
+	msg->ck[0] = view->payload[view->len];
+	msg->ck[1] = view->payload[view->len+1];
+	msg->checksum = msg->ck[0] | (msg->ck[1] << 8);
+	if (view->signature != NULL) {
+		memcpy(msg->signature, view->signature, MAVLINK_SIGNATURE_BLOCK_LEN);
+	}
+}
+
+/*
+  fill in a frame view for a message completed by the byte-wise parser,
+  writing the frame bytes to buf
+ */
+MAVLINK_HELPER void _mav_frame_view_from_message(mavlink_frame_view_t *view, mavlink_message_t *msg, uint8_t *buf)
+{
+	const bool mavlink1 = (msg->magic == MAVLINK_STX_MAVLINK1);
+	const uint8_t header_len = mavlink1 ? MAVLINK_CORE_HEADER_MAVLINK1_LEN+1 : MAVLINK_NUM_HEADER_BYTES;
+	const bool signed_frame = (msg->incompat_flags & MAVLINK_IFLAG_SIGNED) != 0;
+	buf[0] = msg->magic;
+	buf[1] = msg->len;
+	if (mavlink1) {
+		buf[2] = msg->seq;
+		buf[3] = msg->sysid;
+		buf[4] = msg->compid;
+		buf[5] = msg->msgid & 0xFF;
+	} else {
+		buf[2] = msg->incompat_flags;
+		buf[3] = msg->compat_flags;
+		buf[4] = msg->seq;
+		buf[5] = msg->sysid;
+		buf[6] = msg->compid;
+		buf[7] = msg->msgid & 0xFF;
+		buf[8] = (msg->msgid >> 8) & 0xFF;
+		buf[9] = (msg->msgid >> 16) & 0xFF;
+	}
+	memcpy(&buf[header_len], _MAV_PAYLOAD(msg), msg->len);
+	buf[header_len + msg->len] = msg->ck[0];
+	buf[header_len + msg->len + 1] = msg->ck[1];
+	if (signed_frame) {
+		memcpy(&buf[header_len + msg->len + MAVLINK_NUM_CHECKSUM_BYTES], msg->signature, MAVLINK_SIGNATURE_BLOCK_LEN);
+	}
+
+	view->msgid = msg->msgid;
+	view->magic = msg->magic;
+	view->len = msg->len;
+	view->incompat_flags = msg->incompat_flags;
+	view->compat_flags = msg->compat_flags;
+	view->seq = msg->seq;
+	view->sysid = msg->sysid;
+	view->compid = msg->compid;
+	view->frame_len = header_len + msg->len + MAVLINK_NUM_CHECKSUM_BYTES + (signed_frame ? MAVLINK_SIGNATURE_BLOCK_LEN : 0);
+	view->frame = buf;
+	view->payload = &buf[header_len];
+	view->signature = signed_frame ? &buf[header_len + msg->len + MAVLINK_NUM_CHECKSUM_BYTES] : NULL;
+	view->entry = mavlink_get_msg_entry(msg->msgid);
+	// the byte-wise parser has already zero-extended the payload
+	view->scratch = msg;
+	view->scratch_valid = true;
+}
+
+/*
+  count a good message in status, as mavlink_frame_char_buffer() does
+ */
+MAVLINK_HELPER void _mav_parse_received(mavlink_status_t *status, uint8_t sysid, uint8_t compid, uint8_t seq)
+{
+	status->msg_received = MAVLINK_FRAMING_OK;
+	if (status->seq_table != NULL) {
+		mavlink_seq_table_update(status->seq_table, sysid, compid, seq);
+	}
+	status->current_rx_seq = seq;
+	// Initial condition: If no packet has been received so far, drop count is undefined
+	if (status->packet_rx_success_count == 0) status->packet_rx_drop_count = 0;
+	// Count this packet as received
+	status->packet_rx_success_count++;
+}
+
+/*
+  whether a message not in the dialect, ending just before next (len bytes
+  left in the buffer), is passed on. Its CRC cannot be checked, so it has
+  to start where the last good frame ended and be followed by another
+  frame or the end of the buffer
+ */
+MAVLINK_HELPER bool _mav_pass_unknown(const mavlink_status_t *status, const uint8_t *next, uint32_t len)
+{
+	return (status->flags & MAVLINK_STATUS_FLAG_PASS_UNKNOWN) &&
+	       !(status->flags & MAVLINK_STATUS_FLAG_RESYNC) &&
+	       (len == 0 || next[0] == MAVLINK_STX || next[0] == MAVLINK_STX_MAVLINK1);
+}
+
+/**
+ * This is a variant of mavlink_parse_char() that parses a whole buffer, for
+ * example one UDP datagram, with caller supplied parsing buffers, and
+ * passes each message to the callback as a view into buf instead of
+ * copying it into a mavlink_message_t.
+ *
+ * While idle the parser jumps straight to the next start-of-frame marker. A
+ * frame that lies completely inside the buffer is checked with one CRC pass
+ * over header and payload instead of going through the byte-wise state
+ * machine, and is not copied at all. A frame cut off at the end of the
+ * buffer is kept in rxmsg/status and completed by the next call, so a stream
+ * split at arbitrary points (e.g. UART reads) produces the same messages as
+ * mavlink_parse_char().
+ *
+ * Messages with a bad CRC or signature are dropped and counted as parse errors.
+ *
+ * With MAVLINK_STATUS_FLAG_PASS_UNKNOWN set in status->flags, messages whose
+ * msgid is not in the dialect are passed on with view->entry NULL instead of
+ * being dropped, for bridges that forward what they cannot decode. Their CRC
+ * cannot be checked without the message's CRC extra byte, so they are only
+ * taken between two frames: not after skipped bytes until a checked frame
+ * has been found again (MAVLINK_STATUS_FLAG_RESYNC), and only if another
+ * start marker or the end of the buffer follows.
+ *
+ * @param rxmsg    parsing message buffer, also used by mavlink_frame_view_payload()
+ * @param status   parsing status buffer
+ * @param buf      bytes to parse
+ * @param len      number of bytes in buf
+ * @param callback called with each good message in stream order, may be NULL.
+ *                 The view is only valid until the callback returns.
+ * @param arg      passed through to callback
+ * @return number of good messages found in buf
+ */
+MAVLINK_HELPER uint32_t mavlink_parse_buffer_view(mavlink_message_t* rxmsg,
+                                                  mavlink_status_t* status,
+                                                  const uint8_t *buf, uint32_t len,
+                                                  mavlink_frame_view_callback_t callback, void *arg)
+{
+	uint32_t count = 0;
+	uint32_t i = 0;
+	mavlink_frame_view_t view;
+
+	while (i < len) {
+		if (status->parse_state > MAVLINK_PARSE_STATE_IDLE) {
+			// finish a frame started by an earlier call one byte at a time
+			uint8_t framing = mavlink_frame_char_buffer(rxmsg, status, buf[i++], NULL, NULL);
+			if (framing == MAVLINK_FRAMING_OK) {
+				status->flags &= ~MAVLINK_STATUS_FLAG_RESYNC;
+				count++;
+				if (callback != NULL) {
+					uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+					_mav_frame_view_from_message(&view, rxmsg, frame);
+					callback(&view, status, arg);
+				}
+			} else if (framing == MAVLINK_FRAMING_BAD_CRC &&
+				   mavlink_get_msg_entry(rxmsg->msgid) == NULL &&
+				   _mav_pass_unknown(status, &buf[i], len - i)) {
+				_mav_parse_received(status, rxmsg->sysid, rxmsg->compid, rxmsg->seq);
+				status->parse_state = MAVLINK_PARSE_STATE_IDLE;
+				count++;
+				if (callback != NULL) {
+					uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+					_mav_frame_view_from_message(&view, rxmsg, frame);
+					callback(&view, status, arg);
+				}
+			} else if (framing == MAVLINK_FRAMING_BAD_CRC ||
+				   framing == MAVLINK_FRAMING_BAD_SIGNATURE) {
+				_mav_parse_error(status);
+				if (framing == MAVLINK_FRAMING_BAD_CRC) {
+					// the length byte may have been wrong too
+					status->flags |= MAVLINK_STATUS_FLAG_RESYNC;
+				}
+				status->msg_received = MAVLINK_FRAMING_INCOMPLETE;
+				status->parse_state = MAVLINK_PARSE_STATE_IDLE;
+			} else if ((status->parse_state == MAVLINK_PARSE_STATE_GOT_MSGID3 ||
+				    status->parse_state == MAVLINK_PARSE_STATE_GOT_PAYLOAD) && status->packet_idx == 0 &&
+				   (status->flags & MAVLINK_STATUS_FLAG_RESYNC) &&
+				   mavlink_get_msg_entry(rxmsg->msgid) == NULL) {
+				// header of an unknown message cut off while resyncing, it
+				// would not be passed on so do not let its length swallow
+				// the frames behind it
+				_mav_parse_error(status);
+				status->parse_state = MAVLINK_PARSE_STATE_IDLE;
+			}
+			continue;
+		}
+
+		// skip to the next start marker. MAVLink1 frames are rare, so only
+		// look for their marker in front of the next MAVLink2 one
+		const uint8_t *stx = (const uint8_t *)memchr(&buf[i], MAVLINK_STX, len - i);
+		uint32_t stx_idx = (stx != NULL) ? (uint32_t)(stx - buf) : len;
+		const uint8_t *stx1 = (const uint8_t *)memchr(&buf[i], MAVLINK_STX_MAVLINK1, stx_idx - i);
+		if (stx1 != NULL) {
+			stx = stx1;
+		}
+		if (stx != &buf[i]) {
+			// bytes between frames, whatever follows is not known to be a frame boundary
+			status->flags |= MAVLINK_STATUS_FLAG_RESYNC;
+		}
+		if (stx == NULL) {
+			break;
+		}
+		i = (uint32_t)(stx - buf);
+
+		const uint8_t *f = stx;
+		const bool mavlink1 = (f[0] == MAVLINK_STX_MAVLINK1);
+		const uint32_t header_len = mavlink1 ? MAVLINK_CORE_HEADER_MAVLINK1_LEN+1 : MAVLINK_NUM_HEADER_BYTES;
+		if (len - i < header_len) {
+			// header continues in the next buffer
+			mavlink_frame_char_buffer(rxmsg, status, buf[i++], NULL, NULL);
+			continue;
+		}
+
+		const uint8_t payload_len = f[1];
+		const uint8_t incompat_flags = mavlink1 ? 0 : f[2];
+		if ((incompat_flags & ~MAVLINK_IFLAG_MASK) != 0
+/* Support shorter buffers than the
+   default maximum packet size */
+#if (MAVLINK_MAX_PAYLOAD_LEN < 255)
+		    || payload_len > MAVLINK_MAX_PAYLOAD_LEN
+#endif
+			) {
+			_mav_parse_error(status);
+			status->flags |= MAVLINK_STATUS_FLAG_RESYNC;
+			i++;
+			continue;
+		}
+
+		const uint32_t msgid = mavlink1 ? f[5] : (f[7] | ((uint32_t)f[8] << 8) | ((uint32_t)f[9] << 16));
+		const mavlink_msg_entry_t *e = mavlink_get_msg_entry(msgid);
+		if (e == NULL && (status->flags & MAVLINK_STATUS_FLAG_RESYNC)) {
+			// nothing to check it against and no frame boundary to trust
+			_mav_parse_error(status);
+			i++;
+			continue;
+		}
+
+		const uint32_t frame_len = header_len + payload_len + MAVLINK_NUM_CHECKSUM_BYTES +
+			((incompat_flags & MAVLINK_IFLAG_SIGNED) ? MAVLINK_SIGNATURE_BLOCK_LEN : 0);
+		if (len - i < frame_len) {
+			// frame continues in the next buffer
+			mavlink_frame_char_buffer(rxmsg, status, buf[i++], NULL, NULL);
+			continue;
+		}
+
+		const uint8_t *ck = &f[header_len + payload_len];
+		bool crc_ok = false;
+		if (e != NULL
+#ifdef MAVLINK_CHECK_MESSAGE_LENGTH
+		    && payload_len >= e->min_msg_len && payload_len <= e->max_msg_len
+#endif
+			) {
+			uint16_t checksum = crc_calculate(&f[1], (uint16_t)(header_len - 1 + payload_len));
+			crc_accumulate(e->crc_extra, &checksum);
+			crc_ok = (ck[0] == (checksum & 0xFF)) && (ck[1] == (checksum >> 8));
+			if (crc_ok) {
+				status->flags &= ~MAVLINK_STATUS_FLAG_RESYNC;
+			}
+		} else if (e == NULL) {
+			crc_ok = _mav_pass_unknown(status, &f[frame_len], len - i - frame_len);
+		}
+		if (!crc_ok) {
+			// not a frame, or a corrupted one. Resync on the next byte
+			_mav_parse_error(status);
+			status->flags |= MAVLINK_STATUS_FLAG_RESYNC;
+			i++;
+			continue;
+		}
+
+		view.msgid = msgid;
+		view.magic = f[0];
+		view.len = payload_len;
+		view.incompat_flags = incompat_flags;
+		if (mavlink1) {
+			view.compat_flags = 0;
+			view.seq = f[2];
+			view.sysid = f[3];
+			view.compid = f[4];
+			status->flags |= MAVLINK_STATUS_FLAG_IN_MAVLINK1;
+		} else {
+			view.compat_flags = f[3];
+			view.seq = f[4];
+			view.sysid = f[5];
+			view.compid = f[6];
+			status->flags &= ~MAVLINK_STATUS_FLAG_IN_MAVLINK1;
+		}
+		view.frame_len = (uint16_t)frame_len;
+		view.frame = f;
+		view.payload = &f[header_len];
+		view.signature = (incompat_flags & MAVLINK_IFLAG_SIGNED) ? &ck[MAVLINK_NUM_CHECKSUM_BYTES] : NULL;
+		view.entry = e;
+		view.scratch = rxmsg;
+		view.scratch_valid = false;
+		i += frame_len;
+
+		bool sig_ok = true;
+		if (view.signature != NULL) {
+#ifndef MAVLINK_NO_SIGNATURE_CHECK
+			sig_ok = _mav_signature_check_parts(status->signing, status->signing_streams,
+							    f, view.payload, payload_len, ck, view.signature);
+#endif
+			if (!sig_ok &&
+			    (status->signing->accept_unsigned_callback &&
+			     status->signing->accept_unsigned_callback(status, msgid))) {
+				// accepted via application level override
+				sig_ok = true;
+			}
+		} else if (status->signing &&
+			   (status->signing->accept_unsigned_callback == NULL ||
+			    !status->signing->accept_unsigned_callback(status, msgid))) {
+			sig_ok = false;
+		}
+		if (!sig_ok) {
+			_mav_parse_error(status);
+			continue;
+		}
+
+		_mav_parse_received(status, view.sysid, view.compid, view.seq);
+		count++;
+		if (callback != NULL) {
+			callback(&view, status, arg);
+		}
+	}
+
+	return count;
+}
+
+/*
+  state for passing views from mavlink_parse_buffer_view() on as messages
+ */
+struct __mavlink_parse_buffer_ctx {
+	mavlink_parse_callback_t callback;
+	void *arg;
+};
+
+MAVLINK_HELPER void _mav_parse_buffer_copy(mavlink_frame_view_t *view, const mavlink_status_t *status, void *arg)
+{
+	struct __mavlink_parse_buffer_ctx *ctx = (struct __mavlink_parse_buffer_ctx *)arg;
+	mavlink_frame_view_to_message(view, view->scratch);
+	if (ctx->callback != NULL) {
+		ctx->callback(view->scratch, status, ctx->arg);
+	}
+}
+
+/**
+ * This is a variant of mavlink_parse_buffer_view() that copies each message
+ * into rxmsg before passing it to the callback, as mavlink_parse_char() does.
+ *
+ * @param rxmsg    parsing message buffer
+ * @param status   parsing status buffer
+ * @param buf      bytes to parse
+ * @param len      number of bytes in buf
+ * @param callback called with each good message in stream order, may be NULL.
+ *                 The message is only valid until the callback returns.
+ * @param arg      passed through to callback
+ * @return number of good messages found in buf
+ */
+MAVLINK_HELPER uint32_t mavlink_parse_buffer(mavlink_message_t* rxmsg,
+                                             mavlink_status_t* status,
+                                             const uint8_t *buf, uint32_t len,
+                                             mavlink_parse_callback_t callback, void *arg)
+{
+	struct __mavlink_parse_buffer_ctx ctx;
+	ctx.callback = callback;
+	ctx.arg = arg;
+	return mavlink_parse_buffer_view(rxmsg, status, buf, len, _mav_parse_buffer_copy, &ctx);
+}
+
+/**
+ * @brief Parse a whole buffer on a channel, see mavlink_parse_buffer()
+ */
+MAVLINK_HELPER uint32_t mavlink_parse_buffer_chan(uint8_t chan, const uint8_t *buf, uint32_t len,
+                                                  mavlink_parse_callback_t callback, void *arg)
+{
+	return mavlink_parse_buffer(mavlink_get_channel_buffer(chan),
+				    mavlink_get_channel_status(chan),
+				    buf, len, callback, arg);
+}
+
+/**
+ * @brief Parse a whole buffer on a channel, see mavlink_parse_buffer_view()
+ */
+MAVLINK_HELPER uint32_t mavlink_parse_buffer_view_chan(uint8_t chan, const uint8_t *buf, uint32_t len,
+                                                       mavlink_frame_view_callback_t callback, void *arg)
+{
+	return mavlink_parse_buffer_view(mavlink_get_channel_buffer(chan),
+					 mavlink_get_channel_status(chan),
+					 buf, len, callback, arg);
+}
+
 /**
  * @brief Put a bitfield of length 1-32 bit into the buffer
  *
@@ -0,0 +1,330 @@
+#pragma once
+
+/*
+  Stream rate controller, fitting requested telemetry rates to what the
+  link from the vehicle can carry.
+
+  Every frame received from the vehicle is passed to
+  mavlink_rate_observe(). Once per period mavlink_rate_update() measures
+  throughput and, from the sequence numbers of the vehicle, loss. It then
+  sets the byte budget for the controlled streams:
+    capacity * headroom * backoff - traffic that is not a controlled stream
+  Loss more than MAVLINK_RATE_LOSS_HIGH above the usual loss of the link,
+  or throughput near capacity, shrinks backoff multiplicatively; a clean
+  period grows it back additively. Comparing against the usual loss keeps a
+  lossy but idle WiFi link from throttling telemetry for nothing.
+
+  Every stream gets its slowest interval first. The rest of the budget goes
+  to streams by priority, highest first, each up to its desired interval.
+  Streams of equal priority that do not all fit are slowed down by the same
+  share. So ATTITUDE and GLOBAL_POSITION_INT keep their rate while less
+  important streams slow down. mavlink_rate_next_request() then hands out one
+  MAV_CMD_SET_MESSAGE_INTERVAL at a time for streams whose interval moved
+  by more than MAVLINK_RATE_HYSTERESIS_PCT, or that the vehicle does not
+  seem to have applied.
+
+  Include this after the dialect header, e.g.
+    #include "ardupilotmega/mavlink.h"
+    #include "mavlink_rate.h"
+ */
+
+#include "string.h"
+#include "mavlink_types.h"
+
+#ifndef MAVLINK_HELPER
+#define MAVLINK_HELPER
+#endif
+
+#ifndef MAVLINK_RATE_MAX_STREAMS
+#define MAVLINK_RATE_MAX_STREAMS 16
+#endif
+
+#define MAVLINK_RATE_PERIOD_MS 1000
+#define MAVLINK_RATE_HEADROOM 0.75f        ///< share of the capacity telemetry may fill
+#define MAVLINK_RATE_LOSS_HIGH 0.05f       ///< back off at this much loss above the usual
+#define MAVLINK_RATE_LOSS_LOW 0.01f        ///< recover below this much loss above the usual
+#define MAVLINK_RATE_BACKOFF_MIN 0.25f
+#define MAVLINK_RATE_HYSTERESIS_PCT 20     ///< smaller interval changes are not requested
+#define MAVLINK_RATE_STALE_PERIODS 3       ///< periods under half rate before re-requesting
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+namespace mavlink {
+#endif
+
+typedef struct __mavlink_rate_stream {
+	uint32_t msgid;
+	uint32_t desired_us;     ///< interval wanted when the link has room
+	uint32_t slowest_us;     ///< longest interval, used however busy the link is
+	uint32_t target_us;      ///< interval the budget allows
+	uint32_t requested_us;   ///< interval last requested, 0 if none yet
+	uint32_t frames;         ///< frames in the current period
+	uint32_t bytes;          ///< bytes in the current period
+	uint16_t frame_len;      ///< average frame length
+	uint8_t priority;        ///< higher is served first
+	uint8_t stale;           ///< periods in a row at under half the requested rate
+} mavlink_rate_stream_t;
+
+typedef struct __mavlink_rate_ctrl {
+	uint32_t capacity;       ///< bytes per second the link carries, e.g. baud / 10
+	uint32_t budget;         ///< bytes per second left for the controlled streams
+	uint32_t throughput;     ///< bytes per second received in the last period
+	uint32_t other;          ///< bytes per second of other traffic, smoothed
+	float loss;              ///< share of vehicle frames lost in the last period
+	float usual_loss;        ///< loss of the link when not congested, tracked slowly
+	float backoff;           ///< MAVLINK_RATE_BACKOFF_MIN .. 1
+	uint32_t period_start_ms;
+	uint32_t rx_bytes;       ///< bytes in the current period
+	uint32_t rx_frames;      ///< vehicle frames in the current period
+	uint32_t lost;           ///< vehicle frames lost in the current period
+	uint8_t sysid;           ///< vehicle whose sequence numbers measure loss
+	uint8_t compid;
+	uint8_t last_seq;
+	bool have_seq;
+	uint8_t num_streams;
+	uint8_t next;            ///< where mavlink_rate_next_request() resumes
+	mavlink_rate_stream_t streams[MAVLINK_RATE_MAX_STREAMS];
+} mavlink_rate_ctrl_t;
+
+/**
+ * @brief Set up a controller
+ *
+ * @param capacity bytes per second of the slowest hop, e.g. 5760 for a
+ *        57600 baud UART behind a WiFi bridge
+ * @param sysid vehicle whose sequence numbers measure loss
+ * @param compid component of the vehicle, usually the autopilot
+ */
+MAVLINK_HELPER void mavlink_rate_init(mavlink_rate_ctrl_t *ctrl, uint32_t capacity,
+				      uint8_t sysid, uint8_t compid, uint32_t now_ms)
+{
+	memset(ctrl, 0, sizeof(*ctrl));
+	ctrl->capacity = capacity;
+	ctrl->backoff = 1.0f;
+	ctrl->budget = (uint32_t)(capacity * MAVLINK_RATE_HEADROOM);
+	ctrl->sysid = sysid;
+	ctrl->compid = compid;
+	ctrl->period_start_ms = now_ms;
+}
+
+/*
+  bytes per second of a stream at interval_us
+ */
+MAVLINK_HELPER float _mav_rate_cost(const mavlink_rate_stream_t *s, uint32_t interval_us)
+{
+	return interval_us != 0 ? s->frame_len * 1.0e6f / interval_us : 0;
+}
+
+/*
+  fit the targets of all streams into the budget
+ */
+MAVLINK_HELPER void _mav_rate_allocate(mavlink_rate_ctrl_t *ctrl)
+{
+	uint8_t order[MAVLINK_RATE_MAX_STREAMS];
+	float left = (float)ctrl->budget;
+	uint8_t i, j, k;
+
+	for (i = 0; i < ctrl->num_streams; i++) {
+		mavlink_rate_stream_t *s = &ctrl->streams[i];
+		s->target_us = s->slowest_us;
+		left -= _mav_rate_cost(s, s->slowest_us);
+		// insertion sort by priority, keeping the order streams were added in
+		for (j = i; j > 0 && ctrl->streams[order[j - 1]].priority < s->priority; j--) {
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+	}
+	for (i = 0; i < ctrl->num_streams && left > 0; i = j) {
+		// streams i..j-1 share a priority
+		float extra = 0, share;
+		for (j = i; j < ctrl->num_streams && ctrl->streams[order[j]].priority == ctrl->streams[order[i]].priority; j++) {
+			const mavlink_rate_stream_t *s = &ctrl->streams[order[j]];
+			extra += _mav_rate_cost(s, s->desired_us) - _mav_rate_cost(s, s->slowest_us);
+		}
+		share = extra <= left ? 1.0f : left / extra;
+		for (k = i; k < j; k++) {
+			mavlink_rate_stream_t *s = &ctrl->streams[order[k]];
+			const float base = _mav_rate_cost(s, s->slowest_us);
+			const float cost = base + share * (_mav_rate_cost(s, s->desired_us) - base);
+			s->target_us = share >= 1.0f ? s->desired_us : (uint32_t)(s->frame_len * 1.0e6f / cost);
+		}
+		left -= share * extra;
+	}
+}
+
+/**
+ * @brief Control the rate of a message
+ *
+ * @param desired_us interval to request when the link has room
+ * @param slowest_us interval to fall back to on a congested link
+ * @param priority streams with a higher priority keep their rate longer
+ * @return false if MAVLINK_RATE_MAX_STREAMS streams are controlled already
+ */
+MAVLINK_HELPER bool mavlink_rate_add_stream(mavlink_rate_ctrl_t *ctrl, uint32_t msgid,
+					    uint32_t desired_us, uint32_t slowest_us, uint8_t priority)
+{
+	mavlink_rate_stream_t *s;
+	const mavlink_msg_entry_t *entry;
+
+	if (ctrl->num_streams == MAVLINK_RATE_MAX_STREAMS) {
+		return false;
+	}
+	s = &ctrl->streams[ctrl->num_streams++];
+	memset(s, 0, sizeof(*s));
+	s->msgid = msgid;
+	s->desired_us = desired_us;
+	s->slowest_us = slowest_us > desired_us ? slowest_us : desired_us;
+	s->priority = priority;
+	// assume full frames until some have been seen
+	entry = mavlink_get_msg_entry(msgid);
+	s->frame_len = (entry ? entry->max_msg_len : MAVLINK_MAX_PAYLOAD_LEN) + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+	_mav_rate_allocate(ctrl);
+	return true;
+}
+
+/**
+ * @brief Account for a frame received over the link
+ *
+ * @param frame_len length of the whole frame including header, checksum
+ *        and signature
+ */
+MAVLINK_HELPER void mavlink_rate_observe(mavlink_rate_ctrl_t *ctrl, uint8_t sysid, uint8_t compid,
+					 uint32_t msgid, uint8_t seq, uint16_t frame_len)
+{
+	uint8_t i;
+
+	ctrl->rx_bytes += frame_len;
+	if (sysid != ctrl->sysid) {
+		return;
+	}
+	if (compid == ctrl->compid) {
+		const uint8_t gap = (uint8_t)(seq - ctrl->last_seq - 1);
+		// a step back is a duplicate or reordered frame, not loss
+		if (!ctrl->have_seq || gap < 128) {
+			ctrl->lost += ctrl->have_seq ? gap : 0;
+			ctrl->last_seq = seq;
+			ctrl->have_seq = true;
+		}
+		ctrl->rx_frames++;
+	}
+	for (i = 0; i < ctrl->num_streams; i++) {
+		mavlink_rate_stream_t *s = &ctrl->streams[i];
+		if (s->msgid == msgid) {
+			s->frames++;
+			s->bytes += frame_len;
+			s->frame_len = (uint16_t)((3 * s->frame_len + frame_len + 2) / 4);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief mavlink_rate_observe() for a message from mavlink_parse_char()
+ */
+MAVLINK_HELPER void mavlink_rate_observe_msg(mavlink_rate_ctrl_t *ctrl, const mavlink_message_t *msg)
+{
+	uint16_t frame_len = msg->len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+	if (msg->magic == MAVLINK_STX_MAVLINK1) {
+		frame_len = msg->len + MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_NUM_CHECKSUM_BYTES;
+	} else if (msg->incompat_flags & MAVLINK_IFLAG_SIGNED) {
+		frame_len += MAVLINK_SIGNATURE_BLOCK_LEN;
+	}
+	mavlink_rate_observe(ctrl, msg->sysid, msg->compid, msg->msgid, msg->seq, frame_len);
+}
+
+/**
+ * @brief Close the period once MAVLINK_RATE_PERIOD_MS have passed and
+ * recompute the budget and stream intervals
+ *
+ * @return true if a period was closed
+ */
+MAVLINK_HELPER bool mavlink_rate_update(mavlink_rate_ctrl_t *ctrl, uint32_t now_ms)
+{
+	const uint32_t elapsed = now_ms - ctrl->period_start_ms;
+	uint32_t streams_bytes = 0;
+	uint32_t other, budget;
+	bool congested;
+	uint8_t i;
+
+	if (elapsed < MAVLINK_RATE_PERIOD_MS) {
+		return false;
+	}
+	ctrl->throughput = (uint32_t)((uint64_t)ctrl->rx_bytes * 1000U / elapsed);
+	ctrl->loss = ctrl->rx_frames + ctrl->lost != 0 ? (float)ctrl->lost / (ctrl->rx_frames + ctrl->lost) : 0;
+
+	// a full UART loses frames before they get a sequence number, so a
+	// link running at capacity counts as congested too
+	congested = ctrl->loss > ctrl->usual_loss + MAVLINK_RATE_LOSS_HIGH ||
+		ctrl->throughput > ctrl->capacity * 0.95f;
+	ctrl->usual_loss += (ctrl->loss - ctrl->usual_loss) / 16;
+	if (congested) {
+		ctrl->backoff *= 0.7f;
+		if (ctrl->backoff < MAVLINK_RATE_BACKOFF_MIN) {
+			ctrl->backoff = MAVLINK_RATE_BACKOFF_MIN;
+		}
+	} else if (ctrl->loss < ctrl->usual_loss + MAVLINK_RATE_LOSS_LOW && ctrl->backoff < 1.0f) {
+		ctrl->backoff += 0.1f;
+		if (ctrl->backoff > 1.0f) {
+			ctrl->backoff = 1.0f;
+		}
+	}
+
+	for (i = 0; i < ctrl->num_streams; i++) {
+		mavlink_rate_stream_t *s = &ctrl->streams[i];
+		const uint64_t expected = s->requested_us != 0 ? (uint64_t)elapsed * 1000U / s->requested_us : 0;
+		streams_bytes += s->bytes;
+		// the command or its effect got lost, or the vehicle ignores it
+		if (expected >= 2 && s->frames * 2 < expected && !congested) {
+			s->stale++;
+		} else {
+			s->stale = 0;
+		}
+		s->frames = 0;
+		s->bytes = 0;
+	}
+
+	// parameter and mission transfers come and go, follow them half way
+	other = ctrl->rx_bytes > streams_bytes
+		? (uint32_t)((uint64_t)(ctrl->rx_bytes - streams_bytes) * 1000U / elapsed) : 0;
+	ctrl->other = (ctrl->other + other) / 2;
+	budget = (uint32_t)(ctrl->capacity * MAVLINK_RATE_HEADROOM * ctrl->backoff);
+	ctrl->budget = budget > ctrl->other ? budget - ctrl->other : 0;
+	_mav_rate_allocate(ctrl);
+
+	ctrl->rx_bytes = 0;
+	ctrl->rx_frames = 0;
+	ctrl->lost = 0;
+	ctrl->period_start_ms = now_ms;
+	return true;
+}
+
+/**
+ * @brief Next MAV_CMD_SET_MESSAGE_INTERVAL to send
+ *
+ * Streams are visited round robin, so a lost command is repeated once the
+ * stream is seen running at under half the requested rate.
+ *
+ * @return false if every stream runs at its target
+ */
+MAVLINK_HELPER bool mavlink_rate_next_request(mavlink_rate_ctrl_t *ctrl, uint32_t *msgid, uint32_t *interval_us)
+{
+	uint8_t n;
+
+	for (n = 0; n < ctrl->num_streams; n++) {
+		mavlink_rate_stream_t *s = &ctrl->streams[ctrl->next];
+		const uint32_t diff = s->target_us > s->requested_us
+			? s->target_us - s->requested_us : s->requested_us - s->target_us;
+		ctrl->next = (uint8_t)((ctrl->next + 1) % ctrl->num_streams);
+		if (s->requested_us == 0 || s->stale >= MAVLINK_RATE_STALE_PERIODS ||
+		    (uint64_t)diff * 100U > (uint64_t)s->requested_us * MAVLINK_RATE_HYSTERESIS_PCT) {
+			s->requested_us = s->target_us;
+			s->stale = 0;
+			*msgid = s->msgid;
+			*interval_us = s->target_us;
+			return true;
+		}
+	}
+	return false;
+}
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+} // namespace mavlink
+#endif
@@ -0,0 +1,181 @@
+#pragma once
+
+/*
+  Target-aware routing between up to 32 endpoints (links).
+
+  The table learns which (sysid, compid) pairs live behind which endpoint
+  from the messages they send. A message is then forwarded only to the
+  endpoints that lead to its target, read straight from the payload using
+  the target offsets in the message entry table. Messages without a target,
+  or with target system 0, are broadcast to all endpoints except the one
+  they came from.
+
+  Include this after the dialect header, e.g.
+    #include "ardupilotmega/mavlink.h"
+    #include "mavlink_routing.h"
+ */
+
+#include "string.h"
+#include "mavlink_types.h"
+
+#ifndef MAVLINK_HELPER
+#define MAVLINK_HELPER
+#endif
+
+#ifndef MAVLINK_ROUTING_MAX_ROUTES
+#define MAVLINK_ROUTING_MAX_ROUTES 32
+#endif
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+namespace mavlink {
+#endif
+
+typedef struct __mavlink_route {
+	uint8_t sysid;
+	uint8_t compid;
+	uint8_t endpoint;
+} mavlink_route_t;
+
+typedef struct __mavlink_routing {
+	uint8_t num_routes;
+	uint16_t routes_full_count; ///< senders not learned because the table was full
+	mavlink_route_t routes[MAVLINK_ROUTING_MAX_ROUTES];
+} mavlink_routing_t;
+
+/**
+ * @brief Clear a routing table
+ */
+MAVLINK_HELPER void mavlink_routing_init(mavlink_routing_t *routing)
+{
+	memset(routing, 0, sizeof(*routing));
+}
+
+/**
+ * @brief Get the target system and component of a message
+ *
+ * Fields past the end of a truncated payload are zero. A message type
+ * without a target field reports 0, i.e. broadcast.
+ */
+MAVLINK_HELPER void mavlink_get_target(const mavlink_msg_entry_t *entry,
+				       const uint8_t *payload, uint8_t len,
+				       uint8_t *target_system, uint8_t *target_component)
+{
+	*target_system = 0;
+	*target_component = 0;
+	if (entry == NULL) {
+		return;
+	}
+	if ((entry->flags & MAV_MSG_ENTRY_FLAG_HAVE_TARGET_SYSTEM) && entry->target_system_ofs < len) {
+		*target_system = payload[entry->target_system_ofs];
+	}
+	if ((entry->flags & MAV_MSG_ENTRY_FLAG_HAVE_TARGET_COMPONENT) && entry->target_component_ofs < len) {
+		*target_component = payload[entry->target_component_ofs];
+	}
+}
+
+/**
+ * @brief Remember that sysid/compid can be reached through endpoint
+ *
+ * A sender that shows up on a different endpoint is moved there.
+ */
+MAVLINK_HELPER void mavlink_routing_learn(mavlink_routing_t *routing, uint8_t sysid, uint8_t compid, uint8_t endpoint)
+{
+	uint8_t i;
+	if (sysid == 0) {
+		// not a valid sender
+		return;
+	}
+	for (i=0; i<routing->num_routes; i++) {
+		mavlink_route_t *route = &routing->routes[i];
+		if (route->sysid == sysid && route->compid == compid) {
+			route->endpoint = endpoint;
+			return;
+		}
+	}
+	if (routing->num_routes >= MAVLINK_ROUTING_MAX_ROUTES) {
+		routing->routes_full_count++;
+		return;
+	}
+	routing->routes[routing->num_routes].sysid = sysid;
+	routing->routes[routing->num_routes].compid = compid;
+	routing->routes[routing->num_routes].endpoint = endpoint;
+	routing->num_routes++;
+}
+
+/**
+ * @brief Drop all routes through an endpoint, e.g. when a GCS times out
+ */
+MAVLINK_HELPER void mavlink_routing_forget_endpoint(mavlink_routing_t *routing, uint8_t endpoint)
+{
+	uint8_t i = 0;
+	while (i < routing->num_routes) {
+		if (routing->routes[i].endpoint == endpoint) {
+			routing->routes[i] = routing->routes[--routing->num_routes];
+		} else {
+			i++;
+		}
+	}
+}
+
+/**
+ * @brief Learn the sender of a message and work out where to forward it
+ *
+ * @param routing routing table
+ * @param all_endpoints bitmask of endpoints that currently exist
+ * @param src endpoint the message arrived on
+ * @param sysid sending system
+ * @param compid sending component
+ * @param entry message entry, NULL for unknown messages (broadcast)
+ * @param payload message payload as received
+ * @param len payload length as received
+ * @return bitmask of endpoints to send the message to, never including src
+ */
+MAVLINK_HELPER uint32_t mavlink_routing_route(mavlink_routing_t *routing, uint32_t all_endpoints, uint8_t src,
+					      uint8_t sysid, uint8_t compid,
+					      const mavlink_msg_entry_t *entry,
+					      const uint8_t *payload, uint8_t len)
+{
+	uint8_t target_system, target_component;
+	uint32_t system_endpoints = 0;
+	uint32_t component_endpoints = 0;
+	uint8_t i;
+
+	mavlink_routing_learn(routing, sysid, compid, src);
+
+	mavlink_get_target(entry, payload, len, &target_system, &target_component);
+	if (target_system == 0) {
+		return all_endpoints & ~((uint32_t)1 << src);
+	}
+	for (i=0; i<routing->num_routes; i++) {
+		const mavlink_route_t *route = &routing->routes[i];
+		if (route->sysid == target_system) {
+			system_endpoints |= (uint32_t)1 << route->endpoint;
+			if (route->compid == target_component) {
+				component_endpoints |= (uint32_t)1 << route->endpoint;
+			}
+		}
+	}
+	/*
+	  components that never talk themselves (e.g. handled inside the
+	  autopilot) are reached through their system. Systems we have not
+	  heard from are not forwarded anywhere
+	 */
+	if (target_component != 0 && component_endpoints != 0) {
+		system_endpoints = component_endpoints;
+	}
+	return system_endpoints & all_endpoints & ~((uint32_t)1 << src);
+}
+
+/**
+ * @brief mavlink_routing_route() for a frame found by mavlink_parse_buffer_view()
+ */
+MAVLINK_HELPER uint32_t mavlink_routing_route_view(mavlink_routing_t *routing, uint32_t all_endpoints, uint8_t src,
+						   const mavlink_frame_view_t *view)
+{
+	return mavlink_routing_route(routing, all_endpoints, src, view->sysid, view->compid,
+				     view->entry, view->payload, view->len);
+}
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+} // namespace mavlink
+#endif
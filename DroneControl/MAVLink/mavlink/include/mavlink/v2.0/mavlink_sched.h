@@ -0,0 +1,284 @@
+#pragma once
+
+/*
+  Priority scheduler for frames sent over a slow serial link, e.g. a
+  57600 baud telemetry radio or flight controller UART.
+
+  Frames are queued in one of four classes and released strictly by class,
+  paced by a token bucket running at the line rate. Pacing keeps the UART
+  buffer nearly empty, so a command queued behind a parameter or mission
+  burst only waits for the frame on the wire, not for the whole burst.
+  A newer MANUAL_CONTROL, RC_CHANNELS_OVERRIDE or SET_*_TARGET frame
+  replaces a queued one for the same sender and target instead of queueing
+  behind it.
+
+  Every class counts its frames and keeps a histogram of how long sent
+  frames waited in the queue.
+
+  Include this after the dialect header, e.g.
+    #include "ardupilotmega/mavlink.h"
+    #include "mavlink_routing.h"
+    #include "mavlink_sched.h"
+ */
+
+#include "string.h"
+#include "mavlink_types.h"
+
+#ifndef MAVLINK_HELPER
+#define MAVLINK_HELPER
+#endif
+
+#ifndef MAVLINK_SCHED_SLOTS
+#define MAVLINK_SCHED_SLOTS 8          ///< frames queued per class
+#endif
+
+#define MAVLINK_SCHED_HIST_BUCKETS 12  ///< bucket 0: < 1 ms, bucket i: < 2^i ms, last: the rest
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+namespace mavlink {
+#endif
+
+typedef enum {
+	MAVLINK_SCHED_COMMAND = 0,   ///< commands, acks, mode changes, heartbeats
+	MAVLINK_SCHED_CONTROL = 1,   ///< manual control and setpoints, newest wins
+	MAVLINK_SCHED_NORMAL = 2,    ///< everything else
+	MAVLINK_SCHED_BULK = 3,      ///< parameter, mission, log and file transfers
+	MAVLINK_SCHED_NUM_CLASSES = 4
+} mavlink_sched_class_t;
+
+typedef struct __mavlink_sched_slot {
+	uint32_t enqueued_us;
+	uint32_t msgid;
+	uint8_t sysid;
+	uint8_t compid;
+	uint8_t target_system;
+	uint8_t target_component;
+	uint16_t len;
+	uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+} mavlink_sched_slot_t;
+
+typedef struct __mavlink_sched_class_stats {
+	uint32_t queued;             ///< frames accepted
+	uint32_t sent;               ///< frames released
+	uint32_t coalesced;          ///< frames replaced by a newer one before they were sent
+	uint32_t dropped;            ///< frames refused because the class was full
+	uint32_t latency[MAVLINK_SCHED_HIST_BUCKETS]; ///< sent frames by time spent queued
+} mavlink_sched_class_stats_t;
+
+typedef struct __mavlink_sched_queue {
+	uint8_t head;
+	uint8_t count;
+	mavlink_sched_slot_t slots[MAVLINK_SCHED_SLOTS];
+	mavlink_sched_class_stats_t stats;
+} mavlink_sched_queue_t;
+
+typedef struct __mavlink_sched {
+	uint32_t bytes_per_sec;      ///< line rate
+	uint32_t burst;              ///< most bytes released at once, e.g. the UART FIFO size
+	uint64_t tokens;             ///< bytes the line can take now, times 1000000
+	uint32_t last_us;            ///< time of the last refill
+	mavlink_sched_queue_t queue[MAVLINK_SCHED_NUM_CLASSES];
+} mavlink_sched_t;
+
+/**
+ * @brief Set up a scheduler for a serial line
+ *
+ * @param baud line rate in bits per second, 8N1 framing is assumed
+ * @param burst bytes that may be handed to the UART at once, at least one
+ *        frame; more tolerates a slower caller, less keeps the UART buffer
+ *        from delaying urgent frames
+ * @param now_us current time in microseconds
+ */
+MAVLINK_HELPER void mavlink_sched_init(mavlink_sched_t *sched, uint32_t baud, uint32_t burst, uint32_t now_us)
+{
+	memset(sched, 0, sizeof(*sched));
+	sched->bytes_per_sec = baud / 10;
+	sched->burst = burst < MAVLINK_MAX_PACKET_LEN ? MAVLINK_MAX_PACKET_LEN : burst;
+	sched->tokens = (uint64_t)sched->burst * 1000000U;
+	sched->last_us = now_us;
+}
+
+/**
+ * @brief Class of a frame
+ */
+MAVLINK_HELPER mavlink_sched_class_t mavlink_sched_classify(uint32_t msgid)
+{
+	switch (msgid) {
+#ifdef MAVLINK_MSG_ID_COMMAND_LONG
+	case MAVLINK_MSG_ID_HEARTBEAT:
+	case MAVLINK_MSG_ID_SET_MODE:
+	case MAVLINK_MSG_ID_COMMAND_LONG:
+	case MAVLINK_MSG_ID_COMMAND_INT:
+	case MAVLINK_MSG_ID_COMMAND_ACK:
+		return MAVLINK_SCHED_COMMAND;
+
+	case MAVLINK_MSG_ID_MANUAL_CONTROL:
+	case MAVLINK_MSG_ID_RC_CHANNELS_OVERRIDE:
+	case MAVLINK_MSG_ID_SET_ATTITUDE_TARGET:
+	case MAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED:
+	case MAVLINK_MSG_ID_SET_POSITION_TARGET_GLOBAL_INT:
+		return MAVLINK_SCHED_CONTROL;
+
+	case MAVLINK_MSG_ID_PARAM_REQUEST_READ:
+	case MAVLINK_MSG_ID_PARAM_REQUEST_LIST:
+	case MAVLINK_MSG_ID_PARAM_VALUE:
+	case MAVLINK_MSG_ID_PARAM_SET:
+	case MAVLINK_MSG_ID_MISSION_ITEM:
+	case MAVLINK_MSG_ID_MISSION_ITEM_INT:
+	case MAVLINK_MSG_ID_MISSION_REQUEST:
+	case MAVLINK_MSG_ID_MISSION_REQUEST_INT:
+	case MAVLINK_MSG_ID_MISSION_REQUEST_LIST:
+	case MAVLINK_MSG_ID_MISSION_COUNT:
+	case MAVLINK_MSG_ID_MISSION_CLEAR_ALL:
+	case MAVLINK_MSG_ID_MISSION_ACK:
+	case MAVLINK_MSG_ID_LOG_REQUEST_LIST:
+	case MAVLINK_MSG_ID_LOG_REQUEST_DATA:
+	case MAVLINK_MSG_ID_LOG_DATA:
+	case MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+		return MAVLINK_SCHED_BULK;
+#endif
+	default:
+		return MAVLINK_SCHED_NORMAL;
+	}
+}
+
+/*
+  index of slot i of a queue, counting from its head
+ */
+MAVLINK_HELPER uint8_t _mav_sched_index(const mavlink_sched_queue_t *q, uint8_t i)
+{
+	return (uint8_t)((q->head + i) % MAVLINK_SCHED_SLOTS);
+}
+
+/**
+ * @brief Queue a frame found by mavlink_parse_buffer_view()
+ *
+ * @return false if its class was full and the frame was dropped
+ */
+MAVLINK_HELPER bool mavlink_sched_enqueue(mavlink_sched_t *sched, const mavlink_frame_view_t *view, uint32_t now_us)
+{
+	const mavlink_sched_class_t cls = mavlink_sched_classify(view->msgid);
+	mavlink_sched_queue_t *q = &sched->queue[cls];
+	mavlink_sched_slot_t *slot = NULL;
+	uint8_t target_system, target_component;
+	uint8_t i;
+
+	mavlink_get_target(view->entry, view->payload, view->len, &target_system, &target_component);
+	if (cls == MAVLINK_SCHED_CONTROL) {
+		// a newer setpoint makes the queued one worthless
+		for (i = 0; i < q->count; i++) {
+			mavlink_sched_slot_t *s = &q->slots[_mav_sched_index(q, i)];
+			if (s->msgid == view->msgid && s->sysid == view->sysid && s->compid == view->compid &&
+			    s->target_system == target_system && s->target_component == target_component) {
+				slot = s;
+				q->stats.coalesced++;
+				break;
+			}
+		}
+	}
+	if (slot == NULL) {
+		if (q->count == MAVLINK_SCHED_SLOTS) {
+			q->stats.dropped++;
+			return false;
+		}
+		slot = &q->slots[_mav_sched_index(q, q->count)];
+		q->count++;
+		// a replaced frame keeps its place and its wait so far
+		slot->enqueued_us = now_us;
+	}
+	slot->msgid = view->msgid;
+	slot->sysid = view->sysid;
+	slot->compid = view->compid;
+	slot->target_system = target_system;
+	slot->target_component = target_component;
+	slot->len = view->frame_len;
+	memcpy(slot->frame, view->frame, view->frame_len);
+	q->stats.queued++;
+	return true;
+}
+
+/**
+ * @brief Next frame the line has room for, highest class first
+ *
+ * A frame that does not fit yet holds back the lower classes, so the line
+ * never fills up with bulk traffic while a command waits.
+ *
+ * @param len set to the frame length
+ * @return the frame, valid until the next mavlink_sched_enqueue(), or
+ *         NULL if nothing is due
+ */
+MAVLINK_HELPER const uint8_t *mavlink_sched_next(mavlink_sched_t *sched, uint32_t now_us, uint16_t *len)
+{
+	const uint64_t full = (uint64_t)sched->burst * 1000000U;
+	uint32_t elapsed = now_us - sched->last_us;
+	int c;
+
+	sched->last_us = now_us;
+	sched->tokens += (uint64_t)elapsed * sched->bytes_per_sec;
+	if (sched->tokens > full) {
+		sched->tokens = full;
+	}
+	for (c = 0; c < MAVLINK_SCHED_NUM_CLASSES; c++) {
+		mavlink_sched_queue_t *q = &sched->queue[c];
+		mavlink_sched_slot_t *slot;
+		uint32_t waited_ms;
+		uint8_t bucket = 0;
+		if (q->count == 0) {
+			continue;
+		}
+		slot = &q->slots[q->head];
+		if (sched->tokens < (uint64_t)slot->len * 1000000U) {
+			return NULL;
+		}
+		sched->tokens -= (uint64_t)slot->len * 1000000U;
+		q->head = _mav_sched_index(q, 1);
+		q->count--;
+
+		waited_ms = (now_us - slot->enqueued_us) / 1000U;
+		while (waited_ms != 0 && bucket < MAVLINK_SCHED_HIST_BUCKETS - 1) {
+			waited_ms >>= 1;
+			bucket++;
+		}
+		q->stats.latency[bucket]++;
+		q->stats.sent++;
+		*len = slot->len;
+		return slot->frame;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Microseconds until the head frame fits on the line, 0 if it
+ * fits now or nothing is queued
+ */
+MAVLINK_HELPER uint32_t mavlink_sched_wait_us(const mavlink_sched_t *sched, uint32_t now_us)
+{
+	uint64_t tokens = sched->tokens + (uint64_t)(now_us - sched->last_us) * sched->bytes_per_sec;
+	int c;
+	for (c = 0; c < MAVLINK_SCHED_NUM_CLASSES; c++) {
+		const mavlink_sched_queue_t *q = &sched->queue[c];
+		uint64_t need;
+		if (q->count == 0) {
+			continue;
+		}
+		need = (uint64_t)q->slots[q->head].len * 1000000U;
+		if (tokens >= need || sched->bytes_per_sec == 0) {
+			return 0;
+		}
+		return (uint32_t)((need - tokens + sched->bytes_per_sec - 1) / sched->bytes_per_sec);
+	}
+	return 0;
+}
+
+/**
+ * @brief Upper bound of latency histogram bucket i in milliseconds, 0 for
+ * the last, open ended bucket
+ */
+MAVLINK_HELPER uint32_t mavlink_sched_bucket_ms(uint8_t i)
+{
+	return i < MAVLINK_SCHED_HIST_BUCKETS - 1 ? (1U << i) : 0;
+}
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+} // namespace mavlink
+#endif
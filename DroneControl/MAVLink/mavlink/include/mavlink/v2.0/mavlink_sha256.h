@@ -220,6 +220,189 @@ MAVLINK_HELPER void mavlink_sha256_final_48(mavlink_sha256_ctx *m, uint8_t resul
     result[5] = p[6];
 }
 
+/*
+  The MAVLink signature is sha256(secret_key + data) where the 32 byte key
+  fills the first half of the first block. The first 8 compression rounds
+  and part of the message schedule of that block only depend on the key,
+  so they are computed once per key by mavlink_sha256_key_init() and
+  skipped by mavlink_sha256_key_48().
+ */
+static inline uint32_t _mav_sha256_load_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/*
+  one compression round, with the working variables renamed instead of
+  moved so eight rounds leave them back in place
+ */
+#define MAVLINK_SHA256_ROUND(a,b,c,d,e,f,g,h,i) do { \
+	uint32_t T1 = h + Sigma1(e) + Ch(e, f, g) + mavlink_sha256_constant_256[i] + data[i]; \
+	d += T1; \
+	h = T1 + Sigma0(a) + Maj(a, b, c); \
+    } while (0)
+
+/*
+  run rounds first..63 of the compression function on state, with the
+  working variables already advanced to round first in v. first must be a
+  multiple of 8
+ */
+static inline void _mav_sha256_rounds(uint32_t state[8], const uint32_t v[8], const uint32_t data[64], int first)
+{
+    uint32_t AA = v[0], BB = v[1], CC = v[2], DD = v[3];
+    uint32_t EE = v[4], FF = v[5], GG = v[6], HH = v[7];
+    int i;
+
+    for (i = first; i < 64; i += 8) {
+	MAVLINK_SHA256_ROUND(AA, BB, CC, DD, EE, FF, GG, HH, i+0);
+	MAVLINK_SHA256_ROUND(HH, AA, BB, CC, DD, EE, FF, GG, i+1);
+	MAVLINK_SHA256_ROUND(GG, HH, AA, BB, CC, DD, EE, FF, i+2);
+	MAVLINK_SHA256_ROUND(FF, GG, HH, AA, BB, CC, DD, EE, i+3);
+	MAVLINK_SHA256_ROUND(EE, FF, GG, HH, AA, BB, CC, DD, i+4);
+	MAVLINK_SHA256_ROUND(DD, EE, FF, GG, HH, AA, BB, CC, i+5);
+	MAVLINK_SHA256_ROUND(CC, DD, EE, FF, GG, HH, AA, BB, i+6);
+	MAVLINK_SHA256_ROUND(BB, CC, DD, EE, FF, GG, HH, AA, i+7);
+    }
+
+    state[0] += AA;
+    state[1] += BB;
+    state[2] += CC;
+    state[3] += DD;
+    state[4] += EE;
+    state[5] += FF;
+    state[6] += GG;
+    state[7] += HH;
+}
+
+/*
+  precompute the key dependent part of hashing a 32 byte key followed by data
+ */
+MAVLINK_HELPER void mavlink_sha256_key_init(mavlink_sha256_key_state_t *ks, const uint8_t key[32])
+{
+    mavlink_sha256_ctx m;
+    uint32_t AA, BB, CC, DD, EE, FF, GG, HH;
+    int i;
+
+    mavlink_sha256_init(&m);
+    for (i = 0; i < 8; i++) {
+	ks->key_words[i] = _mav_sha256_load_be32(&key[i*4]);
+    }
+
+    AA = m.counter[0];
+    BB = m.counter[1];
+    CC = m.counter[2];
+    DD = m.counter[3];
+    EE = m.counter[4];
+    FF = m.counter[5];
+    GG = m.counter[6];
+    HH = m.counter[7];
+    {
+	const uint32_t *data = ks->key_words;
+	MAVLINK_SHA256_ROUND(AA, BB, CC, DD, EE, FF, GG, HH, 0);
+	MAVLINK_SHA256_ROUND(HH, AA, BB, CC, DD, EE, FF, GG, 1);
+	MAVLINK_SHA256_ROUND(GG, HH, AA, BB, CC, DD, EE, FF, 2);
+	MAVLINK_SHA256_ROUND(FF, GG, HH, AA, BB, CC, DD, EE, 3);
+	MAVLINK_SHA256_ROUND(EE, FF, GG, HH, AA, BB, CC, DD, 4);
+	MAVLINK_SHA256_ROUND(DD, EE, FF, GG, HH, AA, BB, CC, 5);
+	MAVLINK_SHA256_ROUND(CC, DD, EE, FF, GG, HH, AA, BB, 6);
+	MAVLINK_SHA256_ROUND(BB, CC, DD, EE, FF, GG, HH, AA, 7);
+    }
+    ks->state[0] = AA;
+    ks->state[1] = BB;
+    ks->state[2] = CC;
+    ks->state[3] = DD;
+    ks->state[4] = EE;
+    ks->state[5] = FF;
+    ks->state[6] = GG;
+    ks->state[7] = HH;
+
+    // data[i] = sigma1(data[i-2]) + data[i-7] + sigma0(data[i-15]) + data[i-16]
+    for (i = 16; i < 23; i++) {
+	ks->schedule[i-16] = sigma0(ks->key_words[i-15]) + ks->key_words[i-16];
+    }
+}
+
+/*
+  get first 48 bits of sha256(key + data), with the key already absorbed
+  into ks by mavlink_sha256_key_init()
+ */
+MAVLINK_HELPER void mavlink_sha256_key_48(const mavlink_sha256_key_state_t *ks,
+					  const uint8_t *data, uint32_t len, uint8_t result[6])
+{
+    const uint32_t total = 32 + len;                      // bytes hashed, including the key
+    const uint32_t padded = (total + 1 + 8 + 63) & ~63U;  // with 0x80 marker and bit length
+    const uint64_t bits = (uint64_t)total * 8;
+    uint32_t state[8];
+    uint32_t v[8];
+    uint32_t data_words[64];
+    uint8_t block[64];
+    uint32_t start;
+    int i;
+
+    mavlink_sha256_ctx m;
+    mavlink_sha256_init(&m);
+    memcpy(state, m.counter, sizeof(state));
+
+    for (start = 0; start < padded; start += 64) {
+	// message bytes of this block, skipping the key in the first one
+	const uint32_t from = (start == 0) ? 32 : 0;
+	uint32_t avail = 0;
+	uint32_t n;
+	if (total > start + from) {
+	    avail = total - (start + from);
+	    if (avail > 64 - from) {
+		avail = 64 - from;
+	    }
+	    memcpy(&block[from], &data[start + from - 32], avail);
+	}
+	n = from + avail;
+	if (start + n == total && n < 64) {
+	    block[n++] = 0x80;
+	}
+	memset(&block[n], 0, 64 - n);
+	if (start + 64 == padded) {
+	    for (i = 0; i < 8; i++) {
+		block[56 + i] = (uint8_t)(bits >> (56 - 8*i));
+	    }
+	}
+
+	for (i = from/4; i < 16; i++) {
+	    data_words[i] = _mav_sha256_load_be32(&block[i*4]);
+	}
+	if (start == 0) {
+	    memcpy(data_words, ks->key_words, sizeof(ks->key_words));
+	    for (i = 16; i < 23; i++) {
+		data_words[i] = sigma1(data_words[i-2]) + data_words[i-7] + ks->schedule[i-16];
+	    }
+	} else {
+	    for (i = 16; i < 23; i++) {
+		data_words[i] = sigma1(data_words[i-2]) + data_words[i-7] +
+		    sigma0(data_words[i-15]) + data_words[i-16];
+	    }
+	}
+	for (i = 23; i < 64; i++) {
+	    data_words[i] = sigma1(data_words[i-2]) + data_words[i-7] +
+		sigma0(data_words[i-15]) + data_words[i-16];
+	}
+
+	if (start == 0) {
+	    memcpy(v, ks->state, sizeof(v));
+	    _mav_sha256_rounds(state, v, data_words, 8);
+	} else {
+	    memcpy(v, state, sizeof(v));
+	    _mav_sha256_rounds(state, v, data_words, 0);
+	}
+    }
+
+    // big-endian digest bytes, as mavlink_sha256_final_48()
+    result[0] = (uint8_t)(state[0] >> 24);
+    result[1] = (uint8_t)(state[0] >> 16);
+    result[2] = (uint8_t)(state[0] >> 8);
+    result[3] = (uint8_t)(state[0]);
+    result[4] = (uint8_t)(state[1] >> 24);
+    result[5] = (uint8_t)(state[1] >> 16);
+}
+
 // prevent conflicts with users of the header
 #undef Ch
 #undef ROTR
@@ -227,6 +410,36 @@ MAVLINK_HELPER void mavlink_sha256_final_48(mavlink_sha256_ctx *m, uint8_t resul
 #undef Sigma1
 #undef sigma0
 #undef sigma1
+#undef MAVLINK_SHA256_ROUND
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+} // namespace mavlink
+#endif
+
+#else // HAVE_MAVLINK_SHA256
+
+#ifdef MAVLINK_USE_CXX_NAMESPACE
+namespace mavlink {
+#endif
+
+/*
+  the implementation provides only the plain sha256 API, so the key state
+  just holds the key and every signature hashes it again
+ */
+MAVLINK_HELPER void mavlink_sha256_key_init(mavlink_sha256_key_state_t *ks, const uint8_t key[32])
+{
+    memcpy(ks->key_words, key, 32);
+}
+
+MAVLINK_HELPER void mavlink_sha256_key_48(const mavlink_sha256_key_state_t *ks,
+					  const uint8_t *data, uint32_t len, uint8_t result[6])
+{
+    mavlink_sha256_ctx ctx;
+    mavlink_sha256_init(&ctx);
+    mavlink_sha256_update(&ctx, ks->key_words, 32);
+    mavlink_sha256_update(&ctx, data, len);
+    mavlink_sha256_final_48(&ctx, result);
+}
 
 #ifdef MAVLINK_USE_CXX_NAMESPACE
 } // namespace mavlink
@@ -214,6 +214,8 @@ typedef enum {
 #define MAVLINK_STATUS_FLAG_OUT_MAVLINK1 2 // generate MAVLink1 by default
 #define MAVLINK_STATUS_FLAG_IN_SIGNED    4 // last incoming packet was signed and validated
 #define MAVLINK_STATUS_FLAG_IN_BADSIG    8 // last incoming packet had a bad signature
+#define MAVLINK_STATUS_FLAG_PASS_UNKNOWN 16 // mavlink_parse_buffer_view() passes on messages not in the dialect, unchecked
+#define MAVLINK_STATUS_FLAG_RESYNC       32 // mavlink_parse_buffer_view() skipped bytes and has not seen a checked frame since
 
 #define MAVLINK_STX_MAVLINK1 0xFE          // marker for old protocol
 
@@ -231,6 +233,8 @@ typedef struct __mavlink_status {
     uint8_t signature_wait;             ///< number of signature bytes left to receive
     struct __mavlink_signing *signing;  ///< optional signing state
     struct __mavlink_signing_streams *signing_streams; ///< global record of stream timestamps
+    struct __mavlink_seq_table *seq_table; ///< optional per stream sequence accounting
+    uint32_t frames_rejected;           ///< Frames dropped for a bad length, CRC or signature, not reset per frame like parse_error
 } mavlink_status_t;
 
 /*
@@ -238,6 +242,11 @@ typedef struct __mavlink_status {
  */
 typedef bool (*mavlink_accept_unsigned_t)(const mavlink_status_t *status, uint32_t msgid);
 
+/*
+  a callback function receiving each complete message found by mavlink_parse_buffer()
+ */
+typedef void (*mavlink_parse_callback_t)(const mavlink_message_t *msg, const mavlink_status_t *status, void *arg);
+
 /*
   flags controlling signing
  */
@@ -253,6 +262,16 @@ typedef enum {
     MAVLINK_SIGNING_STATUS_REPLAY=6,
 } mavlink_signing_status_t;
     
+/*
+  SHA-256 work that only depends on a 32 byte key at the start of the
+  hashed data, see mavlink_sha256_key_init()
+ */
+typedef struct __mavlink_sha256_key_state {
+    uint32_t key_words[8];             ///< the key as message schedule words 0..7
+    uint32_t state[8];                 ///< working variables after the first 8 rounds
+    uint32_t schedule[7];              ///< key-only terms of message schedule words 16..22
+} mavlink_sha256_key_state_t;
+
 /*
   state of MAVLink signing for this channel
  */
@@ -263,6 +282,9 @@ typedef struct __mavlink_signing {
     uint8_t secret_key[32];
     mavlink_accept_unsigned_t accept_unsigned_callback;
     mavlink_signing_status_t last_status;
+    bool key_state_valid;              ///< key_state matches key_state_key, clear to force a recompute
+    uint8_t key_state_key[32];         ///< secret_key that key_state was computed for
+    mavlink_sha256_key_state_t key_state; ///< hashing state cached for secret_key
 } mavlink_signing_t;
 
 /*
@@ -280,8 +302,53 @@ typedef struct __mavlink_signing_streams {
         uint8_t compid;               ///< Remote component ID
         uint8_t timestamp_bytes[6];   ///< Timestamp, in microseconds since UNIX epoch GMT
     } stream[MAVLINK_MAX_SIGNING_STREAMS];
+    struct __mavlink_signing_stream_table *table; ///< if set, streams are kept here instead of in stream[]
 } mavlink_signing_streams_t;
 
+/*
+  open addressing hash table of signing streams, for when there are too
+  many streams for a linear search of mavlink_signing_streams_t. The slots
+  are supplied by the user, see mavlink_signing_stream_table_init()
+ */
+typedef struct __mavlink_signing_stream_slot {
+    uint32_t key;                     ///< 0 if empty, else 1<<24 | link_id<<16 | sysid<<8 | compid
+    uint8_t timestamp_bytes[6];       ///< last timestamp of the stream
+} mavlink_signing_stream_slot_t;
+
+typedef struct __mavlink_signing_stream_table {
+    mavlink_signing_stream_slot_t *slots;
+    uint32_t mask;                    ///< number of slots - 1, a power of two
+    uint32_t count;                   ///< streams in the table
+    uint32_t evicted;                 ///< stale streams dropped to make room
+    uint64_t last_expire;             ///< signing timestamp of the last full sweep for stale streams
+} mavlink_signing_stream_table_t;
+
+/*
+  sequence accounting of one (sysid, compid) stream, see
+  mavlink_seq_table_update()
+ */
+typedef struct __mavlink_seq_stream {
+    uint64_t received;                ///< frames received
+    uint64_t lost;                    ///< sequence numbers skipped and not received since
+    uint64_t duplicate;               ///< frames with a sequence number received just before
+    uint64_t reordered;               ///< frames that arrived after a later sequence number
+    uint64_t history[2];              ///< bit i set if sequence number last_seq - i was received
+    uint32_t key;                     ///< 0 if empty, else 1<<16 | sysid<<8 | compid
+    uint8_t last_seq;                 ///< highest sequence number received
+    uint8_t span;                     ///< sequence numbers covered by history, up to 128
+} mavlink_seq_stream_t;
+
+/*
+  open addressing hash table of sequence streams, the streams are supplied
+  by the user, see mavlink_seq_table_init()
+ */
+typedef struct __mavlink_seq_table {
+    mavlink_seq_stream_t *streams;
+    uint32_t mask;                    ///< number of streams - 1, a power of two
+    uint32_t count;                   ///< streams in use
+    uint64_t untracked;               ///< frames of new streams that did not fit
+} mavlink_seq_table_t;
+
 
 #define MAVLINK_BIG_ENDIAN 0
 #define MAVLINK_LITTLE_ENDIAN 1
@@ -302,6 +369,44 @@ typedef struct __mavlink_msg_entry {
 	uint8_t target_component_ofs; // payload offset to target_component, or 0
 } mavlink_msg_entry_t;
 
+/*
+  rank index over one 256 message ID page of the sorted message entry
+  table. Bit n of bits[] is set if msgid (page<<8)|n is in the table, and
+  base[w] is the table index of the first entry counted in bits[w]
+ */
+typedef struct __mavlink_msg_entry_page {
+	uint16_t base[4];
+	uint64_t bits[4];
+} mavlink_msg_entry_page_t;
+
+/*
+  a message found by mavlink_parse_buffer_view(). Instead of being copied
+  into a mavlink_message_t the view points at the frame in the buffer being
+  parsed, and is only valid until the callback it was passed to returns
+ */
+typedef struct __mavlink_frame_view {
+	uint32_t msgid;          ///< ID of message in payload
+	uint8_t magic;           ///< protocol magic marker
+	uint8_t len;             ///< Length of payload as received
+	uint8_t incompat_flags;  ///< flags that must be understood
+	uint8_t compat_flags;    ///< flags that can be ignored if not understood
+	uint8_t seq;             ///< Sequence of packet
+	uint8_t sysid;           ///< ID of message sender system/aircraft
+	uint8_t compid;          ///< ID of the message sender component
+	uint16_t frame_len;      ///< Length of the whole frame, including checksum and signature
+	const uint8_t *frame;    ///< the frame as received, starting with the magic marker
+	const uint8_t *payload;  ///< payload as received, len bytes
+	const uint8_t *signature;       ///< signature block, or NULL if unsigned
+	const mavlink_msg_entry_t *entry; ///< message entry for msgid
+	mavlink_message_t *scratch;     ///< holds the zero-extended payload once needed
+	bool scratch_valid;             ///< scratch holds the zero-extended payload
+} mavlink_frame_view_t;
+
+/*
+  a callback function receiving each complete message found by mavlink_parse_buffer_view()
+ */
+typedef void (*mavlink_frame_view_callback_t)(mavlink_frame_view_t *view, const mavlink_status_t *status, void *arg);
+
 /*
   incompat_flags bits
  */
@@ -57,10 +57,20 @@
                                                           uint8_t chan, uint8_t min_length, uint8_t length, uint8_t crc_extra);
     MAVLINK_HELPER uint16_t mavlink_finalize_message(mavlink_message_t* msg, uint8_t system_id, uint8_t component_id,
                                                      uint8_t min_length, uint8_t length, uint8_t crc_extra);
+    MAVLINK_HELPER uint16_t mavlink_finalize_message_to_send_buffer(uint8_t *buf, mavlink_status_t* status,
+                                                                    uint8_t system_id, uint8_t component_id,
+                                                                    uint32_t msgid, const char *packet,
+                                                                    uint8_t min_length, uint8_t length, uint8_t crc_extra);
     #ifdef MAVLINK_USE_CONVENIENCE_FUNCTIONS
     MAVLINK_HELPER void _mav_finalize_message_chan_send(mavlink_channel_t chan, uint32_t msgid, const char *packet,
                                                         uint8_t min_length, uint8_t length, uint8_t crc_extra);
     #endif
+    MAVLINK_HELPER void mavlink_seq_table_init(mavlink_seq_table_t *table,
+                                               mavlink_seq_stream_t *streams, uint32_t num_streams);
+    MAVLINK_HELPER const mavlink_seq_stream_t *mavlink_seq_table_find(const mavlink_seq_table_t *table,
+                                                                       uint8_t sysid, uint8_t compid);
+    MAVLINK_HELPER void mavlink_seq_table_update(mavlink_seq_table_t *table, uint8_t sysid, uint8_t compid, uint8_t seq);
+    MAVLINK_HELPER float mavlink_seq_stream_loss_rate(const mavlink_seq_stream_t *stream);
     MAVLINK_HELPER uint16_t mavlink_msg_to_send_buffer(uint8_t *buffer, const mavlink_message_t *msg);
     MAVLINK_HELPER void mavlink_start_checksum(mavlink_message_t* msg);
     MAVLINK_HELPER void mavlink_update_checksum(mavlink_message_t* msg, uint8_t c);
@@ -71,6 +81,18 @@
 						     mavlink_status_t* r_mavlink_status);
     MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_message_t* r_message, mavlink_status_t* r_mavlink_status);
     MAVLINK_HELPER uint8_t mavlink_parse_char(uint8_t chan, uint8_t c, mavlink_message_t* r_message, mavlink_status_t* r_mavlink_status);
+    MAVLINK_HELPER uint32_t mavlink_parse_buffer(mavlink_message_t* rxmsg, mavlink_status_t* status,
+                                                 const uint8_t *buf, uint32_t len,
+                                                 mavlink_parse_callback_t callback, void *arg);
+    MAVLINK_HELPER uint32_t mavlink_parse_buffer_chan(uint8_t chan, const uint8_t *buf, uint32_t len,
+                                                      mavlink_parse_callback_t callback, void *arg);
+    MAVLINK_HELPER uint32_t mavlink_parse_buffer_view(mavlink_message_t* rxmsg, mavlink_status_t* status,
+                                                      const uint8_t *buf, uint32_t len,
+                                                      mavlink_frame_view_callback_t callback, void *arg);
+    MAVLINK_HELPER uint32_t mavlink_parse_buffer_view_chan(uint8_t chan, const uint8_t *buf, uint32_t len,
+                                                           mavlink_frame_view_callback_t callback, void *arg);
+    MAVLINK_HELPER const char *mavlink_frame_view_payload(mavlink_frame_view_t *view);
+    MAVLINK_HELPER void mavlink_frame_view_to_message(mavlink_frame_view_t *view, mavlink_message_t *msg);
     MAVLINK_HELPER uint8_t put_bitfield_n_by_index(int32_t b, uint8_t bits, uint8_t packet_index, uint8_t bit_index,
                                uint8_t* r_bit_index, uint8_t* buffer);
     MAVLINK_HELPER const mavlink_msg_entry_t *mavlink_get_msg_entry(uint32_t msgid);
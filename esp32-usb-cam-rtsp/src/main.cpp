@@ -20,6 +20,10 @@
 #include "OV2640.h"
 #include "OV2640Streamer.h"
 #include "CRtspSession.h"
+#include <stddef.h>
+#include "ardupilotmega/mavlink.h"
+#include "mavlink_routing.h"
+#include "mavlink_sched.h"
 
 // ============================================
 // PIN DEFINITIONS - AI-Thinker ESP32-CAM
@@ -58,6 +62,10 @@ const char* WIFI_PASS = "12345678";
 #define MAVLINK_UART_RX    3   // GPIO3 (U0RXD - shared with USB debug!)
 #define MAVLINK_UART_BAUD  57600
 #define MAVLINK_UDP_PORT   14550
+#define MAVLINK_MAX_GCS    3       // UDP peers (GCS, companion computers), one parser channel each
+#define MAVLINK_GCS_TIMEOUT_MS 10000
+#define MAVLINK_PACKET_SIZE 512    // UART read chunk and largest UDP packet sent
+#define MAVLINK_UART_BURST 320     // bytes handed to the UART at once, about 55 ms at 57600 baud
 
 // Frame rate control - değiştirilebilir ayarlar
 // 33ms = ~30fps, 50ms = ~20fps, 67ms = ~15fps, 100ms = ~10fps
@@ -85,20 +93,35 @@ CRtspSession *session = nullptr;
 WiFiClient rtspClient;
 
 // MAVLink Bridge
+// Endpoint 0 is the Pixhawk UART, endpoint 1+i is gcsPeers[i]
+#define ENDPOINT_UART 0
+
+struct GcsPeer {
+    IPAddress address;
+    uint16_t port;
+    uint32_t lastSeen;
+    bool active;
+    uint16_t txLen;
+    uint8_t txBuffer[MAVLINK_PACKET_SIZE];
+};
+
 WiFiUDP mavlinkUdp;
-IPAddress gcsAddress;
-uint16_t gcsPort = 0;
-bool gcsConnected = false;
-uint8_t mavlinkBuffer[512];
+GcsPeer gcsPeers[MAVLINK_MAX_GCS];
+mavlink_routing_t mavlinkRouting;
+mavlink_sched_t uartSched;  // frames for the Pixhawk, by priority and paced to the baud rate
+uint8_t mavlinkBuffer[MAVLINK_PACKET_SIZE];
 
-// Broadcast address for sending to all connected clients
+// Broadcast address, used until the first GCS has been heard from
 IPAddress broadcastAddress(192, 168, 4, 255);
+uint16_t broadcastTxLen = 0;
+uint8_t broadcastTxBuffer[MAVLINK_PACKET_SIZE];
 
 // Statistics
 uint32_t frameCount = 0;
 uint32_t lastStatsTime = 0;
 uint32_t mavlinkRxBytes = 0;
 uint32_t mavlinkTxBytes = 0;
+uint32_t mavlinkUnroutedFrames = 0;
 
 // ============================================
 // MAVLINK BRIDGE FUNCTIONS
@@ -111,54 +134,182 @@ void mavlinkInit() {
     // Initialize UDP socket for GCS communication
     mavlinkUdp.begin(MAVLINK_UDP_PORT);
     
+    // Stay transparent: frames of messages this build does not know are
+    // still handed to routeFrame, which forwards them to everyone
+    for (int chan = MAVLINK_COMM_0; chan <= MAVLINK_COMM_1 + MAVLINK_MAX_GCS - 1; chan++) {
+        mavlink_get_channel_status(chan)->flags |= MAVLINK_STATUS_FLAG_PASS_UNKNOWN;
+    }
+    mavlink_routing_init(&mavlinkRouting);
+    mavlink_sched_init(&uartSched, MAVLINK_UART_BAUD, MAVLINK_UART_BURST, micros());
+    
     Serial.printf("[MAVLink] UART1 @ %d baud (TX:%d, RX:%d)\n", 
                   MAVLINK_UART_BAUD, MAVLINK_UART_TX, MAVLINK_UART_RX);
     Serial.printf("[MAVLink] UDP port %d\n", MAVLINK_UDP_PORT);
 }
 
+uint32_t activeEndpoints() {
+    uint32_t endpoints = 1UL << ENDPOINT_UART;
+    for (int i = 0; i < MAVLINK_MAX_GCS; i++) {
+        if (gcsPeers[i].active) {
+            endpoints |= 1UL << (1 + i);
+        }
+    }
+    return endpoints;
+}
+
+void flushPacket(IPAddress address, uint16_t port, uint8_t *buffer, uint16_t &len) {
+    if (len > 0) {
+        mavlinkUdp.beginPacket(address, port);
+        mavlinkUdp.write(buffer, len);
+        mavlinkUdp.endPacket();
+        len = 0;
+    }
+}
+
+// Queue a frame for a UDP peer, frames are batched into as few packets as possible
+void queueFrame(uint8_t *buffer, uint16_t &len, IPAddress address, uint16_t port,
+                const mavlink_frame_view_t *view) {
+    if (len + view->frame_len > MAVLINK_PACKET_SIZE) {
+        flushPacket(address, port, buffer, len);
+    }
+    memcpy(&buffer[len], view->frame, view->frame_len);
+    len += view->frame_len;
+}
+
+void flushPeers() {
+    for (int i = 0; i < MAVLINK_MAX_GCS; i++) {
+        GcsPeer &peer = gcsPeers[i];
+        if (peer.active) {
+            flushPacket(peer.address, peer.port, peer.txBuffer, peer.txLen);
+        }
+    }
+    flushPacket(broadcastAddress, MAVLINK_UDP_PORT, broadcastTxBuffer, broadcastTxLen);
+}
+
+// Called for every complete frame, arg is the endpoint it came from
+void routeFrame(mavlink_frame_view_t *view, const mavlink_status_t *status, void *arg) {
+    uint8_t src = (uint8_t)(uintptr_t)arg;
+    uint32_t all = activeEndpoints();
+    uint32_t endpoints;
+    if (view->entry == NULL) {
+        // Not in our dialect, so no target and an unchecked CRC: pass the
+        // raw frame to all other endpoints and learn no route from it
+        endpoints = all & ~(1UL << src);
+    } else {
+        endpoints = mavlink_routing_route_view(&mavlinkRouting, all, src, view);
+    }
+    
+    if (endpoints == 0) {
+        if (src == ENDPOINT_UART && all == (1UL << ENDPOINT_UART)) {
+            // No GCS yet: broadcast so it can find us
+            queueFrame(broadcastTxBuffer, broadcastTxLen, broadcastAddress, MAVLINK_UDP_PORT, view);
+        } else {
+            mavlinkUnroutedFrames++;
+        }
+        return;
+    }
+    if (endpoints & (1UL << ENDPOINT_UART)) {
+        mavlink_sched_enqueue(&uartSched, view, micros());
+    }
+    for (int i = 0; i < MAVLINK_MAX_GCS; i++) {
+        GcsPeer &peer = gcsPeers[i];
+        if (endpoints & (1UL << (1 + i))) {
+            queueFrame(peer.txBuffer, peer.txLen, peer.address, peer.port, view);
+        }
+    }
+}
+
+// Find the peer slot for a sender, taking a free or the least recently seen slot
+int findPeer(IPAddress address, uint16_t port) {
+    int slot = -1;
+    for (int i = 0; i < MAVLINK_MAX_GCS; i++) {
+        GcsPeer &peer = gcsPeers[i];
+        if (peer.active && peer.address == address && peer.port == port) {
+            return i;
+        }
+    }
+    for (int i = 0; i < MAVLINK_MAX_GCS; i++) {
+        if (!gcsPeers[i].active) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || gcsPeers[i].lastSeen < gcsPeers[slot].lastSeen) {
+            slot = i;
+        }
+    }
+    GcsPeer &peer = gcsPeers[slot];
+    if (peer.active) {
+        flushPacket(peer.address, peer.port, peer.txBuffer, peer.txLen);
+        mavlink_routing_forget_endpoint(&mavlinkRouting, 1 + slot);
+        Serial.printf("[MAVLink] GCS replaced: %s:%d\n", peer.address.toString().c_str(), peer.port);
+    }
+    peer.address = address;
+    peer.port = port;
+    peer.active = true;
+    peer.txLen = 0;
+    mavlink_reset_channel_status(MAVLINK_COMM_1 + slot);
+    Serial.printf("[MAVLink] GCS connected: %s:%d\n", address.toString().c_str(), port);
+    return slot;
+}
+
+void expirePeers() {
+    uint32_t now = millis();
+    for (int i = 0; i < MAVLINK_MAX_GCS; i++) {
+        GcsPeer &peer = gcsPeers[i];
+        if (peer.active && now - peer.lastSeen > MAVLINK_GCS_TIMEOUT_MS) {
+            peer.active = false;
+            mavlink_routing_forget_endpoint(&mavlinkRouting, 1 + i);
+            Serial.printf("[MAVLink] GCS timed out: %s:%d\n", peer.address.toString().c_str(), peer.port);
+        }
+    }
+}
+
+int activePeerCount() {
+    int count = 0;
+    for (int i = 0; i < MAVLINK_MAX_GCS; i++) {
+        count += gcsPeers[i].active ? 1 : 0;
+    }
+    return count;
+}
+
 void mavlinkLoop() {
     // ===== UART -> UDP (Pixhawk to GCS) =====
-    // Broadcast to all clients OR send to specific GCS if connected
+    // Each frame only goes to the peers behind its target, broadcasts go to all
     int available = Serial1.available();
     if (available > 0) {
         int len = Serial1.readBytes(mavlinkBuffer, min(available, (int)sizeof(mavlinkBuffer)));
         if (len > 0) {
             mavlinkRxBytes += len;  // Track received bytes from Pixhawk
-            
-            if (gcsConnected) {
-                // Send to specific GCS address
-                mavlinkUdp.beginPacket(gcsAddress, gcsPort);
-            } else {
-                // Broadcast to all clients on the network
-                mavlinkUdp.beginPacket(broadcastAddress, MAVLINK_UDP_PORT);
-            }
-            mavlinkUdp.write(mavlinkBuffer, len);
-            mavlinkUdp.endPacket();
+            mavlink_parse_buffer_view_chan(MAVLINK_COMM_0, mavlinkBuffer, len,
+                                           routeFrame, (void *)(uintptr_t)ENDPOINT_UART);
         }
     }
     
-    // ===== UDP -> UART (GCS to Pixhawk) =====
+    // ===== UDP -> UART (GCS to Pixhawk, or to another peer) =====
     int packetSize = mavlinkUdp.parsePacket();
     if (packetSize > 0) {
-        // Store GCS address on first packet or address change
-        IPAddress remoteIP = mavlinkUdp.remoteIP();
-        uint16_t remotePort = mavlinkUdp.remotePort();
-        
-        if (!gcsConnected || gcsAddress != remoteIP || gcsPort != remotePort) {
-            gcsAddress = remoteIP;
-            gcsPort = remotePort;
-            gcsConnected = true;
-            Serial.printf("[MAVLink] GCS connected: %s:%d\n", 
-                         gcsAddress.toString().c_str(), gcsPort);
-        }
+        int slot = findPeer(mavlinkUdp.remoteIP(), mavlinkUdp.remotePort());
+        gcsPeers[slot].lastSeen = millis();
         
-        // Forward to Pixhawk via UART
         int len = mavlinkUdp.read(mavlinkBuffer, sizeof(mavlinkBuffer));
         if (len > 0) {
-            mavlinkTxBytes += len;  // Track sent bytes to Pixhawk
-            Serial1.write(mavlinkBuffer, len);
+            mavlink_parse_buffer_view_chan(MAVLINK_COMM_1 + slot, mavlinkBuffer, len,
+                                           routeFrame, (void *)(uintptr_t)(1 + slot));
         }
     }
+    
+    // ===== Scheduled frames -> UART =====
+    // Commands first, and never more than the line can take, so the UART
+    // buffer cannot hold a command back behind a parameter or mission burst
+    uint16_t frameLen;
+    const uint8_t *frame;
+    while ((frame = mavlink_sched_next(&uartSched, micros(), &frameLen)) != NULL) {
+        mavlinkTxBytes += frameLen;  // Track sent bytes to Pixhawk
+        Serial1.write(frame, frameLen);
+    }
+    
+    flushPeers();
+    expirePeers();
 }
 
 // ============================================
@@ -249,22 +400,50 @@ void handleRTSP() {
 // ============================================
 // STATISTICS
 // ============================================
+// Per class frame counts and queueing latency since the last report
+void printUartSchedStats() {
+    static const char *names[MAVLINK_SCHED_NUM_CLASSES] = {"command", "control", "normal", "bulk"};
+    for (int c = 0; c < MAVLINK_SCHED_NUM_CLASSES; c++) {
+        mavlink_sched_class_stats_t &stats = uartSched.queue[c].stats;
+        if (stats.queued == 0 && stats.dropped == 0) {
+            continue;
+        }
+        Serial.printf("[UART] %-7s sent: %u, coalesced: %u, dropped: %u, wait ms:",
+                      names[c], stats.sent, stats.coalesced, stats.dropped);
+        for (int i = 0; i < MAVLINK_SCHED_HIST_BUCKETS; i++) {
+            if (stats.latency[i] == 0) {
+                continue;
+            }
+            uint32_t bound = mavlink_sched_bucket_ms(i);
+            if (bound != 0) {
+                Serial.printf(" <%u:%u", bound, stats.latency[i]);
+            } else {
+                Serial.printf(" more:%u", stats.latency[i]);
+            }
+        }
+        Serial.println();
+        memset(&stats, 0, sizeof(stats));
+    }
+}
+
 void printStats() {
     uint32_t now = millis();
     if (now - lastStatsTime >= 10000) {  // Every 10 seconds
         float fps = frameCount * 1000.0f / (now - lastStatsTime);
-        Serial.printf("[Stats] FPS: %.1f, Heap: %d KB, RTSP: %d, GCS: %s\n",
+        Serial.printf("[Stats] FPS: %.1f, Heap: %d KB, RTSP: %d, GCS: %d\n",
                      fps,
                      ESP.getFreeHeap() / 1024,
                      session ? 1 : 0,
-                     gcsConnected ? "Yes" : "No");
-        Serial.printf("[MAVLink] RX from Pixhawk: %d bytes, TX to Pixhawk: %d bytes\n",
-                     mavlinkRxBytes, mavlinkTxBytes);
+                     activePeerCount());
+        Serial.printf("[MAVLink] RX from Pixhawk: %d bytes, TX to Pixhawk: %d bytes, unrouted: %d frames, routes: %d\n",
+                     mavlinkRxBytes, mavlinkTxBytes, mavlinkUnroutedFrames, mavlinkRouting.num_routes);
+        printUartSchedStats();
         
         // Reset counters
         frameCount = 0;
         mavlinkRxBytes = 0;
         mavlinkTxBytes = 0;
+        mavlinkUnroutedFrames = 0;
         lastStatsTime = now;
     }
 }
@@ -0,0 +1,82 @@
+/**
+ * @file attitude_batch.h
+ * @brief Quaternion / rotation matrix / Euler angle conversions of whole
+ * arrays of samples
+ */
+
+#ifndef MAVLINK_GATEWAY_ATTITUDE_BATCH_H
+#define MAVLINK_GATEWAY_ATTITUDE_BATCH_H
+
+#include "gateway_mavlink.h"
+
+namespace mavlink {
+
+enum class AttitudeImpl {
+    scalar,    ///< the mavlink_conversions.h functions, one sample at a time
+    simd128,   ///< 4 samples at a time in SSE2 or NEON registers
+    avx2,      ///< 8 samples at a time in AVX2 registers, with FMA
+};
+
+/**
+ * @brief The conversions of mavlink_conversions.h over arrays of samples,
+ * e.g. the q1..q4 columns of ATTITUDE_QUATERNION for a whole flight
+ *
+ * Inputs and outputs are one array per component: q = {w, x, y, z},
+ * dcm = {dcm[0][0], dcm[0][1], ... dcm[2][2]} row by row. Quaternion
+ * inputs take a stride, 4 for array fields such as ODOMETRY.q whose
+ * elements are interleaved: q = {p, p + 1, p + 2, p + 3}.
+ *
+ * The SIMD implementations run one kernel, written with GCC / Clang vector
+ * types, at both widths; they differ only in FMA rounding. atan2, sin and
+ * cos are polynomial approximations (cephes atanf / sinf / cosf), the
+ * square root is a Newton iteration. Measured over 10M random rotations,
+ * 2% of them within 0.1 rad of gimbal lock, angles stay within 6e-7 rad
+ * and quaternion / matrix elements within 2e-7 of the exact values for
+ * the float inputs. Where they differ from the scalar functions:
+ *   - they work in float throughout
+ *   - pitch is atan2(sin, cos) rather than asinf(sin), which loses up to
+ *     4.5e-4 rad near +-90 degrees and is NaN for quaternions slightly
+ *     longer than 1
+ *   - quaternion_to_euler() takes the angles from half angle sums of the
+ *     quaternion, which keep their precision near gimbal lock where the
+ *     rotation matrix elements do not
+ *   - in gimbal lock (within 1e-3 rad of +-90 degrees pitch, as the scalar
+ *     functions) roll is 0 and yaw is yaw - roll at +90 degrees, yaw + roll
+ *     at -90 degrees. The scalar functions take the yaw at -90 degrees from
+ *     two matrix elements that are both 0 there.
+ * Angles given to euler_to_quaternion() and euler_to_dcm() must be within
+ * +-1e4 rad.
+ */
+class AttitudeConverter {
+public:
+    /**
+     * @brief Fastest implementation this CPU supports
+     */
+    static AttitudeImpl best_impl();
+
+    static const char *impl_name(AttitudeImpl impl);
+
+    /**
+     * @param impl implementation to use, falls back to the fastest one
+     * this CPU supports if it does not support impl
+     */
+    explicit AttitudeConverter(AttitudeImpl impl = best_impl());
+
+    AttitudeImpl impl() const { return impl_; }
+
+    void quaternion_to_dcm(const float *const q[4], size_t count, float *const dcm[9], size_t stride = 1) const;
+    void quaternion_to_euler(const float *const q[4], size_t count, float *roll, float *pitch, float *yaw,
+                             size_t stride = 1) const;
+    void dcm_to_euler(const float *const dcm[9], size_t count, float *roll, float *pitch, float *yaw) const;
+    void euler_to_quaternion(const float *roll, const float *pitch, const float *yaw, size_t count,
+                             float *const q[4]) const;
+    void euler_to_dcm(const float *roll, const float *pitch, const float *yaw, size_t count,
+                      float *const dcm[9]) const;
+
+private:
+    AttitudeImpl impl_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_ATTITUDE_BATCH_H
@@ -0,0 +1,97 @@
+/**
+ * @file batch_decode.h
+ * @brief Decoding of many frames of one message into arrays per field
+ */
+
+#ifndef MAVLINK_GATEWAY_BATCH_DECODE_H
+#define MAVLINK_GATEWAY_BATCH_DECODE_H
+
+#include "gateway_mavlink.h"
+
+#include <string_view>
+#include <vector>
+
+namespace mavlink {
+
+enum class DecodeImpl {
+    scalar,   ///< one frame at a time, on any host
+    avx2,     ///< 8 frames at a time, payloads transposed in AVX2 registers
+};
+
+/**
+ * @brief Decodes runs of frames of one message, e.g. 400 Hz ATTITUDE or
+ * SCALED_IMU from a log, into one array per field
+ *
+ * Field i of the message info gets columns[i]: count values of the field's
+ * type, or count * array_length for array fields (row after row). Payloads
+ * trimmed by MAVLink 2 decode as if their missing bytes were zero, like
+ * the generated decode functions.
+ *
+ * The AVX2 implementation loads 32 byte chunks of 8 payloads (masked, so
+ * nothing past a payload is read), transposes them so each register holds
+ * one 4 byte word of all 8, and shuffles the fields out of the words.
+ * Fields not aligned to their size, which only happens in extensions, and
+ * array fields are read one by one. The scalar implementation reads one
+ * value at a time and swaps its bytes on big endian hosts.
+ */
+class BatchDecoder {
+public:
+    /**
+     * @brief Fastest implementation this CPU supports
+     */
+    static DecodeImpl best_impl();
+
+    static const char *impl_name(DecodeImpl impl);
+
+    /**
+     * @param msgid message to decode, see valid()
+     * @param impl implementation to use, falls back to scalar if the CPU
+     * does not support it
+     */
+    explicit BatchDecoder(uint32_t msgid, DecodeImpl impl = best_impl());
+
+    /**
+     * @brief False if the message has no info in this dialect, or a field
+     * of a type field_type_size() does not know
+     */
+    bool valid() const { return info_ != nullptr; }
+
+    DecodeImpl impl() const { return impl_; }
+    const mavlink_message_info_t &info() const { return *info_; }
+
+    /**
+     * @brief Index of a field in info() and so in columns, -1 if there is
+     * no such field
+     */
+    int field_index(std::string_view name) const;
+
+    /**
+     * @brief Decode frames into columns
+     *
+     * @param views frames, e.g. collected from Parser::parse()
+     * @param columns one per field of info(), nullptr for fields not wanted
+     * @return number of frames decoded, which stops short at the first
+     *         frame of another message
+     */
+    size_t decode(const mavlink_frame_view_t *views, size_t count, void *const *columns) const;
+
+private:
+    struct Element {
+        uint16_t offset;      // in the payload
+        uint8_t size;         // bytes
+        uint8_t field;        // index in info_->fields
+        uint16_t index;       // element of an array field, 0 otherwise
+        uint16_t width;       // elements per row of the column
+        bool simd;            // a scalar aligned to its size, taken from the transposed words
+    };
+
+    void decode_scalar(const mavlink_frame_view_t *views, size_t count, void *const *columns, size_t row) const;
+
+    const mavlink_message_info_t *info_ = nullptr;
+    DecodeImpl impl_;
+    std::vector<Element> elements_;   // every value of a row, by offset
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_BATCH_DECODE_H
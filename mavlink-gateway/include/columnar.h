@@ -0,0 +1,211 @@
+/**
+ * @file columnar.h
+ * @brief Per field time series extracted from frames through the message
+ * info tables, and a column file to keep them in
+ *
+ * A column file holds one column per (message, field), named like
+ * "ATTITUDE.roll", plus "MESSAGE.time_us", "MESSAGE.sysid" and
+ * "MESSAGE.compid" for every message extracted. Row i of all columns of a
+ * message comes from the same frame. Layout, all little endian:
+ *
+ *     ColumnFile::Header
+ *     ColumnFile::Column[columns]
+ *     column data, each starting on a 64 byte boundary
+ *
+ * Column data is the values back to back in their MAVLink type, so a
+ * mapped file can be used in place, e.g. as a float array for
+ * "ATTITUDE.roll". An array field of n elements has n values per row.
+ */
+
+#ifndef MAVLINK_GATEWAY_COLUMNAR_H
+#define MAVLINK_GATEWAY_COLUMNAR_H
+
+#include "gateway_mavlink.h"
+#include "message_index.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if MAVLINK_NEED_BYTE_SWAP
+#error "columns are copied straight from the wire, which needs a little endian host"
+#endif
+
+namespace mavlink {
+
+/**
+ * @brief Decodes frames into one growing column per (message, field)
+ *
+ * The first frame of each message compiles a copy plan from its
+ * mavlink_message_info_t: one (wire offset, size, column) step per field,
+ * grouped into runs of 8, 4, 2 and 1 byte fields and one of arrays.
+ * Every frame then takes one copy of the payload into a zero filled buffer,
+ * restoring the bytes trimmed by MAVLink 2, and one fixed size copy per
+ * field into the tail of its column. There is no per field type dispatch
+ * and no decode into the generated structs. Not thread safe.
+ */
+class ColumnExtractor {
+public:
+    ColumnExtractor() = default;
+
+    ColumnExtractor(const ColumnExtractor &) = delete;
+    ColumnExtractor &operator=(const ColumnExtractor &) = delete;
+
+    /**
+     * @brief Extract only the selected messages, all of them if none are
+     * selected. Only allowed before the first frame.
+     * @return false for a message without info in this dialect
+     */
+    bool select(uint32_t msgid);
+    bool select(std::string_view message);
+
+    /**
+     * @brief Add a frame found by the parser
+     * @return false if its message is not extracted
+     */
+    bool add(uint64_t time_us, const mavlink_frame_view_t &view);
+
+    /**
+     * @brief Add a frame from a log without checking it, e.g. from ReplayReader
+     * @return false if it is not a frame or its message is not extracted
+     */
+    bool add(uint64_t time_us, const uint8_t *frame, uint16_t len);
+
+    /**
+     * @brief Rows extracted for a message
+     */
+    uint64_t rows(uint32_t msgid) const;
+
+    uint64_t frames() const { return frames_; }
+    uint64_t skipped() const { return skipped_; }
+
+    /**
+     * @brief Call f(const mavlink_message_info_t &, uint64_t rows) for each
+     * message extracted, in the order they were first seen
+     */
+    template <typename F>
+    void for_each_message(F &&f) const
+    {
+        for (const Table &table : tables_) {
+            f(*table.info, table.rows);
+        }
+    }
+
+    /**
+     * @brief Write every column to a column file
+     */
+    bool write(const std::string &path) const;
+
+    /**
+     * @brief Drop all rows, keeping the selection and copy plans
+     */
+    void clear();
+
+private:
+    struct Column {
+        std::string name;            // MESSAGE.field
+        uint32_t msgid;
+        mavlink_message_type_t type;
+        uint16_t width;              // values per row
+        uint32_t row_bytes;
+        std::vector<uint8_t> data;   // capacity rows of row_bytes, rows in use
+    };
+
+    struct CopyStep {
+        uint16_t offset;             // in the staged frame, see append()
+        uint16_t size;
+        uint32_t column;
+        uint8_t *base = nullptr;     // column data, updated by grow()
+    };
+
+    struct Table {
+        const mavlink_message_info_t *info;
+        uint8_t max_len;             // payload length with all extensions
+        uint32_t first_column;       // time_us, sysid, compid, then the fields
+        std::vector<CopyStep> plan;  // by size, then by offset
+        uint16_t runs[4] = {};       // steps of 8, 4, 2 and 1 bytes, arrays follow
+        uint64_t rows = 0;
+        uint64_t capacity = 0;
+    };
+
+    Table *table_for(uint32_t msgid);
+    uint32_t compile(uint32_t msgid);
+    void add_column(const std::string &name, uint32_t msgid, mavlink_message_type_t type, uint16_t width);
+    void grow(Table &table);
+    bool append(Table &table, uint64_t time_us, uint8_t sysid, uint8_t compid, const uint8_t *payload, uint8_t len);
+
+    std::vector<Table> tables_;
+    std::vector<Column> columns_;
+    // table index by msgid, direct for the common ids, hashed for the rest
+    std::vector<uint32_t> low_tables_;
+    std::unordered_map<uint32_t, uint32_t> high_tables_;
+    std::vector<uint32_t> selected_;
+    uint64_t frames_ = 0;
+    uint64_t skipped_ = 0;
+};
+
+/**
+ * @brief Read only view of a column file written by ColumnExtractor
+ */
+class ColumnFile {
+public:
+    struct Header {
+        uint8_t magic[8];        ///< "MAVCOL01"
+        uint32_t version;
+        uint32_t columns;
+        uint8_t reserved[48];
+    };
+
+    struct Column {
+        char name[64];           ///< MESSAGE.field, nul terminated
+        uint32_t msgid;
+        uint8_t type;            ///< mavlink_message_type_t
+        uint8_t reserved;
+        uint16_t width;          ///< values per row
+        uint64_t rows;
+        uint64_t offset;         ///< of the data in the file
+        uint64_t bytes;
+    };
+
+    ColumnFile() = default;
+    ~ColumnFile();
+
+    ColumnFile(const ColumnFile &) = delete;
+    ColumnFile &operator=(const ColumnFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    size_t size() const { return num_columns_; }
+    const Column &column(size_t i) const { return columns_[i]; }
+
+    /**
+     * @brief Column by name, e.g. "ATTITUDE.roll", nullptr if there is none
+     */
+    const Column *find(std::string_view name) const;
+
+    /**
+     * @brief Values of a column, rows * width of them, valid while the file
+     * is open
+     * @return nullptr if T does not have the size of the column's type
+     */
+    template <typename T>
+    const T *values(const Column &column) const
+    {
+        if (sizeof(T) != field_type_size(mavlink_message_type_t(column.type))) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T *>(map_ + column.offset);
+    }
+
+private:
+    const uint8_t *map_ = nullptr;
+    size_t map_len_ = 0;
+    const Column *columns_ = nullptr;
+    size_t num_columns_ = 0;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_COLUMNAR_H
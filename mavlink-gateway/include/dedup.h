@@ -0,0 +1,91 @@
+/**
+ * @file dedup.h
+ * @brief Drops copies of frames that arrive over redundant links
+ */
+
+#ifndef MAVLINK_GATEWAY_DEDUP_H
+#define MAVLINK_GATEWAY_DEDUP_H
+
+#include "gateway_mavlink.h"
+
+#include <chrono>
+#include <vector>
+
+namespace mavlink {
+
+/**
+ * @brief Remembers the frames of the last window and reports whether a
+ * frame is the first copy
+ *
+ * A frame is identified by (sysid, compid, msgid, seq, checksum), packed
+ * into 64 bits. Recent keys sit in a ring in arrival order, indexed by an
+ * open addressing hash table, so a lookup is one probe run and keys leave
+ * from the tail of the ring once they are older than window or the ring is
+ * full. Not thread safe.
+ */
+class Deduplicator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param window how long a copy is expected to lag behind the first
+     * @param capacity most frames remembered, the oldest are forgotten first
+     */
+    explicit Deduplicator(std::chrono::milliseconds window = std::chrono::milliseconds(500),
+                          uint32_t capacity = 4096);
+    Deduplicator(const Deduplicator &) = delete;
+    Deduplicator &operator=(const Deduplicator &) = delete;
+
+    /**
+     * @brief Whether this is the first copy of the frame within window,
+     * remembering it if so
+     */
+    bool first(uint64_t key, Clock::time_point now);
+    bool first(const mavlink_frame_view_t &view, Clock::time_point now) { return first(key_of(view), now); }
+
+    static uint64_t key_of(const mavlink_frame_view_t &view)
+    {
+        return make_key(view.sysid, view.compid, view.msgid, view.seq,
+                        uint16_t(view.payload[view.len] | (view.payload[view.len + 1] << 8)));
+    }
+
+    /**
+     * @brief Key of a complete MAVLink 1 or 2 frame
+     */
+    static uint64_t key_of(const uint8_t *frame);
+
+    static uint64_t make_key(uint8_t sysid, uint8_t compid, uint32_t msgid, uint8_t seq, uint16_t checksum)
+    {
+        return (uint64_t(sysid) << 56) | (uint64_t(compid) << 48) | (uint64_t(seq) << 40) |
+               (uint64_t(checksum) << 24) | (msgid & 0xffffff);
+    }
+
+    uint64_t duplicates() const { return duplicates_; }
+    size_t size() const { return count_; }
+
+private:
+    struct Entry {
+        uint64_t key;
+        Clock::time_point time;
+    };
+
+    struct Slot {
+        uint64_t key;
+        uint32_t pos;   // ring position + 1, 0 if empty
+    };
+
+    size_t home(uint64_t key) const;
+    void pop_oldest();
+
+    Clock::duration window_;
+    std::vector<Entry> ring_;
+    size_t head_ = 0;    // oldest entry
+    size_t count_ = 0;
+    std::vector<Slot> index_;
+    size_t mask_;
+    uint64_t duplicates_ = 0;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_DEDUP_H
@@ -0,0 +1,95 @@
+/**
+ * @file egress.h
+ * @brief Batches outgoing frames into datagrams per link
+ */
+
+#ifndef MAVLINK_GATEWAY_EGRESS_H
+#define MAVLINK_GATEWAY_EGRESS_H
+
+#include "link.h"
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace mavlink {
+
+struct EgressConfig {
+    size_t mtu = 1400;                ///< largest datagram, at least MAVLINK_MAX_PACKET_LEN
+    std::chrono::microseconds max_delay{500}; ///< longest a frame waits for company
+    size_t max_datagrams = 32;        ///< datagrams queued per link before it is flushed
+};
+
+struct EgressStats {
+    uint64_t frames = 0;     ///< frames in datagrams that were sent
+    uint64_t datagrams = 0;  ///< datagrams sent
+    uint64_t flushes = 0;    ///< Link::write_datagrams() calls
+    uint64_t dropped = 0;    ///< frames in datagrams the link did not take
+};
+
+/**
+ * @brief Packs frames for each link into datagrams of up to mtu bytes
+ *
+ * Frames are never split, a datagram is closed when the next frame does not
+ * fit. A link is flushed with one Link::write_datagrams() call (sendmmsg()
+ * for UDP) when max_datagrams are queued or when its oldest frame has waited
+ * max_delay, so the number of system calls no longer grows with the number
+ * of frames. Not thread safe, meant to be owned by one writer thread.
+ */
+class EgressBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit EgressBatcher(const EgressConfig &config = EgressConfig());
+    EgressBatcher(const EgressBatcher &) = delete;
+    EgressBatcher &operator=(const EgressBatcher &) = delete;
+
+    /**
+     * @brief Queue a frame for link
+     * @return frames sent, if the link had to be flushed to make room
+     */
+    size_t add(Link &link, const uint8_t *frame, size_t len, Clock::time_point now);
+
+    /**
+     * @brief Flush links whose oldest frame has waited max_delay
+     * @return frames sent
+     */
+    size_t flush_due(Clock::time_point now);
+
+    /**
+     * @brief Flush all links
+     * @return frames sent
+     */
+    size_t flush();
+
+    /**
+     * @brief Earliest deadline of a queued frame, Clock::time_point::max() if none
+     */
+    Clock::time_point next_deadline() const;
+
+    const EgressStats &stats() const { return stats_; }
+
+private:
+    struct Queue {
+        Link *link = nullptr;
+        std::vector<uint8_t> buf;
+        std::vector<struct iovec> datagrams;  // closed datagrams, then the open one
+        std::vector<uint32_t> frames;         // frames in each datagram
+        size_t used = 0;                      // bytes in buf
+        Clock::time_point deadline;
+        bool active = false;
+    };
+
+    Queue &queue_for(Link &link);
+    size_t send(Queue &queue);
+
+    EgressConfig config_;
+    std::unordered_map<Link *, std::unique_ptr<Queue>> queues_;
+    std::vector<Queue *> active_;
+    EgressStats stats_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_EGRESS_H
@@ -0,0 +1,38 @@
+/**
+ * @file gateway_mavlink.h
+ * @brief MAVLink C library as used by the gateway (ardupilotmega dialect)
+ */
+
+#ifndef GATEWAY_MAVLINK_H
+#define GATEWAY_MAVLINK_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ardupilotmega/mavlink.h"
+#include "mavlink_routing.h"
+#include "mavlink_sched.h"
+
+namespace mavlink {
+
+/**
+ * @brief Length of the MAVLink 1 or 2 frame starting at p, signature included
+ * @param avail bytes available from p
+ * @return 0 if p does not start with a magic byte or the frame is not all there
+ */
+inline size_t frame_length(const uint8_t *p, size_t avail)
+{
+    size_t len;
+    if (avail >= MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 && p[0] == MAVLINK_STX_MAVLINK1) {
+        len = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + p[1] + MAVLINK_NUM_CHECKSUM_BYTES;
+    } else if (avail >= MAVLINK_NUM_HEADER_BYTES && p[0] == MAVLINK_STX) {
+        len = MAVLINK_NUM_NON_PAYLOAD_BYTES + p[1] + ((p[2] & MAVLINK_IFLAG_SIGNED) ? MAVLINK_SIGNATURE_BLOCK_LEN : 0);
+    } else {
+        return 0;
+    }
+    return len <= avail ? len : 0;
+}
+
+} // namespace mavlink
+
+#endif // GATEWAY_MAVLINK_H
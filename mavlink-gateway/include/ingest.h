@@ -0,0 +1,68 @@
+/**
+ * @file ingest.h
+ * @brief Reads many datagrams per call and parses them in place
+ */
+
+#ifndef MAVLINK_GATEWAY_INGEST_H
+#define MAVLINK_GATEWAY_INGEST_H
+
+#include "link.h"
+#include "parser.h"
+
+#include <vector>
+
+namespace mavlink {
+
+/**
+ * @brief Receive buffers for Link::read_datagrams(), set up once and reused
+ *
+ * The buffers are one block of batch * datagram_size bytes, with the iovecs
+ * pointing into it built in the constructor, so a read is one recvmmsg()
+ * for a UDP link and nothing is allocated or copied between the socket and
+ * the parser: each datagram is parsed where the kernel put it. Datagrams
+ * longer than datagram_size are truncated. Not thread safe, meant to be
+ * owned by one worker thread and used for all its links.
+ */
+class DatagramReader {
+public:
+    explicit DatagramReader(size_t batch = 64, size_t datagram_size = 2048)
+        : buf_((batch > 0 ? batch : 1) * datagram_size),
+          datagrams_(batch > 0 ? batch : 1),
+          lens_(datagrams_.size())
+    {
+        for (size_t i = 0; i < datagrams_.size(); i++) {
+            datagrams_[i].iov_base = &buf_[i * datagram_size];
+            datagrams_[i].iov_len = datagram_size;
+        }
+    }
+
+    DatagramReader(const DatagramReader &) = delete;
+    DatagramReader &operator=(const DatagramReader &) = delete;
+
+    /**
+     * @brief Read one batch of datagrams from link and parse them in order
+     *
+     * on_frame is called as for Parser::parse().
+     * @return number of datagrams read, 0 if nothing was available, -1 on error
+     */
+    template <typename F>
+    ssize_t read(Link &link, Parser &parser, F &&on_frame)
+    {
+        const ssize_t n = link.read_datagrams(datagrams_.data(), datagrams_.size(), lens_.data());
+        for (ssize_t i = 0; i < n; i++) {
+            parser.parse(static_cast<const uint8_t *>(datagrams_[i].iov_base), uint32_t(lens_[i]), on_frame);
+        }
+        return n;
+    }
+
+    size_t batch() const { return datagrams_.size(); }
+
+private:
+    std::vector<uint8_t> buf_;
+    std::vector<struct iovec> datagrams_;
+    std::vector<size_t> lens_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_INGEST_H
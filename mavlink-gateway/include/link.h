@@ -0,0 +1,178 @@
+/**
+ * @file link.h
+ * @brief Byte stream / datagram endpoints served by the router
+ */
+
+#ifndef MAVLINK_GATEWAY_LINK_H
+#define MAVLINK_GATEWAY_LINK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+struct sockaddr_in;
+
+namespace mavlink {
+
+/**
+ * @brief One MAVLink endpoint
+ *
+ * The router reads a link from exactly one worker thread and writes it from
+ * exactly one writer thread, so implementations only need to be safe for
+ * one concurrent reader and one concurrent writer.
+ */
+class Link {
+public:
+    virtual ~Link() = default;
+
+    /**
+     * @brief Read whatever is available without blocking
+     * @return number of bytes read, 0 if nothing was available, -1 on error
+     */
+    virtual ssize_t read(uint8_t *buf, size_t len) = 0;
+
+    /**
+     * @brief Read up to count datagrams without blocking, datagram i into
+     * datagrams[i] and its length into lens[i]
+     *
+     * The default fills the buffers one by one with read().
+     * @return number of datagrams read, 0 if nothing was available, -1 on error
+     */
+    virtual ssize_t read_datagrams(const struct iovec *datagrams, size_t count, size_t *lens);
+
+    /**
+     * @brief Send one complete frame
+     */
+    virtual bool write(const uint8_t *buf, size_t len) = 0;
+
+    /**
+     * @brief Send several datagrams, each holding one or more complete frames
+     *
+     * The default sends them one by one with write().
+     * @return number of datagrams sent, counting from the first
+     */
+    virtual size_t write_datagrams(const struct iovec *datagrams, size_t count);
+
+    /**
+     * @brief Descriptor to wait on for input, or -1 if the link has to be polled
+     */
+    virtual int fd() const { return -1; }
+
+    virtual std::string name() const = 0;
+};
+
+/**
+ * @brief UDP endpoint
+ *
+ * Sends to a fixed peer if one is given, otherwise to whoever sent the last
+ * datagram (the usual behaviour towards a GCS).
+ */
+class UdpLink : public Link {
+public:
+    /**
+     * @param local_port port to bind, 0 for any
+     * @param remote_host peer address, empty to learn it from incoming datagrams
+     */
+    UdpLink(uint16_t local_port, const std::string &remote_host = std::string(), uint16_t remote_port = 0);
+    ~UdpLink() override;
+
+    UdpLink(const UdpLink &) = delete;
+    UdpLink &operator=(const UdpLink &) = delete;
+
+    bool is_open() const { return sock_ >= 0; }
+
+    ssize_t read(uint8_t *buf, size_t len) override;
+    ssize_t read_datagrams(const struct iovec *datagrams, size_t count, size_t *lens) override;
+    bool write(const uint8_t *buf, size_t len) override;
+    size_t write_datagrams(const struct iovec *datagrams, size_t count) override;
+    int fd() const override { return sock_; }
+    std::string name() const override;
+
+private:
+    void learn_peer(const struct sockaddr_in &from);
+
+    int sock_ = -1;
+    uint16_t local_port_;
+    bool fixed_peer_ = false;
+    // valid bit, port and IPv4 address of the peer, packed so the writer
+    // sees a consistent value while the reader learns a new peer
+    std::atomic<uint64_t> peer_{0};
+};
+
+/**
+ * @brief Serial port or pty, raw 8N1
+ *
+ * Writes go straight to the port, so anything faster than the line rate
+ * piles up in the driver buffer; pace writes with mavlink_sched_t.
+ */
+class SerialLink : public Link {
+public:
+    /**
+     * @param path device, e.g. /dev/ttyUSB0 or the slave side of a pty
+     * @param baud line rate, one of the standard rates
+     */
+    SerialLink(const std::string &path, uint32_t baud);
+    ~SerialLink() override;
+
+    SerialLink(const SerialLink &) = delete;
+    SerialLink &operator=(const SerialLink &) = delete;
+
+    bool is_open() const { return fd_ >= 0; }
+    uint32_t baud() const { return baud_; }
+
+    ssize_t read(uint8_t *buf, size_t len) override;
+    bool write(const uint8_t *buf, size_t len) override;
+    int fd() const override { return fd_; }
+    std::string name() const override;
+
+private:
+    int fd_ = -1;
+    std::string path_;
+    uint32_t baud_;
+};
+
+/**
+ * @brief TCP client, e.g. towards a GCS or SITL listening on 5760
+ *
+ * Connects once, in the constructor. Writes wait out a full socket
+ * buffer, like SerialLink, so a frame is never cut short.
+ */
+class TcpLink : public Link {
+public:
+    TcpLink(const std::string &host, uint16_t port);
+    ~TcpLink() override;
+
+    TcpLink(const TcpLink &) = delete;
+    TcpLink &operator=(const TcpLink &) = delete;
+
+    bool is_open() const { return sock_ >= 0; }
+
+    ssize_t read(uint8_t *buf, size_t len) override;
+    bool write(const uint8_t *buf, size_t len) override;
+    int fd() const override { return sock_; }
+    std::string name() const override;
+
+private:
+    int sock_ = -1;
+    std::string host_;
+    uint16_t port_;
+};
+
+/**
+ * @brief Open a link from a command line spec
+ *
+ * udp:LOCAL_PORT replies to the last sender, udp:LOCAL_PORT:HOST:PORT sends
+ * to a fixed peer, tcp:HOST:PORT connects to a TCP server, serial:PATH[:BAUD]
+ * opens a serial port at 57600 baud unless BAUD is given.
+ * @return nullptr if the spec is malformed or the link could not be opened
+ */
+std::unique_ptr<Link> open_link(const std::string &spec);
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_LINK_H
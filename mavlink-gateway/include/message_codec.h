@@ -0,0 +1,175 @@
+/**
+ * @file message_codec.h
+ * @brief Typed MAVLink codecs that read and write wire buffers directly
+ */
+
+#ifndef MAVLINK_GATEWAY_MESSAGE_CODEC_H
+#define MAVLINK_GATEWAY_MESSAGE_CODEC_H
+
+#include "gateway_mavlink.h"
+
+#include <cstring>
+
+namespace mavlink {
+
+/**
+ * @brief Codec for one message type, e.g. msg<MAVLINK_MSG_ID_ATTITUDE>
+ *
+ * Specialised with MAVLINK_GATEWAY_CODEC() below. Each specialisation has
+ * - type: the generated payload struct, e.g. mavlink_attitude_t
+ * - id, len, min_len, crc_extra, max_frame_len: constants of the message
+ * - info: the constexpr mavlink_message_info_t, with field names, types
+ *   and wire offsets (MAVLINK_USE_MESSAGE_INFO builds)
+ * - pack(): write a complete frame straight into a send buffer
+ * - decode(): read the payload straight out of a parsed frame
+ *
+ * The generated structs have their fields in wire order, so on little
+ * endian hosts the start of the struct is the payload: packing is
+ * mavlink_finalize_message_to_send_buffer() on the struct and decoding is
+ * a memcpy. Big endian hosts go through the generated encode / decode
+ * functions.
+ *
+ * Fields are sent as given: unlike mavlink_msg_heartbeat_pack(), pack()
+ * does not force HEARTBEAT.mavlink_version to 3.
+ */
+template <uint32_t Id>
+struct msg;
+
+namespace detail {
+
+/*
+  write m as a frame, see the pack() member of the msg<> specialisations
+ */
+template <typename M>
+uint16_t pack(uint8_t *buf, const typename M::type &m, uint8_t sysid, uint8_t compid, mavlink_status_t &status)
+{
+#if MAVLINK_NEED_BYTE_SWAP
+    mavlink_message_t message;
+    M::encode_status(sysid, compid, &status, &message, &m);
+    return mavlink_msg_to_send_buffer(buf, &message);
+#else
+    return mavlink_finalize_message_to_send_buffer(buf, &status, sysid, compid, M::id,
+                                                   reinterpret_cast<const char *>(&m),
+                                                   M::min_len, M::len, M::crc_extra);
+#endif
+}
+
+/*
+  read the payload of a parsed frame, see the decode() member of the msg<>
+  specialisations
+ */
+template <typename M>
+bool decode(const mavlink_frame_view_t &view, typename M::type &m)
+{
+    if (view.msgid != M::id) {
+        return false;
+    }
+#if MAVLINK_NEED_BYTE_SWAP
+    mavlink_message_t message;
+    mavlink_frame_view_to_message(const_cast<mavlink_frame_view_t *>(&view), &message);
+    M::decode_message(&message, &m);
+#else
+    const uint8_t len = view.len < M::len ? view.len : uint8_t(M::len);
+    std::memcpy(&m, view.payload, len);
+    std::memset(reinterpret_cast<uint8_t *>(&m) + len, 0, M::len - len);
+#endif
+    return true;
+}
+
+} // namespace detail
+
+#ifdef MAVLINK_USE_MESSAGE_INFO
+namespace detail {
+
+/*
+  every field sits at its wire offset in the C struct, so the first len
+  bytes of the struct are the payload
+ */
+constexpr bool wire_layout(const mavlink_message_info_t &info)
+{
+    for (unsigned i = 0; i < info.num_fields; i++) {
+        if (info.fields[i].structure_offset != info.fields[i].wire_offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace detail
+
+#define MAVLINK_GATEWAY_CODEC_INFO(NAME) \
+    static constexpr mavlink_message_info_t info = MAVLINK_MESSAGE_INFO_##NAME; \
+    static_assert(detail::wire_layout(info), "payload struct is not in wire layout");
+#else
+#define MAVLINK_GATEWAY_CODEC_INFO(NAME)
+#endif
+
+/**
+ * @brief Declare msg<MAVLINK_MSG_ID_NAME> for a generated message
+ * @param NAME upper case message name, e.g. ATTITUDE
+ * @param name lower case message name, e.g. attitude
+ */
+#define MAVLINK_GATEWAY_CODEC(NAME, name) \
+    template <> \
+    struct msg<MAVLINK_MSG_ID_##NAME> { \
+        using type = mavlink_##name##_t; \
+        static constexpr uint32_t id = MAVLINK_MSG_ID_##NAME; \
+        static constexpr uint8_t len = MAVLINK_MSG_ID_##NAME##_LEN; \
+        static constexpr uint8_t min_len = MAVLINK_MSG_ID_##NAME##_MIN_LEN; \
+        static constexpr uint8_t crc_extra = MAVLINK_MSG_ID_##NAME##_CRC; \
+        static constexpr uint16_t max_frame_len = MAVLINK_NUM_NON_PAYLOAD_BYTES + len + MAVLINK_SIGNATURE_BLOCK_LEN; \
+        MAVLINK_GATEWAY_CODEC_INFO(NAME) \
+        static_assert(sizeof(type) >= len, "payload struct is shorter than the payload"); \
+        /** \
+         * @brief Write m as a frame, like the generated encode_status() \
+         * followed by mavlink_msg_to_send_buffer() \
+         * \
+         * Takes the sequence number, MAVLink 1 flag and signing from status. \
+         * @param buf at least max_frame_len bytes \
+         * @return frame length \
+         */ \
+        static uint16_t pack(uint8_t *buf, const type &m, uint8_t sysid, uint8_t compid, mavlink_status_t &status) \
+        { \
+            return detail::pack<msg>(buf, m, sysid, compid, status); \
+        } \
+        /** \
+         * @brief Read the payload of a frame from mavlink_parse_buffer_view(), \
+         * bytes trimmed by the sender come back as zero \
+         * @return false if the frame is a different message \
+         */ \
+        static bool decode(const mavlink_frame_view_t &view, type &m) \
+        { \
+            return detail::decode<msg>(view, m); \
+        } \
+        static uint16_t encode_status(uint8_t sysid, uint8_t compid, mavlink_status_t *status, \
+                                      mavlink_message_t *message, const type *m) \
+        { \
+            return mavlink_msg_##name##_encode_status(sysid, compid, status, message, m); \
+        } \
+        static void decode_message(const mavlink_message_t *message, type *m) \
+        { \
+            mavlink_msg_##name##_decode(message, m); \
+        } \
+    }
+
+// high rate telemetry and command traffic
+MAVLINK_GATEWAY_CODEC(HEARTBEAT, heartbeat);
+MAVLINK_GATEWAY_CODEC(SYS_STATUS, sys_status);
+MAVLINK_GATEWAY_CODEC(GPS_RAW_INT, gps_raw_int);
+MAVLINK_GATEWAY_CODEC(ATTITUDE, attitude);
+MAVLINK_GATEWAY_CODEC(ATTITUDE_QUATERNION, attitude_quaternion);
+MAVLINK_GATEWAY_CODEC(LOCAL_POSITION_NED, local_position_ned);
+MAVLINK_GATEWAY_CODEC(GLOBAL_POSITION_INT, global_position_int);
+MAVLINK_GATEWAY_CODEC(RC_CHANNELS, rc_channels);
+MAVLINK_GATEWAY_CODEC(SERVO_OUTPUT_RAW, servo_output_raw);
+MAVLINK_GATEWAY_CODEC(VFR_HUD, vfr_hud);
+MAVLINK_GATEWAY_CODEC(MANUAL_CONTROL, manual_control);
+MAVLINK_GATEWAY_CODEC(COMMAND_LONG, command_long);
+MAVLINK_GATEWAY_CODEC(COMMAND_ACK, command_ack);
+MAVLINK_GATEWAY_CODEC(BATTERY_STATUS, battery_status);
+MAVLINK_GATEWAY_CODEC(TIMESYNC, timesync);
+MAVLINK_GATEWAY_CODEC(SYSTEM_TIME, system_time);
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_MESSAGE_CODEC_H
@@ -0,0 +1,46 @@
+/**
+ * @file message_index.h
+ * @brief Constant time lookup of message and field info by name
+ */
+
+#ifndef MAVLINK_GATEWAY_MESSAGE_INDEX_H
+#define MAVLINK_GATEWAY_MESSAGE_INDEX_H
+
+#include "gateway_mavlink.h"
+
+#include <string_view>
+
+namespace mavlink {
+
+/**
+ * @brief Like mavlink_get_message_info_by_name(), through a perfect hash
+ * of the dialect's message names built at compile time
+ *
+ * One hash of name picks the only candidate, which is then checked.
+ * @return nullptr for unknown names
+ */
+const mavlink_message_info_t *find_message(std::string_view name);
+
+/**
+ * @brief Message info by id
+ */
+const mavlink_message_info_t *find_message(uint32_t msgid);
+
+/**
+ * @brief Field of a message by name, through a perfect hash of all
+ * (message, field name) pairs
+ *
+ * @param message info returned by find_message()
+ * @return nullptr if the message has no such field
+ */
+const mavlink_field_info_t *find_field(const mavlink_message_info_t &message, std::string_view name);
+
+/**
+ * @brief Size in bytes of a value of a MAVLink field type, 0 for an
+ * unknown type
+ */
+size_t field_type_size(mavlink_message_type_t type);
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_MESSAGE_INDEX_H
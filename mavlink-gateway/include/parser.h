@@ -0,0 +1,227 @@
+/**
+ * @file parser.h
+ * @brief Reentrant MAVLink parser and parser pool
+ */
+
+#ifndef MAVLINK_GATEWAY_PARSER_H
+#define MAVLINK_GATEWAY_PARSER_H
+
+#include "gateway_mavlink.h"
+
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace mavlink {
+
+/**
+ * @brief Signing stream timestamps in a hash table sized at run time
+ *
+ * Replay protection needs one record of stream timestamps for all links
+ * sharing a key. Streams that have been quiet for longer than
+ * MAVLINK_SIGNING_TIMESTAMP_LIMIT are dropped when the table fills up.
+ * Not thread safe, parsers sharing it must run on the same thread.
+ */
+class SigningStreamTable {
+public:
+    explicit SigningStreamTable(uint32_t max_streams = 1024);
+    SigningStreamTable(const SigningStreamTable &) = delete;
+    SigningStreamTable &operator=(const SigningStreamTable &) = delete;
+
+    mavlink_signing_streams_t *streams() { return &streams_; }
+
+    uint32_t size() const { return table_.count; }
+    uint32_t evicted() const { return table_.evicted; }
+
+private:
+    std::vector<mavlink_signing_stream_slot_t> slots_;
+    mavlink_signing_stream_table_t table_;
+    mavlink_signing_streams_t streams_;
+};
+
+/**
+ * @brief Sequence accounting of each (sysid, compid) stream heard on a link
+ *
+ * Counts frames received, sequence numbers lost, duplicates and frames
+ * that arrived out of order, plus the loss rate over the last 128
+ * sequence numbers of each stream. Attach it to the parser of one link
+ * with Parser::track_sequences(). Not thread safe, read it on the thread
+ * running the parser.
+ */
+class SequenceStats {
+public:
+    struct Totals {
+        uint64_t received = 0;
+        uint64_t lost = 0;
+        uint64_t duplicate = 0;
+        uint64_t reordered = 0;
+    };
+
+    explicit SequenceStats(uint32_t max_streams = 256);
+    SequenceStats(const SequenceStats &) = delete;
+    SequenceStats &operator=(const SequenceStats &) = delete;
+
+    mavlink_seq_table_t *table() { return &table_; }
+
+    /**
+     * @brief Counters of one stream, nullptr if nothing was heard from it
+     */
+    const mavlink_seq_stream_t *find(uint8_t sysid, uint8_t compid) const
+    {
+        return mavlink_seq_table_find(&table_, sysid, compid);
+    }
+
+    /**
+     * @brief Call f(sysid, compid, const mavlink_seq_stream_t &) for each stream
+     */
+    template <typename F>
+    void for_each(F &&f) const
+    {
+        for (const mavlink_seq_stream_t &stream : streams_) {
+            if (stream.key != 0) {
+                f(uint8_t(stream.key >> 8), uint8_t(stream.key), stream);
+            }
+        }
+    }
+
+    static float loss_rate(const mavlink_seq_stream_t &stream) { return mavlink_seq_stream_loss_rate(&stream); }
+
+    /**
+     * @brief Count one frame, as a parser does for the link it tracks
+     * @return what the frame added to the counters of its stream, all 0
+     * if the table was full and it was only counted in untracked()
+     */
+    Totals update(uint8_t sysid, uint8_t compid, uint8_t seq);
+
+    /**
+     * @brief Counters summed over all streams
+     */
+    Totals totals() const;
+
+    uint32_t size() const { return table_.count; }
+    uint64_t untracked() const { return table_.untracked; }
+    void clear();
+
+private:
+    std::vector<mavlink_seq_stream_t> streams_;
+    mavlink_seq_table_t table_;
+};
+
+/**
+ * @brief MAVLink parser for one link
+ *
+ * Owns the message buffer, status and signing streams that
+ * mavlink_parse_char() keeps in per-channel statics, so any number of links
+ * can be parsed independently and from different threads. A parser is
+ * pinned in memory because its status points at its own signing state.
+ */
+class alignas(64) Parser {
+public:
+    Parser();
+    Parser(const Parser &) = delete;
+    Parser &operator=(const Parser &) = delete;
+
+    /**
+     * @brief Drop any partial frame and clear statistics and signing state
+     */
+    void reset();
+
+    /**
+     * @brief Require incoming messages to be signed with key
+     * @param accept_unsigned called for unsigned or badly signed messages, may be nullptr
+     * @param streams stream table shared with other parsers, nullptr for
+     * the parser's own table of MAVLINK_MAX_SIGNING_STREAMS streams
+     */
+    void enable_signing(const uint8_t key[32], mavlink_accept_unsigned_t accept_unsigned = nullptr,
+                        SigningStreamTable *streams = nullptr);
+    void disable_signing();
+
+    /**
+     * @brief Count the sequence numbers of each (sysid, compid) stream in
+     * stats, nullptr to stop. reset() stops it too.
+     */
+    void track_sequences(SequenceStats *stats);
+
+    /**
+     * @brief Parse one byte, like mavlink_parse_char()
+     * @return true if msg now holds a complete message
+     */
+    bool parse_char(uint8_t c, mavlink_message_t &msg);
+
+    /**
+     * @brief Parse a buffer, like mavlink_parse_buffer_view()
+     *
+     * on_frame is called as on_frame(mavlink_frame_view_t &) for each good
+     * message, the view is only valid during the call.
+     * @return number of good messages in buf
+     */
+    template <typename F>
+    uint32_t parse(const uint8_t *buf, uint32_t len, F &&on_frame)
+    {
+        return mavlink_parse_buffer_view(&rxmsg_, &status_, buf, len,
+                                         &Parser::dispatch<typename std::remove_reference<F>::type>,
+                                         &on_frame);
+    }
+
+    /**
+     * @brief Frames dropped for a bad length, CRC or signature since the
+     * last call. Unlike status().parse_error this is not reset per frame.
+     */
+    uint32_t take_rejected()
+    {
+        const uint32_t rejected = status_.frames_rejected;
+        status_.frames_rejected = 0;
+        return rejected;
+    }
+
+    const mavlink_status_t &status() const { return status_; }
+    const mavlink_signing_t &signing() const { return signing_; }
+
+private:
+    template <typename F>
+    static void dispatch(mavlink_frame_view_t *view, const mavlink_status_t *, void *arg)
+    {
+        (*static_cast<F *>(arg))(*view);
+    }
+
+    mavlink_message_t rxmsg_;
+    mavlink_status_t status_;
+    mavlink_signing_t signing_;
+    mavlink_signing_streams_t signing_streams_;
+};
+
+/**
+ * @brief Grows in chunks of parsers allocated together, so parsers handed
+ * out for links served by the same worker sit next to each other in memory.
+ * Released parsers are reused before new chunks are allocated.
+ */
+class ParserPool {
+public:
+    explicit ParserPool(size_t chunk_size = 64);
+    ParserPool(const ParserPool &) = delete;
+    ParserPool &operator=(const ParserPool &) = delete;
+
+    /**
+     * @brief Get a freshly reset parser
+     */
+    Parser *acquire();
+
+    /**
+     * @brief Return a parser obtained from acquire()
+     */
+    void release(Parser *parser);
+
+    size_t capacity() const;
+    size_t in_use() const;
+
+private:
+    const size_t chunk_size_;
+    std::vector<std::unique_ptr<Parser[]>> chunks_;
+    std::vector<Parser *> free_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_PARSER_H
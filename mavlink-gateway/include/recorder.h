@@ -0,0 +1,273 @@
+/**
+ * @file recorder.h
+ * @brief Append-only recording of every frame, with time and message indexes
+ *
+ * A recording is a series of segment files, prefix-NNNNNN.rec, each of
+ * which is one SegmentHeader followed by records:
+ *
+ *     uint64_t time_us    receive time, microseconds since the Unix epoch
+ *     uint16_t link       link the frame arrived on
+ *     uint16_t len        frame length
+ *     uint8_t  frame[len] the frame as sent, as mavlink_msg_to_send_buffer() makes it
+ *
+ * All fields are little endian. SegmentHeader::end is advanced after every
+ * batch of records, so a segment cut short by a crash reads back up to its
+ * last batch. When a segment is closed its index is written next to it as
+ * prefix-NNNNNN.idx:
+ *
+ *     IndexHeader
+ *     TimeEntry[time_entries]        one per block of records, by offset
+ *     per msgid, in msgid order:
+ *         uint32_t msgid, uint32_t count
+ *         uint64_t offset[count]     first record of msgid in each block it appears in
+ */
+
+#ifndef MAVLINK_GATEWAY_RECORDER_H
+#define MAVLINK_GATEWAY_RECORDER_H
+
+#include "gateway_mavlink.h"
+#include "spsc_ring.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mavlink {
+
+struct RecorderConfig {
+    std::string directory = ".";
+    std::string prefix = "mavlink";
+    size_t segment_size = 64 << 20;     ///< bytes per segment file
+    size_t queue_size = 4096;           ///< frames per source ring
+    size_t max_sources = 64;            ///< threads that may record
+    size_t block_size = 64 << 10;       ///< bytes per time index entry
+    uint64_t block_time_us = 1000000;   ///< longest time per time index entry
+};
+
+struct RecorderStats {
+    uint64_t frames = 0;     ///< frames written
+    uint64_t bytes = 0;      ///< bytes of records written
+    uint64_t dropped = 0;    ///< frames lost because a source ring was full
+    uint64_t segments = 0;   ///< segments opened
+    bool failed = false;     ///< a new segment could not be opened, e.g. the disk is full, recording stopped
+};
+
+/**
+ * @brief Records frames from any number of threads into memory mapped
+ * segment files
+ *
+ * Each recording thread gets a Source, an SPSC ring the background flusher
+ * drains, so recording a frame is one copy and never waits for I/O: a full
+ * ring drops the frame and counts it. The flusher merges the sources by
+ * receive time and copies records straight into the mapped segment. Records
+ * from one source keep their order; records from different sources are
+ * ordered as far as what the rings held at the time allows.
+ *
+ * The blocks of each segment are allocated when it is opened, so a full
+ * disk shows up as a segment that cannot be opened, not as SIGBUS on a
+ * write to the mapping. Recording then stops and further frames are
+ * counted as dropped.
+ */
+class Recorder {
+public:
+    static constexpr size_t RECORD_HEADER_LEN = 12;
+
+    struct SegmentHeader {
+        uint8_t magic[8];        ///< "MAVREC01"
+        uint32_t version;
+        uint32_t header_len;     ///< offset of the first record
+        uint64_t first_time_us;  ///< time of the first record, 0 if none
+        uint64_t last_time_us;   ///< time of the last record
+        uint64_t end;            ///< offset just past the last complete record
+        uint8_t reserved[24];
+    };
+
+    struct IndexHeader {
+        uint8_t magic[8];        ///< "MAVIDX01"
+        uint32_t time_entries;
+        uint32_t msgids;
+    };
+
+    struct TimeEntry {
+        uint64_t time_us;        ///< time of the first record of the block
+        uint64_t offset;
+    };
+
+    /**
+     * @brief Producer side of the recorder, owned by one thread
+     */
+    class Source {
+    public:
+        /**
+         * @brief Queue a frame, never blocks
+         * @return false if the ring was full and the frame was dropped
+         */
+        bool record(uint16_t link, const uint8_t *frame, uint16_t len, uint64_t time_us);
+
+    private:
+        friend class Recorder;
+
+        struct Item {
+            uint64_t time_us;
+            uint16_t link;
+            uint16_t len;
+            uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+        };
+
+        explicit Source(size_t capacity) : ring_(capacity) {}
+
+        SpscRing<Item> ring_;
+        std::atomic<uint64_t> dropped_{0};
+    };
+
+    explicit Recorder(const RecorderConfig &config = RecorderConfig());
+    ~Recorder();
+
+    Recorder(const Recorder &) = delete;
+    Recorder &operator=(const Recorder &) = delete;
+
+    /**
+     * @brief Open the first segment and start the flusher
+     * @return false if the segment could not be created
+     */
+    bool start();
+
+    /**
+     * @brief Write what the sources hold, close the segment and stop the flusher
+     */
+    void stop();
+
+    /**
+     * @brief Get a source for the calling thread, also allowed while running
+     * @return nullptr once max_sources have been handed out
+     */
+    Source *add_source();
+
+    RecorderStats stats() const;
+
+    /**
+     * @brief Receive time as stored in records
+     */
+    static uint64_t now_us();
+
+    /**
+     * @brief Message id of a MAVLink 1 or 2 frame
+     */
+    static uint32_t msgid_of(const uint8_t *frame)
+    {
+        if (frame[0] == MAVLINK_STX_MAVLINK1) {
+            return frame[5];
+        }
+        return frame[7] | (frame[8] << 8) | (uint32_t(frame[9]) << 16);
+    }
+
+private:
+    bool open_segment();
+    void close_segment();
+    void append(const Source::Item &item);
+    void run_flusher();
+
+    RecorderConfig config_;
+    std::vector<std::unique_ptr<Source>> sources_;
+    std::atomic<size_t> num_sources_{0};
+    std::mutex sources_mutex_;
+
+    // segment being written, only touched by the flusher once started
+    int fd_ = -1;
+    uint8_t *map_ = nullptr;
+    uint64_t pos_ = 0;
+    unsigned next_segment_ = 1;
+    std::string path_;
+    std::vector<TimeEntry> time_index_;
+    std::map<uint32_t, std::vector<uint64_t>> msgid_index_;
+    std::vector<uint32_t> block_msgids_;   // msgids already indexed in the current block
+    uint64_t block_start_ = 0;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> segments_{0};
+    std::atomic<bool> failed_{false};
+    std::atomic<bool> running_{false};
+    std::thread flusher_;
+};
+
+/**
+ * @brief Reads one segment written by Recorder, for replay and analysis
+ *
+ * The segment is mapped read only. Seeking uses the segment's index file,
+ * or an index rebuilt by scanning if the recorder did not get to write it.
+ */
+class RecordingReader {
+public:
+    struct Record {
+        uint64_t time_us;
+        uint16_t link;
+        uint16_t len;
+        uint32_t msgid;
+        uint64_t offset;         ///< of the record in the segment
+        const uint8_t *frame;    ///< valid while the reader is open
+    };
+
+    RecordingReader() = default;
+    ~RecordingReader();
+
+    RecordingReader(const RecordingReader &) = delete;
+    RecordingReader &operator=(const RecordingReader &) = delete;
+
+    /**
+     * @brief Whether the file at path starts like a segment written by Recorder
+     */
+    static bool is_recording(const std::string &path);
+
+    /**
+     * @brief Open a .rec segment
+     */
+    bool open(const std::string &path);
+    void close();
+
+    /**
+     * @brief Read the record at the current position and move past it
+     * @return false at the end of the segment
+     */
+    bool next(Record &record);
+
+    /**
+     * @brief Move to the first record received at or after time_us
+     */
+    void seek(uint64_t time_us);
+
+    /**
+     * @brief Move to the first record of msgid received at or after time_us
+     * @return false if there is none
+     */
+    bool seek(uint32_t msgid, uint64_t time_us);
+
+    void rewind() { pos_ = header_len_; }
+
+    uint64_t first_time_us() const { return first_time_us_; }
+    uint64_t last_time_us() const { return last_time_us_; }
+    size_t time_entries() const { return time_index_.size(); }
+
+private:
+    bool load_index(const std::string &path);
+    void build_index();
+    bool record_at(uint64_t offset, Record &record) const;
+
+    const uint8_t *map_ = nullptr;
+    size_t map_len_ = 0;
+    uint64_t header_len_ = 0;
+    uint64_t end_ = 0;
+    uint64_t pos_ = 0;
+    uint64_t first_time_us_ = 0;
+    uint64_t last_time_us_ = 0;
+    std::vector<Recorder::TimeEntry> time_index_;
+    std::map<uint32_t, std::vector<uint64_t>> msgid_index_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_RECORDER_H
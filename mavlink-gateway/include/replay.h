@@ -0,0 +1,172 @@
+/**
+ * @file replay.h
+ * @brief Replay of recorded MAVLink traffic, paced by the recorded times
+ */
+
+#ifndef MAVLINK_GATEWAY_REPLAY_H
+#define MAVLINK_GATEWAY_REPLAY_H
+
+#include "gateway_mavlink.h"
+#include "recorder.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace mavlink {
+
+/**
+ * @brief Reads frames from a telemetry log
+ *
+ * Takes the usual .tlog written by QGroundControl and MAVProxy (each frame
+ * preceded by its receive time as a big endian uint64_t of microseconds
+ * since the Unix epoch) and segments written by Recorder, told apart by
+ * the segment magic. The file is mapped, frames are not copied.
+ */
+class ReplayReader {
+public:
+    struct Frame {
+        uint64_t time_us;
+        const uint8_t *data;     ///< valid while the reader is open
+        uint16_t len;
+    };
+
+    ReplayReader() = default;
+    ~ReplayReader();
+
+    ReplayReader(const ReplayReader &) = delete;
+    ReplayReader &operator=(const ReplayReader &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    /**
+     * @brief Next frame, false at the end of the log or at the first
+     * record that is not a frame
+     */
+    bool next(Frame &frame);
+
+    void rewind();
+
+private:
+    // .tlog
+    const uint8_t *map_ = nullptr;
+    size_t map_len_ = 0;
+    size_t pos_ = 0;
+    // Recorder segment
+    bool segment_ = false;
+    RecordingReader recording_;
+};
+
+struct ReplayConfig {
+    double speed = 1.0;          ///< 1 for real time, N for N times faster, 0 as fast as possible
+    unsigned loops = 1;          ///< times to play the log, 0 to loop until stopped
+};
+
+/**
+ * @brief Frames sent and how far sending fell behind the schedule
+ *
+ * Lateness is the time between when a frame was due and when it was handed
+ * to the sink, so it measures the replay host and the sink, and is 0 when
+ * playing as fast as possible.
+ */
+struct ReplayStats {
+    static constexpr int HIST_BUCKETS = 24;   ///< bucket 0: < 1 us, bucket i: < 2^i us
+
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t elapsed_us = 0;
+    uint64_t late_max_us = 0;
+    double late_sum_us = 0;
+    double late_sum_sq_us = 0;
+    uint64_t late[HIST_BUCKETS] = {};
+
+    double frames_per_sec() const { return elapsed_us > 0 ? frames * 1e6 / elapsed_us : 0; }
+    double late_mean_us() const { return frames > 0 ? late_sum_us / frames : 0; }
+    /** @brief Standard deviation of the lateness, the jitter seen by the sink */
+    double jitter_us() const;
+    /** @brief Upper bound of the lateness of fraction q of the frames, e.g. 0.99 */
+    uint64_t late_quantile_us(double q) const;
+};
+
+/**
+ * @brief Plays a log into a sink: a Link, or any callable for in-process
+ * consumers and benchmarks
+ *
+ * Frames are released when their recorded time, scaled by the speed, comes
+ * up: the replay thread sleeps until shortly before and spins for the
+ * rest, so pacing is accurate to a few microseconds on an idle core. A
+ * sink slower than the log delays the frames after it rather than dropping
+ * them; the lateness in the stats shows by how much.
+ */
+class Replayer {
+public:
+    Replayer(ReplayReader &reader, const ReplayConfig &config = ReplayConfig())
+        : reader_(reader),
+          config_(config)
+    {
+    }
+
+    /**
+     * @brief Play the log, calling on_frame(const ReplayReader::Frame &)
+     * for each frame, until it has been played config.loops times or
+     * stop() is called
+     */
+    template <typename F>
+    const ReplayStats &run(F &&on_frame)
+    {
+        stats_ = ReplayStats();
+        stop_.store(false, std::memory_order_relaxed);
+        const Clock::time_point start = Clock::now();
+        for (unsigned loop = 0; config_.loops == 0 || loop < config_.loops; loop++) {
+            reader_.rewind();
+            ReplayReader::Frame frame;
+            bool first = true;
+            while (!stop_.load(std::memory_order_relaxed) && reader_.next(frame)) {
+                if (first) {
+                    // every pass starts playing now
+                    base_time_us_ = frame.time_us;
+                    base_ = Clock::now();
+                    first = false;
+                }
+                pace(frame.time_us);
+                on_frame(frame);
+                stats_.frames++;
+                stats_.bytes += frame.len;
+            }
+            if (stop_.load(std::memory_order_relaxed) || first) {
+                break;
+            }
+        }
+        stats_.elapsed_us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                                         Clock::now() - start).count());
+        return stats_;
+    }
+
+    /**
+     * @brief Make run() return after the current frame, from any thread
+     */
+    void stop() { stop_.store(true, std::memory_order_relaxed); }
+
+    /**
+     * @brief Stats so far, for the sink to report progress while running
+     */
+    const ReplayStats &stats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // wait until the frame recorded at time_us is due and count its lateness
+    void pace(uint64_t time_us);
+
+    ReplayReader &reader_;
+    ReplayConfig config_;
+    ReplayStats stats_;
+    std::atomic<bool> stop_{false};
+    uint64_t base_time_us_ = 0;
+    Clock::time_point base_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_REPLAY_H
@@ -0,0 +1,170 @@
+/**
+ * @file router.h
+ * @brief Multi-core MAVLink router
+ */
+
+#ifndef MAVLINK_GATEWAY_ROUTER_H
+#define MAVLINK_GATEWAY_ROUTER_H
+
+#include "dedup.h"
+#include "egress.h"
+#include "gateway_mavlink.h"
+#include "ingest.h"
+#include "link.h"
+#include "parser.h"
+#include "recorder.h"
+#include "spsc_ring.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mavlink {
+
+struct RouterConfig {
+    unsigned workers = 0;        ///< parsing threads, 0 for one per core
+    unsigned writers = 0;        ///< sending threads, 0 for one per worker
+    size_t queue_size = 1024;    ///< frames per worker -> writer ring
+    bool pin_threads = false;    ///< pin threads to cores (Linux only)
+    size_t mtu = 0;              ///< pack frames into datagrams of up to mtu bytes, 0 sends each frame alone
+    unsigned batch_delay_us = 500; ///< longest a frame waits for a datagram to fill
+    size_t read_batch = 64;      ///< datagrams read per call (recvmmsg() for UDP)
+    unsigned dedup_window_ms = 0; ///< drop copies of a frame sent within this long, 0 to send all
+};
+
+struct RouterStats {
+    uint64_t frames_in = 0;      ///< good frames parsed
+    uint64_t frames_out = 0;     ///< frames written to links
+    uint64_t frames_dropped = 0; ///< frames dropped because a ring was full
+    uint64_t frames_duplicate = 0; ///< copies not sent, see RouterConfig::dedup_window_ms
+    uint64_t parse_errors = 0;   ///< frames dropped for a bad length, CRC or signature
+    uint64_t links_closed = 0;   ///< links given up on after a read error or hangup
+    SequenceStats::Totals sequences; ///< sequence accounting of all links
+    std::vector<SequenceStats::Totals> link_sequences; ///< sequence accounting of each link, by link index
+};
+
+/**
+ * @brief Routes frames between links on a pool of worker threads
+ *
+ * Each link is owned by one worker, which reads and parses it, so frames
+ * from one link are always handled in order. Workers pass routed frames to
+ * writer threads through one SPSC ring per (worker, writer) pair, so no
+ * locks are taken on the data path. Each link is written by one writer.
+ *
+ * Frames with a target system are sent to the link that system was last
+ * heard on. Broadcasts (target 0) and frames for unknown systems go to all
+ * other links.
+ *
+ * With a non-zero mtu each writer packs the frames for a link into
+ * datagrams and hands them over with one Link::write_datagrams() call.
+ *
+ * With a non-zero dedup_window_ms a vehicle may be connected over several
+ * links (e.g. WiFi and a radio): each writer keeps a Deduplicator per link
+ * it writes, so only the first copy of a frame is sent on. Parsing, and so
+ * per link statistics, still sees every copy.
+ *
+ * A link that fails to read, e.g. a TCP link whose server went away, is
+ * closed: its worker stops reading it and counts it in links_closed.
+ *
+ * Each link counts the sequence numbers of the (sysid, compid) streams
+ * heard on it in a SequenceStats, owned by the worker reading the link.
+ * Its totals are published through atomic counters for stats().
+ *
+ * With a Recorder set by record_to(), every parsed frame is also recorded
+ * with its receive time and source link, through one Recorder::Source per
+ * worker.
+ */
+class Router {
+public:
+    explicit Router(const RouterConfig &config = RouterConfig());
+    ~Router();
+
+    Router(const Router &) = delete;
+    Router &operator=(const Router &) = delete;
+
+    /**
+     * @brief Add a link, only allowed before start()
+     * @return link index
+     */
+    size_t add_link(std::unique_ptr<Link> link);
+
+    /**
+     * @brief Record every frame received, only allowed before start()
+     *
+     * The recorder must be started before and stopped after the router.
+     */
+    void record_to(Recorder *recorder) { recorder_ = recorder; }
+
+    void start();
+    void stop();
+
+    RouterStats stats() const;
+
+private:
+    struct Frame {
+        uint32_t link;   // destination link
+        uint16_t len;
+        uint8_t data[MAVLINK_MAX_PACKET_LEN];
+    };
+
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> frames_in{0};
+        std::atomic<uint64_t> frames_out{0};
+        std::atomic<uint64_t> frames_dropped{0};
+        std::atomic<uint64_t> frames_duplicate{0};
+        std::atomic<uint64_t> parse_errors{0};
+        std::atomic<uint64_t> links_closed{0};
+    };
+
+    // sequence accounting of one source link, updated by its worker only
+    struct alignas(64) LinkSequences {
+        SequenceStats stats;
+        std::atomic<uint64_t> received{0};
+        std::atomic<uint64_t> lost{0};
+        std::atomic<uint64_t> duplicate{0};
+        std::atomic<uint64_t> reordered{0};
+    };
+
+    struct Worker {
+        std::vector<size_t> links;
+        Counters counters;
+        Recorder::Source *record = nullptr;  // null if not recording
+        std::thread thread;
+    };
+
+    struct Writer {
+        Counters counters;
+        std::unique_ptr<EgressBatcher> egress;  // null if batching is off
+        std::vector<std::unique_ptr<Deduplicator>> dedup;  // by link, null for links of other writers
+        std::thread thread;
+    };
+
+    void run_worker(unsigned index);
+    void run_writer(unsigned index);
+    void route(unsigned worker, size_t src, const mavlink_frame_view_t &view);
+    void enqueue(unsigned worker, size_t dest, const mavlink_frame_view_t &view);
+
+    SpscRing<Frame> &ring(unsigned worker, unsigned writer)
+    {
+        return *rings_[worker * writers_.size() + writer];
+    }
+    unsigned writer_of(size_t link) const { return unsigned(link % writers_.size()); }
+
+    RouterConfig config_;
+    std::vector<std::unique_ptr<Link>> links_;
+    std::vector<Parser *> parsers_;
+    std::vector<std::unique_ptr<LinkSequences>> sequences_;  // by link
+    ParserPool parser_pool_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::unique_ptr<Writer>> writers_;
+    std::vector<std::unique_ptr<SpscRing<Frame>>> rings_;
+    // link index + 1 each system was last heard on, 0 if unknown
+    std::unique_ptr<std::atomic<uint32_t>[]> system_link_;
+    Recorder *recorder_ = nullptr;
+    std::atomic<bool> running_{false};
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_ROUTER_H
@@ -0,0 +1,149 @@
+/**
+ * @file server.h
+ * @brief Single threaded MAVLink server for many TCP and UDP clients
+ */
+
+#ifndef MAVLINK_GATEWAY_SERVER_H
+#define MAVLINK_GATEWAY_SERVER_H
+
+#include "gateway_mavlink.h"
+#include "ingest.h"
+#include "link.h"
+#include "parser.h"
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace mavlink {
+
+struct ServerConfig {
+    uint16_t tcp_port = 5760;     ///< 0 to not listen on TCP
+    uint16_t udp_port = 14550;    ///< 0 to not listen on UDP
+    size_t max_clients = 10000;
+    size_t queue_limit = 256 * 1024;   ///< bytes queued per client before telemetry is dropped
+    size_t command_limit = 1024 * 1024; ///< bytes queued per client before it is disconnected
+    size_t udp_mtu = 1400;        ///< largest datagram sent to a UDP client
+    size_t bulk_slice = 16 * 1024; ///< telemetry bytes handed to a client socket at a time
+    int tcp_notsent_lowat = 16 * 1024; ///< unsent bytes the kernel holds for a TCP client, 0 for no limit
+    std::chrono::seconds udp_timeout{10}; ///< UDP clients are forgotten after this long without a datagram
+};
+
+struct ServerStats {
+    uint64_t clients = 0;          ///< connected clients
+    uint64_t frames_in = 0;        ///< frames from the vehicle
+    uint64_t frames_up = 0;        ///< frames from clients sent to the vehicle
+    uint64_t dropped_bulk = 0;     ///< telemetry frames not queued for slow clients
+    uint64_t disconnects = 0;      ///< clients gone, timed out or dropped for full queues
+};
+
+/**
+ * @brief Mirrors one vehicle link to thousands of clients on one thread
+ *
+ * TCP clients connect to tcp_port, UDP clients are whoever sends a datagram
+ * to udp_port. Every frame from the vehicle is queued for every client,
+ * frames from clients go to the vehicle. All sockets are non blocking and
+ * served by one edge triggered epoll loop, each client has its own parser
+ * and write queue.
+ *
+ * A client that does not keep up gets backpressure instead of a bigger
+ * queue: once queue_limit bytes wait for it, telemetry for it is dropped
+ * while commands, acks and heartbeats (see is_command()) are still queued
+ * and sent ahead of the remaining telemetry. Telemetry goes to the socket
+ * in slices of up to bulk_slice bytes and the kernel keeps at most
+ * tcp_notsent_lowat bytes of it unsent, so a command waits behind about
+ * that much plus what is in flight. A client with command_limit bytes
+ * waiting is disconnected.
+ *
+ * Linux only.
+ */
+class Server {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Server(std::unique_ptr<Link> vehicle, const ServerConfig &config = ServerConfig());
+    ~Server();
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    /**
+     * @brief Create the listening sockets and the epoll set
+     */
+    bool open();
+
+    /**
+     * @brief Wait up to timeout_ms for events and handle them
+     */
+    void run_once(int timeout_ms);
+
+    /**
+     * @brief Whether a frame is kept for slow clients: frames addressed to
+     * a system, HEARTBEAT, COMMAND_ACK, PARAM_VALUE and STATUSTEXT
+     */
+    static bool is_command(const mavlink_frame_view_t &view);
+
+    const ServerStats &stats() const { return stats_; }
+
+    /**
+     * @brief Sequence accounting of the streams heard from the vehicle link
+     */
+    const SequenceStats &vehicle_sequences() const { return vehicle_sequences_; }
+
+private:
+    struct Client {
+        int fd = -1;            // TCP socket, -1 for UDP clients
+        uint64_t addr = 0;      // UDP peer
+        Parser *parser = nullptr;
+        std::vector<uint8_t> out;       // frames being written
+        size_t out_head = 0;
+        std::vector<uint8_t> commands;  // frames sent before any telemetry
+        std::vector<uint8_t> bulk;      // telemetry from bulk_head on
+        size_t bulk_head = 0;
+        Clock::time_point last_heard;
+        bool dirty = false;     // in dirty_, to be flushed
+        bool blocked = false;   // socket full, waiting for EPOLLOUT
+        bool closed = false;
+
+        size_t queued() const { return out.size() - out_head + commands.size() + bulk.size() - bulk_head; }
+    };
+
+    Client *add_client(int fd, uint64_t addr);
+    void close_client(Client &client);
+    void accept_clients();
+    void read_tcp(Client &client);
+    void read_udp();
+    bool read_vehicle();
+    void broadcast(const mavlink_frame_view_t &view);
+    void enqueue(Client &client, const uint8_t *frame, size_t len, bool command);
+    void flush_dirty();
+    bool flush_tcp(Client &client);
+    bool flush_udp(Client &client);
+    void expire_udp(Clock::time_point now);
+    void reap();
+
+    ServerConfig config_;
+    std::unique_ptr<Link> vehicle_;
+    Parser vehicle_parser_;
+    SequenceStats vehicle_sequences_;
+    DatagramReader vehicle_reader_;
+    ParserPool parser_pool_;
+    int epoll_ = -1;
+    int tcp_ = -1;
+    int udp_ = -1;
+    bool udp_blocked_ = false;
+    bool vehicle_busy_ = false;   // the last read of a polled vehicle link found data
+    std::vector<std::unique_ptr<Client>> clients_;   // all clients, unordered
+    std::unordered_map<int, Client *> tcp_clients_;
+    std::unordered_map<uint64_t, Client *> udp_clients_;
+    std::vector<Client *> dirty_;
+    std::vector<Client *> udp_waiting_;  // UDP clients with data while the socket is full
+    std::vector<uint8_t> read_buf_;
+    Clock::time_point next_expire_;
+    ServerStats stats_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_SERVER_H
@@ -0,0 +1,67 @@
+/**
+ * @file signature_batch.h
+ * @brief Signature verification for batches of signed frames
+ */
+
+#ifndef MAVLINK_GATEWAY_SIGNATURE_BATCH_H
+#define MAVLINK_GATEWAY_SIGNATURE_BATCH_H
+
+#include "gateway_mavlink.h"
+
+namespace mavlink {
+
+enum class Sha256Impl {
+    scalar,   ///< mavlink_sha256_key_48(), one frame at a time
+    avx2,     ///< 8 frames at a time in AVX2 lanes
+    sha_ni,   ///< x86 SHA extensions, one frame at a time
+};
+
+/**
+ * @brief Checks the signatures of many frames in one call
+ *
+ * The SHA-256 work for all frames is done first, grouped by length so the
+ * SIMD implementations keep their lanes busy. Digests are then compared
+ * and the timestamp / stream checks run frame by frame in order, so the
+ * outcome, the signing streams and signing.last_status end up exactly as
+ * after calling mavlink_signature_check() on each frame in turn.
+ */
+class SignatureVerifier {
+public:
+    /// frames hashed together, larger calls are split
+    static constexpr size_t max_batch = 16;
+
+    /**
+     * @brief Fastest implementation this CPU supports
+     */
+    static Sha256Impl best_impl();
+
+    static const char *impl_name(Sha256Impl impl);
+
+    /**
+     * @param impl implementation to use, falls back to scalar if the CPU
+     * does not support it
+     */
+    explicit SignatureVerifier(Sha256Impl impl = best_impl());
+
+    Sha256Impl impl() const { return impl_; }
+
+    /**
+     * @brief Verify signed frames, like mavlink_signature_check() on each
+     *
+     * @param frames complete MAVLink 2 frames, from the magic byte to the
+     * end of the signature block, e.g. mavlink_frame_view_t::frame
+     * @param count number of frames
+     * @param ok set to the result for each frame. Frames that are not
+     * signed MAVLink 2 frames fail without touching the signing state
+     * @return number of frames that passed
+     */
+    size_t verify(mavlink_signing_t &signing, mavlink_signing_streams_t &streams,
+                  const uint8_t *const *frames, size_t count, bool *ok) const;
+
+private:
+    Sha256Impl impl_;
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_SIGNATURE_BATCH_H
@@ -0,0 +1,106 @@
+/**
+ * @file spsc_ring.h
+ * @brief Bounded lock-free single producer / single consumer ring
+ */
+
+#ifndef MAVLINK_GATEWAY_SPSC_RING_H
+#define MAVLINK_GATEWAY_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace mavlink {
+
+/**
+ * @brief Bounded ring for handing items from one thread to one other thread
+ *
+ * Items are written in place: the producer fills the slot returned by
+ * claim() and makes it visible with publish(), the consumer reads front()
+ * and frees it with pop(). Each side caches the other side's index so the
+ * shared cache lines are only touched when the ring looks full or empty.
+ */
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @param capacity rounded up to a power of two
+     */
+    explicit SpscRing(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        mask_ = n - 1;
+        slots_.reset(new T[n]);
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // producer side
+
+    /**
+     * @brief Get the next free slot, or nullptr if the ring is full
+     */
+    T *claim()
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+    /**
+     * @brief Hand the slot returned by claim() to the consumer
+     */
+    void publish()
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer side
+
+    /**
+     * @brief Get the oldest published item, or nullptr if the ring is empty
+     */
+    T *front()
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return nullptr;
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    /**
+     * @brief Release the item returned by front()
+     */
+    void pop()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(64) std::atomic<size_t> head_{0};  // written by the consumer
+    size_t tail_cache_ = 0;                    // consumer's copy of tail_
+    alignas(64) std::atomic<size_t> tail_{0};  // written by the producer
+    size_t head_cache_ = 0;                    // producer's copy of head_
+};
+
+} // namespace mavlink
+
+#endif // MAVLINK_GATEWAY_SPSC_RING_H
@@ -0,0 +1,488 @@
+/**
+ * @file attitude_batch.cpp
+ * @brief Quaternion / rotation matrix / Euler angle conversions of whole
+ * arrays of samples
+ */
+
+#include "attitude_batch.h"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__SSE2__) || defined(__ARM_NEON))
+#define GATEWAY_ATTITUDE_SIMD 1
+#if defined(__x86_64__) || defined(__i386__)
+#define GATEWAY_ATTITUDE_X86 1
+#endif
+#endif
+
+namespace mavlink {
+
+namespace {
+
+void dcm_in(const float *const dcm[9], size_t i, float m[3][3])
+{
+    for (unsigned k = 0; k < 9; k++) {
+        m[k / 3][k % 3] = dcm[k][i];
+    }
+}
+
+void dcm_out(const float m[3][3], size_t i, float *const dcm[9])
+{
+    for (unsigned k = 0; k < 9; k++) {
+        dcm[k][i] = m[k / 3][k % 3];
+    }
+}
+
+#ifdef GATEWAY_ATTITUDE_SIMD
+
+#define GATEWAY_INLINE inline __attribute__((always_inline))
+
+// the helpers below are always inlined, no AVX vector is passed in a call
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef float f32x8 __attribute__((vector_size(32)));
+
+constexpr float PI = 3.14159265358979f;
+constexpr float PI_2 = 1.57079632679490f;
+constexpr float PI_4 = 0.78539816339745f;
+constexpr float GIMBAL_LOCK = 1.0e-3f;   // as mavlink_dcm_to_euler()
+
+// lanes of V as int32_t, also the type of comparisons of V
+template <typename V>
+using Int = decltype(V{} < V{});
+
+template <typename V>
+GATEWAY_INLINE V select(const Int<V> &mask, const V &a, const V &b)
+{
+    return V((mask & Int<V>(a)) | (~mask & Int<V>(b)));
+}
+
+template <typename V>
+GATEWAY_INLINE V abs(const V &x)
+{
+    return V(Int<V>(x) & INT32_MAX);
+}
+
+template <typename V>
+GATEWAY_INLINE V sqrt(const V &x)
+{
+    // reciprocal square root estimate from the bits, three Newton steps
+    V y = V(0x5f375a86 - (Int<V>(x) >> 1));
+    y = y * (1.5f - 0.5f * x * y * y);
+    y = y * (1.5f - 0.5f * x * y * y);
+    y = y * (1.5f - 0.5f * x * y * y);
+    return x * y;
+}
+
+/*
+  atan of t in [0, 1]: arguments above tan(pi/8) are reduced with
+  atan(t) = pi/4 + atan((t - 1) / (t + 1)), the polynomial is the one of
+  cephes atanf()
+ */
+template <typename V>
+GATEWAY_INLINE V atan_unit(const V &t)
+{
+    const Int<V> reduce = t > 0.414213562f;
+    const V x = select(reduce, (t - 1.0f) / (t + 1.0f), t);
+    const V z = x * x;
+    const V p = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z -
+                 3.33329491539e-1f) * z * x + x;
+    return select(reduce, p + PI_4, p);
+}
+
+template <typename V>
+GATEWAY_INLINE V atan2(const V &y, const V &x)
+{
+    const V ax = abs(x);
+    const V ay = abs(y);
+    const Int<V> steep = ay > ax;
+    const V hi = select(steep, ay, ax);
+    const V lo = select(steep, ax, ay);
+    const Int<V> zero = hi == 0.0f;
+    V r = atan_unit(select(zero, V{}, lo / select(zero, V{} + 1.0f, hi)));
+    r = select(steep, PI_2 - r, r);
+    r = select(Int<V>(x) < 0, PI - r, r);
+    return V(Int<V>(r) | (Int<V>(y) & INT32_MIN));
+}
+
+// angle in (-2 pi, 2 pi] to (-pi, pi]
+template <typename V>
+GATEWAY_INLINE V wrap_pi(const V &x)
+{
+    const V r = select(x > PI, x - 2.0f * PI, x);
+    return select(r <= -PI, r + 2.0f * PI, r);
+}
+
+/*
+  sin and cos of x, |x| < 1e4: x is reduced by multiples of pi/2 in three
+  parts (Cody-Waite), the polynomials are the ones of cephes sinf() / cosf()
+ */
+template <typename V>
+GATEWAY_INLINE void sincos(const V &x, V &s, V &c)
+{
+    const V j = (x * 0.636619772f + 12582912.0f) - 12582912.0f;
+    const Int<V> q = __builtin_convertvector(j, Int<V>);
+    const V r = ((x - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+    const V z = r * r;
+    const V sin_r = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    const V cos_r = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z -
+                    0.5f * z + 1.0f;
+    const Int<V> swap = (q & 1) != 0;
+    s = V(Int<V>(select(swap, cos_r, sin_r)) ^ ((q & 2) << 30));
+    c = V(Int<V>(select(swap, sin_r, cos_r)) ^ (((q + 1) & 2) << 30));
+}
+
+template <typename V>
+GATEWAY_INLINE void quaternion_dcm(const V q[4], V d[9])
+{
+    const V aa = q[0] * q[0];
+    const V bb = q[1] * q[1];
+    const V cc = q[2] * q[2];
+    const V dd = q[3] * q[3];
+    const V ab = q[0] * q[1];
+    const V ac = q[0] * q[2];
+    const V ad = q[0] * q[3];
+    const V bc = q[1] * q[2];
+    const V bd = q[1] * q[3];
+    const V cd = q[2] * q[3];
+    d[0] = aa + bb - cc - dd;
+    d[1] = 2.0f * (bc - ad);
+    d[2] = 2.0f * (ac + bd);
+    d[3] = 2.0f * (bc + ad);
+    d[4] = aa - bb + cc - dd;
+    d[5] = 2.0f * (cd - ab);
+    d[6] = 2.0f * (bd - ac);
+    d[7] = 2.0f * (ab + cd);
+    d[8] = aa - bb - cc + dd;
+}
+
+/*
+  In gimbal lock roll is 0 and yaw is yaw - roll at +90 degrees pitch,
+  yaw + roll at -90 degrees
+ */
+template <typename V>
+GATEWAY_INLINE void dcm_euler(const V d[9], V e[3])
+{
+    const V pitch = atan2(-d[6], sqrt(d[0] * d[0] + d[3] * d[3]));
+    const Int<V> lock = abs(pitch) > PI_2 - GIMBAL_LOCK;
+    const V yaw_lock = select(pitch > 0.0f, atan2(d[5] - d[1], d[2] + d[4]), atan2(-(d[5] + d[1]), d[4] - d[2]));
+    e[0] = select(lock, V{}, atan2(d[7], d[8]));
+    e[1] = pitch;
+    e[2] = select(lock, yaw_lock, atan2(d[3], d[0]));
+}
+
+/*
+  Straight from the quaternion rather than through the rotation matrix,
+  whose elements lose their precision to cancellation near gimbal lock:
+  with half angles r, p, y and c = cos(p) + sin(p), s = cos(p) - sin(p)
+    w + y = c cos(y - r)   z - x = c sin(y - r)
+    w - y = s cos(y + r)   z + x = s sin(y + r)
+  and cos(pitch) = c s, sin(pitch) = 2 (w y - x z).
+ */
+template <typename V>
+GATEWAY_INLINE void quaternion_euler(const V q[4], V e[3])
+{
+    const V wpy = q[0] + q[2];
+    const V zmx = q[3] - q[1];
+    const V wmy = q[0] - q[2];
+    const V zpx = q[3] + q[1];
+    const V diff = atan2(zmx, wpy);
+    const V sum = atan2(zpx, wmy);
+    const V pitch = atan2(2.0f * (q[0] * q[2] - q[1] * q[3]),
+                          sqrt((wpy * wpy + zmx * zmx) * (wmy * wmy + zpx * zpx)));
+    const Int<V> lock = abs(pitch) > PI_2 - GIMBAL_LOCK;
+    e[0] = select(lock, V{}, wrap_pi(sum - diff));
+    e[1] = pitch;
+    e[2] = wrap_pi(select(lock, 2.0f * select(pitch > 0.0f, diff, sum), sum + diff));
+}
+
+struct QuaternionToDcm {
+    static constexpr unsigned inputs = 4;
+    static constexpr unsigned outputs = 9;
+
+    template <typename V>
+    static GATEWAY_INLINE void run(const V *in, V *out)
+    {
+        quaternion_dcm(in, out);
+    }
+};
+
+struct QuaternionToEuler {
+    static constexpr unsigned inputs = 4;
+    static constexpr unsigned outputs = 3;
+
+    template <typename V>
+    static GATEWAY_INLINE void run(const V *in, V *out)
+    {
+        quaternion_euler(in, out);
+    }
+};
+
+struct DcmToEuler {
+    static constexpr unsigned inputs = 9;
+    static constexpr unsigned outputs = 3;
+
+    template <typename V>
+    static GATEWAY_INLINE void run(const V *in, V *out)
+    {
+        dcm_euler(in, out);
+    }
+};
+
+struct EulerToQuaternion {
+    static constexpr unsigned inputs = 3;
+    static constexpr unsigned outputs = 4;
+
+    template <typename V>
+    static GATEWAY_INLINE void run(const V *in, V *out)
+    {
+        V sr, cr, sp, cp, sy, cy;
+        sincos(in[0] * 0.5f, sr, cr);
+        sincos(in[1] * 0.5f, sp, cp);
+        sincos(in[2] * 0.5f, sy, cy);
+        out[0] = cr * cp * cy + sr * sp * sy;
+        out[1] = sr * cp * cy - cr * sp * sy;
+        out[2] = cr * sp * cy + sr * cp * sy;
+        out[3] = cr * cp * sy - sr * sp * cy;
+    }
+};
+
+struct EulerToDcm {
+    static constexpr unsigned inputs = 3;
+    static constexpr unsigned outputs = 9;
+
+    template <typename V>
+    static GATEWAY_INLINE void run(const V *in, V *out)
+    {
+        V sr, cr, sp, cp, sy, cy;
+        sincos(in[0], sr, cr);
+        sincos(in[1], sp, cp);
+        sincos(in[2], sy, cy);
+        out[0] = cp * cy;
+        out[1] = -cr * sy + sr * sp * cy;
+        out[2] = sr * sy + cr * sp * cy;
+        out[3] = cp * sy;
+        out[4] = cr * cy + sr * sp * sy;
+        out[5] = -sr * cy + cr * sp * sy;
+        out[6] = -sp;
+        out[7] = sr * cp;
+        out[8] = cr * cp;
+    }
+};
+
+/*
+  Kernel over count samples, a vector of them at a time. The last, partial
+  vector is padded with zeros.
+ */
+template <typename Kernel, typename V>
+GATEWAY_INLINE void convert(const float *const *in, size_t stride, size_t count, float *const *out)
+{
+    constexpr size_t lanes = sizeof(V) / sizeof(float);
+    V a[Kernel::inputs];
+    V r[Kernel::outputs];
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        for (unsigned k = 0; k < Kernel::inputs; k++) {
+            if (stride == 1) {
+                std::memcpy(&a[k], in[k] + i, sizeof(V));
+            } else {
+                for (size_t l = 0; l < lanes; l++) {
+                    a[k][l] = in[k][(i + l) * stride];
+                }
+            }
+        }
+        Kernel::run(a, r);
+        for (unsigned k = 0; k < Kernel::outputs; k++) {
+            std::memcpy(out[k] + i, &r[k], sizeof(V));
+        }
+    }
+    if (i == count) {
+        return;
+    }
+    for (unsigned k = 0; k < Kernel::inputs; k++) {
+        a[k] = V{};
+        for (size_t l = 0; i + l < count; l++) {
+            a[k][l] = in[k][(i + l) * stride];
+        }
+    }
+    Kernel::run(a, r);
+    for (unsigned k = 0; k < Kernel::outputs; k++) {
+        for (size_t l = 0; i + l < count; l++) {
+            out[k][i + l] = r[k][l];
+        }
+    }
+}
+
+template <typename Kernel>
+void convert_simd128(const float *const *in, size_t stride, size_t count, float *const *out)
+{
+    convert<Kernel, f32x4>(in, stride, count, out);
+}
+
+#ifdef GATEWAY_ATTITUDE_X86
+template <typename Kernel>
+__attribute__((target("avx2,fma")))
+void convert_avx2(const float *const *in, size_t stride, size_t count, float *const *out)
+{
+    convert<Kernel, f32x8>(in, stride, count, out);
+}
+#endif
+
+#else
+
+// every conversion takes the scalar path
+struct QuaternionToDcm;
+struct QuaternionToEuler;
+struct DcmToEuler;
+struct EulerToQuaternion;
+struct EulerToDcm;
+
+#endif // GATEWAY_ATTITUDE_SIMD
+
+/*
+  run a kernel with a SIMD implementation
+  @return false for the scalar implementation, which is left to the caller
+ */
+template <typename Kernel>
+bool convert_simd(AttitudeImpl impl, const float *const *in, size_t stride, size_t count, float *const *out)
+{
+    switch (impl) {
+#ifdef GATEWAY_ATTITUDE_SIMD
+#ifdef GATEWAY_ATTITUDE_X86
+    case AttitudeImpl::avx2:
+        convert_avx2<Kernel>(in, stride, count, out);
+        return true;
+#endif
+    case AttitudeImpl::simd128:
+        convert_simd128<Kernel>(in, stride, count, out);
+        return true;
+#endif
+    default:
+        (void)in;
+        (void)stride;
+        (void)count;
+        (void)out;
+        return false;
+    }
+}
+
+} // namespace
+
+AttitudeImpl AttitudeConverter::best_impl()
+{
+#ifdef GATEWAY_ATTITUDE_SIMD
+#ifdef GATEWAY_ATTITUDE_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return AttitudeImpl::avx2;
+    }
+#endif
+    return AttitudeImpl::simd128;
+#else
+    return AttitudeImpl::scalar;
+#endif
+}
+
+const char *AttitudeConverter::impl_name(AttitudeImpl impl)
+{
+    switch (impl) {
+    case AttitudeImpl::avx2:
+        return "avx2";
+    case AttitudeImpl::simd128:
+#ifdef __ARM_NEON
+        return "neon";
+#else
+        return "sse2";
+#endif
+    case AttitudeImpl::scalar:
+        break;
+    }
+    return "scalar";
+}
+
+AttitudeConverter::AttitudeConverter(AttitudeImpl impl)
+    : impl_(impl)
+{
+    const AttitudeImpl best = best_impl();
+    if (impl_ == AttitudeImpl::avx2 && best != AttitudeImpl::avx2) {
+        impl_ = best;
+    }
+    if (impl_ == AttitudeImpl::simd128 && best == AttitudeImpl::scalar) {
+        impl_ = best;
+    }
+}
+
+void AttitudeConverter::quaternion_to_dcm(const float *const q[4], size_t count, float *const dcm[9],
+                                          size_t stride) const
+{
+    if (convert_simd<QuaternionToDcm>(impl_, q, stride, count, dcm)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const float quaternion[4] = {q[0][i * stride], q[1][i * stride], q[2][i * stride], q[3][i * stride]};
+        float m[3][3];
+        mavlink_quaternion_to_dcm(quaternion, m);
+        dcm_out(m, i, dcm);
+    }
+}
+
+void AttitudeConverter::quaternion_to_euler(const float *const q[4], size_t count, float *roll, float *pitch,
+                                            float *yaw, size_t stride) const
+{
+    float *const euler[3] = {roll, pitch, yaw};
+    if (convert_simd<QuaternionToEuler>(impl_, q, stride, count, euler)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const float quaternion[4] = {q[0][i * stride], q[1][i * stride], q[2][i * stride], q[3][i * stride]};
+        mavlink_quaternion_to_euler(quaternion, &roll[i], &pitch[i], &yaw[i]);
+    }
+}
+
+void AttitudeConverter::dcm_to_euler(const float *const dcm[9], size_t count, float *roll, float *pitch,
+                                     float *yaw) const
+{
+    float *const euler[3] = {roll, pitch, yaw};
+    if (convert_simd<DcmToEuler>(impl_, dcm, 1, count, euler)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        float m[3][3];
+        dcm_in(dcm, i, m);
+        mavlink_dcm_to_euler(m, &roll[i], &pitch[i], &yaw[i]);
+    }
+}
+
+void AttitudeConverter::euler_to_quaternion(const float *roll, const float *pitch, const float *yaw, size_t count,
+                                            float *const q[4]) const
+{
+    const float *const euler[3] = {roll, pitch, yaw};
+    if (convert_simd<EulerToQuaternion>(impl_, euler, 1, count, q)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        float quaternion[4];
+        mavlink_euler_to_quaternion(roll[i], pitch[i], yaw[i], quaternion);
+        for (unsigned k = 0; k < 4; k++) {
+            q[k][i] = quaternion[k];
+        }
+    }
+}
+
+void AttitudeConverter::euler_to_dcm(const float *roll, const float *pitch, const float *yaw, size_t count,
+                                     float *const dcm[9]) const
+{
+    const float *const euler[3] = {roll, pitch, yaw};
+    if (convert_simd<EulerToDcm>(impl_, euler, 1, count, dcm)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        float m[3][3];
+        mavlink_euler_to_dcm(roll[i], pitch[i], yaw[i], m);
+        dcm_out(m, i, dcm);
+    }
+}
+
+} // namespace mavlink
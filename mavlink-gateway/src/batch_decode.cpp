@@ -0,0 +1,355 @@
+/**
+ * @file batch_decode.cpp
+ * @brief Decoding of many frames of one message into arrays per field
+ */
+
+#include "batch_decode.h"
+#include "message_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define GATEWAY_DECODE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace mavlink {
+
+namespace {
+
+constexpr unsigned LANES = 8;
+constexpr unsigned CHUNK = 32;   // payload bytes transposed at once
+
+/*
+  value of size bytes at offset of a payload of len bytes, little endian on
+  the wire, bytes past len read as zero
+ */
+uint64_t load_le(const uint8_t *payload, uint8_t len, unsigned offset, unsigned size)
+{
+    uint64_t v = 0;
+    for (unsigned i = 0; i < size; i++) {
+        if (offset + i < len) {
+            v |= uint64_t(payload[offset + i]) << (8 * i);
+        }
+    }
+    return v;
+}
+
+/*
+  value of size bytes at p, all inside the payload
+ */
+uint64_t load_wire(const uint8_t *p, unsigned size)
+{
+    switch (size) {
+    case 1:
+        return *p;
+    case 2: {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if MAVLINK_NEED_BYTE_SWAP
+        v = __builtin_bswap16(v);
+#endif
+        return v;
+    }
+    case 4: {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if MAVLINK_NEED_BYTE_SWAP
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+    default: {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if MAVLINK_NEED_BYTE_SWAP
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+    }
+}
+
+/*
+  value of an element of a frame, zero extended if the payload was trimmed
+ */
+uint64_t load(const mavlink_frame_view_t &view, unsigned offset, unsigned size)
+{
+    if (offset + size <= view.len) {
+        return load_wire(view.payload + offset, size);
+    }
+    return load_le(view.payload, view.len, offset, size);
+}
+
+/*
+  store the low size bytes of v as element at of a column, in host order
+ */
+void store(void *column, size_t at, unsigned size, uint64_t v)
+{
+    switch (size) {
+    case 1:
+        static_cast<uint8_t *>(column)[at] = uint8_t(v);
+        break;
+    case 2:
+        static_cast<uint16_t *>(column)[at] = uint16_t(v);
+        break;
+    case 4:
+        static_cast<uint32_t *>(column)[at] = uint32_t(v);
+        break;
+    default:
+        static_cast<uint64_t *>(column)[at] = v;
+        break;
+    }
+}
+
+#ifdef GATEWAY_DECODE_X86
+
+/*
+  bytes [offset, offset + 32) of a payload, zero past its end, without
+  reading past it
+ */
+__attribute__((target("avx2")))
+__m256i load_chunk(const mavlink_frame_view_t &view, unsigned offset)
+{
+    const unsigned avail = view.len > offset ? std::min<unsigned>(view.len - offset, CHUNK) : 0;
+    const uint8_t *p = view.payload + offset;
+    if (avail == CHUNK) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    if (avail % 4 == 0) {
+        // masked out words are neither read nor faulted on
+        const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(avail / 4)),
+                                                _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        return _mm256_maskload_epi32(reinterpret_cast<const int *>(p), mask);
+    }
+    alignas(32) uint8_t tail[CHUNK] = {};
+    std::memcpy(tail, p, avail);
+    return _mm256_load_si256(reinterpret_cast<const __m256i *>(tail));
+}
+
+/*
+  8x8 transpose of 32 bit words: in row j holds word k of frame j, out row
+  k holds word k of frames 0..7
+ */
+__attribute__((target("avx2")))
+void transpose_8x8(const __m256i in[8], __m256i out[8])
+{
+    const __m256i t0 = _mm256_unpacklo_epi32(in[0], in[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(in[0], in[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(in[2], in[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(in[2], in[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(in[4], in[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(in[4], in[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(in[6], in[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(in[6], in[7]);
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    out[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    out[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    out[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    out[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    out[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    out[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    out[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    out[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+/*
+  the words of one chunk of 8 frames, into the columns of the aligned
+  scalars in it
+ */
+template <typename Element>
+__attribute__((target("avx2")))
+void store_chunk(const __m256i words[8], unsigned chunk_offset, const Element *begin, const Element *end,
+                 void *const *columns, size_t row)
+{
+    // bytes 0-1 / byte 0 of each word, gathered into the low 8 bytes of each lane
+    const __m256i pick16 = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i pick8 = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                           0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    for (const Element *e = begin; e != end; ++e) {
+        void *column = columns[e->field];
+        if (column == nullptr || !e->simd) {
+            continue;
+        }
+        const unsigned at = e->offset - chunk_offset;
+        const __m256i w = words[at / 4];
+        uint8_t *dst = static_cast<uint8_t *>(column) + row * e->size;
+        switch (e->size) {
+        case 4:
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), w);
+            break;
+        case 2: {
+            const __m256i v = _mm256_shuffle_epi8(_mm256_srli_epi32(w, 8 * (at % 4)), pick16);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                             _mm256_castsi256_si128(_mm256_permute4x64_epi64(v, 0x08)));
+            break;
+        }
+        case 1: {
+            const __m256i v = _mm256_shuffle_epi8(_mm256_srli_epi32(w, 8 * (at % 4)), pick8);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst),
+                             _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+                                 v, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1))));
+            break;
+        }
+        default: {
+            // low word k, high word k + 1
+            const __m256i lo = _mm256_unpacklo_epi32(w, words[at / 4 + 1]);
+            const __m256i hi = _mm256_unpackhi_epi32(w, words[at / 4 + 1]);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+            break;
+        }
+        }
+    }
+}
+
+template <typename Element>
+__attribute__((target("avx2")))
+void decode_avx2_8(const mavlink_frame_view_t *views, const Element *elements, size_t num_elements,
+                   void *const *columns, size_t row)
+{
+    const Element *end = elements + num_elements;
+    for (const Element *begin = elements; begin != end;) {
+        const unsigned chunk_offset = begin->offset / CHUNK * CHUNK;
+        const Element *chunk_end = begin;
+        bool wanted = false;
+        while (chunk_end != end && chunk_end->offset < chunk_offset + CHUNK) {
+            wanted |= chunk_end->simd && columns[chunk_end->field] != nullptr;
+            ++chunk_end;
+        }
+        if (wanted) {
+            __m256i rows[LANES], words[LANES];
+            for (unsigned j = 0; j < LANES; j++) {
+                rows[j] = load_chunk(views[j], chunk_offset);
+            }
+            transpose_8x8(rows, words);
+            store_chunk(words, chunk_offset, begin, chunk_end, columns, row);
+        }
+        begin = chunk_end;
+    }
+}
+
+#endif // GATEWAY_DECODE_X86
+
+} // namespace
+
+DecodeImpl BatchDecoder::best_impl()
+{
+#ifdef GATEWAY_DECODE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return DecodeImpl::avx2;
+    }
+#endif
+    return DecodeImpl::scalar;
+}
+
+const char *BatchDecoder::impl_name(DecodeImpl impl)
+{
+    switch (impl) {
+    case DecodeImpl::avx2:
+        return "avx2";
+    case DecodeImpl::scalar:
+        break;
+    }
+    return "scalar";
+}
+
+BatchDecoder::BatchDecoder(uint32_t msgid, DecodeImpl impl)
+    : impl_(DecodeImpl::scalar)
+{
+#ifdef GATEWAY_DECODE_X86
+    if (impl == DecodeImpl::avx2 && __builtin_cpu_supports("avx2")) {
+        impl_ = impl;
+    }
+#else
+    (void)impl;
+#endif
+    info_ = find_message(msgid);
+    if (info_ == nullptr || mavlink_get_msg_entry(msgid) == nullptr) {
+        info_ = nullptr;
+        return;
+    }
+    for (unsigned i = 0; i < info_->num_fields; i++) {
+        const mavlink_field_info_t &field = info_->fields[i];
+        const uint8_t size = uint8_t(field_type_size(field.type));
+        if (size == 0) {
+            // a type this decoder does not know, nothing to decode it into
+            info_ = nullptr;
+            elements_.clear();
+            return;
+        }
+        const uint16_t width = uint16_t(field.array_length > 0 ? field.array_length : 1);
+        for (uint16_t k = 0; k < width; k++) {
+            const unsigned offset = field.wire_offset + k * size;
+            // extensions follow the base fields, so they need not be aligned;
+            // an 8 byte value also needs both its words in one chunk
+            const bool aligned = offset % std::min<unsigned>(size, 4) == 0 &&
+                                 (size < 8 || offset % CHUNK <= CHUNK - 8);
+            elements_.push_back(Element{uint16_t(offset), size, uint8_t(i), k, width, aligned && width == 1});
+        }
+    }
+    std::sort(elements_.begin(), elements_.end(),
+              [](const Element &a, const Element &b) { return a.offset < b.offset; });
+}
+
+int BatchDecoder::field_index(std::string_view name) const
+{
+    const mavlink_field_info_t *field = info_ != nullptr ? find_field(*info_, name) : nullptr;
+    return field != nullptr ? int(field - info_->fields) : -1;
+}
+
+void BatchDecoder::decode_scalar(const mavlink_frame_view_t *views, size_t count, void *const *columns,
+                                 size_t row) const
+{
+    for (size_t j = 0; j < count; j++) {
+        const mavlink_frame_view_t &view = views[j];
+        for (const Element &e : elements_) {
+            void *column = columns[e.field];
+            if (column != nullptr) {
+                store(column, (row + j) * e.width + e.index, e.size, load(view, e.offset, e.size));
+            }
+        }
+    }
+}
+
+size_t BatchDecoder::decode(const mavlink_frame_view_t *views, size_t count, void *const *columns) const
+{
+    if (info_ == nullptr) {
+        return 0;
+    }
+    size_t n = 0;
+    while (n < count && views[n].msgid == info_->msgid) {
+        n++;
+    }
+    size_t row = 0;
+#ifdef GATEWAY_DECODE_X86
+    if (impl_ == DecodeImpl::avx2) {
+        for (; row + LANES <= n; row += LANES) {
+            decode_avx2_8(views + row, elements_.data(), elements_.size(), columns, row);
+            // arrays and unaligned extension fields
+            for (const Element &e : elements_) {
+                void *column = columns[e.field];
+                if (column == nullptr || e.simd) {
+                    continue;
+                }
+                for (unsigned j = 0; j < LANES; j++) {
+                    store(column, (row + j) * e.width + e.index, e.size, load(views[row + j], e.offset, e.size));
+                }
+            }
+        }
+    }
+#endif
+    decode_scalar(views + row, n - row, columns, row);
+    return n;
+}
+
+} // namespace mavlink
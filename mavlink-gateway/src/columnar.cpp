@@ -0,0 +1,356 @@
+/**
+ * @file columnar.cpp
+ * @brief Per field time series extracted from frames through the message
+ * info tables, and a column file to keep them in
+ */
+
+#include "columnar.h"
+#include "message_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mavlink {
+
+namespace {
+
+const uint8_t COLUMN_MAGIC[8] = {'M', 'A', 'V', 'C', 'O', 'L', '0', '1'};
+constexpr uint32_t COLUMN_VERSION = 1;
+constexpr size_t COLUMN_ALIGN = 64;
+constexpr uint32_t LOW_TABLE_IDS = 1 << 16;
+constexpr uint64_t MIN_ROWS = 1024;
+
+// the frame is staged as time_us, sysid, compid, then the payload padded
+// with zeros to its full length, so one plan copies all columns
+constexpr uint16_t STAGE_SYSID = 8;
+constexpr uint16_t STAGE_COMPID = 9;
+constexpr uint16_t STAGE_PAYLOAD = 10;
+
+// plan runs by size, largest first
+constexpr uint16_t RUN_SIZES[4] = {8, 4, 2, 1};
+
+// low_tables_ entries besides table index + 1
+constexpr uint32_t TABLE_UNKNOWN = 0;
+constexpr uint32_t TABLE_SKIPPED = UINT32_MAX;
+
+// copy one row of each of count fields of Size bytes
+template <size_t Size, typename Step>
+const Step *copy_run(const Step *step, uint16_t count, const uint8_t *stage, uint64_t row)
+{
+    for (const Step *end = step + count; step != end; ++step) {
+        std::memcpy(step->base + row * Size, stage + step->offset, Size);
+    }
+    return step;
+}
+
+} // namespace
+
+bool ColumnExtractor::select(uint32_t msgid)
+{
+    if (find_message(msgid) == nullptr) {
+        return false;
+    }
+    if (std::find(selected_.begin(), selected_.end(), msgid) == selected_.end()) {
+        selected_.push_back(msgid);
+    }
+    return true;
+}
+
+bool ColumnExtractor::select(std::string_view message)
+{
+    const mavlink_message_info_t *info = find_message(message);
+    return info != nullptr && select(info->msgid);
+}
+
+ColumnExtractor::Table *ColumnExtractor::table_for(uint32_t msgid)
+{
+    uint32_t index;
+    if (msgid < LOW_TABLE_IDS) {
+        if (low_tables_.empty()) {
+            low_tables_.assign(LOW_TABLE_IDS, TABLE_UNKNOWN);
+        }
+        index = low_tables_[msgid];
+        if (index == TABLE_UNKNOWN) {
+            index = low_tables_[msgid] = compile(msgid);
+        }
+    } else {
+        auto found = high_tables_.find(msgid);
+        index = found != high_tables_.end() ? found->second : (high_tables_[msgid] = compile(msgid));
+    }
+    return index == TABLE_SKIPPED ? nullptr : &tables_[index - 1];
+}
+
+void ColumnExtractor::add_column(const std::string &name, uint32_t msgid, mavlink_message_type_t type,
+                                 uint16_t width)
+{
+    Column column;
+    column.name = name;
+    column.msgid = msgid;
+    column.type = type;
+    column.width = width;
+    column.row_bytes = uint32_t(field_type_size(type) * width);
+    columns_.push_back(std::move(column));
+}
+
+uint32_t ColumnExtractor::compile(uint32_t msgid)
+{
+    if (!selected_.empty() && std::find(selected_.begin(), selected_.end(), msgid) == selected_.end()) {
+        return TABLE_SKIPPED;
+    }
+    const mavlink_message_info_t *info = find_message(msgid);
+    const mavlink_msg_entry_t *entry = mavlink_get_msg_entry(msgid);
+    if (info == nullptr || entry == nullptr) {
+        return TABLE_SKIPPED;
+    }
+
+    Table table;
+    table.info = info;
+    table.max_len = entry->max_msg_len;
+    table.first_column = uint32_t(columns_.size());
+    const std::string prefix = std::string(info->name) + ".";
+    add_column(prefix + "time_us", msgid, MAVLINK_TYPE_UINT64_T, 1);
+    add_column(prefix + "sysid", msgid, MAVLINK_TYPE_UINT8_T, 1);
+    add_column(prefix + "compid", msgid, MAVLINK_TYPE_UINT8_T, 1);
+    table.plan.push_back(CopyStep{0, 8, table.first_column});
+    table.plan.push_back(CopyStep{STAGE_SYSID, 1, table.first_column + 1});
+    table.plan.push_back(CopyStep{STAGE_COMPID, 1, table.first_column + 2});
+    for (unsigned i = 0; i < info->num_fields; i++) {
+        const mavlink_field_info_t &field = info->fields[i];
+        const uint16_t width = uint16_t(field.array_length > 0 ? field.array_length : 1);
+        table.plan.push_back(CopyStep{uint16_t(STAGE_PAYLOAD + field.wire_offset),
+                                      uint16_t(field_type_size(field.type) * width), uint32_t(columns_.size())});
+        add_column(prefix + field.name, msgid, field.type, width);
+    }
+    // scalars grouped by size for fixed size copies, arrays last; the
+    // fields are listed in XML order, so also sort by offset
+    auto run_of = [](const CopyStep &step) {
+        const uint16_t *run = std::find(std::begin(RUN_SIZES), std::end(RUN_SIZES), step.size);
+        return size_t(run - RUN_SIZES);
+    };
+    std::sort(table.plan.begin(), table.plan.end(), [&](const CopyStep &a, const CopyStep &b) {
+        return run_of(a) != run_of(b) ? run_of(a) < run_of(b) : a.offset < b.offset;
+    });
+    for (const CopyStep &step : table.plan) {
+        if (run_of(step) < 4) {
+            table.runs[run_of(step)]++;
+        }
+    }
+    tables_.push_back(std::move(table));
+    return uint32_t(tables_.size());
+}
+
+void ColumnExtractor::grow(Table &table)
+{
+    table.capacity = std::max(MIN_ROWS, table.capacity * 2);
+    for (CopyStep &step : table.plan) {
+        Column &column = columns_[step.column];
+        column.data.resize(table.capacity * column.row_bytes);
+        step.base = column.data.data();
+    }
+}
+
+bool ColumnExtractor::append(Table &table, uint64_t time_us, uint8_t sysid, uint8_t compid, const uint8_t *payload,
+                             uint8_t len)
+{
+    if (table.rows == table.capacity) {
+        grow(table);
+    }
+    uint8_t stage[STAGE_PAYLOAD + 256];
+    std::memcpy(stage, &time_us, 8);
+    stage[STAGE_SYSID] = sysid;
+    stage[STAGE_COMPID] = compid;
+    const uint8_t copy = std::min(len, table.max_len);
+    std::memcpy(stage + STAGE_PAYLOAD, payload, copy);
+    std::memset(stage + STAGE_PAYLOAD + copy, 0, table.max_len - copy);
+
+    const uint64_t row = table.rows++;
+    const CopyStep *step = table.plan.data();
+    step = copy_run<8>(step, table.runs[0], stage, row);
+    step = copy_run<4>(step, table.runs[1], stage, row);
+    step = copy_run<2>(step, table.runs[2], stage, row);
+    step = copy_run<1>(step, table.runs[3], stage, row);
+    for (const CopyStep *end = table.plan.data() + table.plan.size(); step != end; ++step) {
+        std::memcpy(step->base + row * step->size, stage + step->offset, step->size);
+    }
+    frames_++;
+    return true;
+}
+
+bool ColumnExtractor::add(uint64_t time_us, const mavlink_frame_view_t &view)
+{
+    Table *table = table_for(view.msgid);
+    if (table == nullptr) {
+        skipped_++;
+        return false;
+    }
+    return append(*table, time_us, view.sysid, view.compid, view.payload, view.len);
+}
+
+bool ColumnExtractor::add(uint64_t time_us, const uint8_t *frame, uint16_t len)
+{
+    uint32_t msgid;
+    uint8_t sysid, compid, header_len;
+    if (len >= MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 && frame[0] == MAVLINK_STX_MAVLINK1) {
+        sysid = frame[3];
+        compid = frame[4];
+        msgid = frame[5];
+        header_len = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1;
+    } else if (len >= MAVLINK_NUM_HEADER_BYTES && frame[0] == MAVLINK_STX) {
+        sysid = frame[5];
+        compid = frame[6];
+        msgid = frame[7] | (frame[8] << 8) | (uint32_t(frame[9]) << 16);
+        header_len = MAVLINK_NUM_HEADER_BYTES;
+    } else {
+        skipped_++;
+        return false;
+    }
+    const uint8_t payload_len = frame[1];
+    Table *table;
+    if (header_len + payload_len > len || (table = table_for(msgid)) == nullptr) {
+        skipped_++;
+        return false;
+    }
+    return append(*table, time_us, sysid, compid, frame + header_len, payload_len);
+}
+
+uint64_t ColumnExtractor::rows(uint32_t msgid) const
+{
+    for (const Table &table : tables_) {
+        if (table.info->msgid == msgid) {
+            return table.rows;
+        }
+    }
+    return 0;
+}
+
+void ColumnExtractor::clear()
+{
+    for (Table &table : tables_) {
+        table.rows = 0;
+    }
+    frames_ = 0;
+    skipped_ = 0;
+}
+
+bool ColumnExtractor::write(const std::string &path) const
+{
+    std::vector<ColumnFile::Column> index(columns_.size());
+    for (const Table &table : tables_) {
+        for (const CopyStep &step : table.plan) {
+            index[step.column].rows = table.rows;
+        }
+    }
+    uint64_t offset = sizeof(ColumnFile::Header) + index.size() * sizeof(ColumnFile::Column);
+    for (size_t i = 0; i < index.size(); i++) {
+        const Column &column = columns_[i];
+        ColumnFile::Column &entry = index[i];
+        std::snprintf(entry.name, sizeof(entry.name), "%s", column.name.c_str());
+        entry.msgid = column.msgid;
+        entry.type = uint8_t(column.type);
+        entry.width = column.width;
+        offset = (offset + COLUMN_ALIGN - 1) & ~uint64_t(COLUMN_ALIGN - 1);
+        entry.offset = offset;
+        entry.bytes = entry.rows * column.row_bytes;
+        offset += entry.bytes;
+    }
+
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        std::perror(("[Columns] " + path).c_str());
+        return false;
+    }
+    ColumnFile::Header header {};
+    std::memcpy(header.magic, COLUMN_MAGIC, sizeof(header.magic));
+    header.version = COLUMN_VERSION;
+    header.columns = uint32_t(index.size());
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+              std::fwrite(index.data(), sizeof(ColumnFile::Column), index.size(), f) == index.size();
+    uint64_t pos = sizeof(header) + index.size() * sizeof(ColumnFile::Column);
+    static const uint8_t zeros[COLUMN_ALIGN] = {};
+    for (size_t i = 0; ok && i < index.size(); i++) {
+        ok = std::fwrite(zeros, 1, index[i].offset - pos, f) == index[i].offset - pos &&
+             std::fwrite(columns_[i].data.data(), 1, index[i].bytes, f) == index[i].bytes;
+        pos = index[i].offset + index[i].bytes;
+    }
+    if (std::fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        std::perror(("[Columns] " + path).c_str());
+    }
+    return ok;
+}
+
+ColumnFile::~ColumnFile()
+{
+    close();
+}
+
+bool ColumnFile::open(const std::string &path)
+{
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::perror(("[Columns] " + path).c_str());
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(Header)) {
+        std::fprintf(stderr, "[Columns] %s: not a column file\n", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *map = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::perror("[Columns] mmap");
+        return false;
+    }
+    map_ = static_cast<const uint8_t *>(map);
+    map_len_ = size_t(st.st_size);
+
+    const Header *header = reinterpret_cast<const Header *>(map_);
+    bool ok = std::memcmp(header->magic, COLUMN_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == COLUMN_VERSION &&
+              sizeof(Header) + uint64_t(header->columns) * sizeof(Column) <= map_len_;
+    if (ok) {
+        columns_ = reinterpret_cast<const Column *>(map_ + sizeof(Header));
+        num_columns_ = header->columns;
+        for (size_t i = 0; ok && i < num_columns_; i++) {
+            ok = columns_[i].offset + columns_[i].bytes <= map_len_ && columns_[i].offset % COLUMN_ALIGN == 0;
+        }
+    }
+    if (!ok) {
+        std::fprintf(stderr, "[Columns] %s: not a column file\n", path.c_str());
+        close();
+    }
+    return ok;
+}
+
+void ColumnFile::close()
+{
+    if (map_ != nullptr) {
+        ::munmap(const_cast<uint8_t *>(map_), map_len_);
+        map_ = nullptr;
+    }
+    map_len_ = 0;
+    columns_ = nullptr;
+    num_columns_ = 0;
+}
+
+const ColumnFile::Column *ColumnFile::find(std::string_view name) const
+{
+    for (size_t i = 0; i < num_columns_; i++) {
+        if (name == columns_[i].name) {
+            return &columns_[i];
+        }
+    }
+    return nullptr;
+}
+
+} // namespace mavlink
@@ -0,0 +1,101 @@
+/**
+ * @file dedup.cpp
+ * @brief Drops copies of frames that arrive over redundant links
+ */
+
+#include "dedup.h"
+
+namespace mavlink {
+
+Deduplicator::Deduplicator(std::chrono::milliseconds window, uint32_t capacity)
+    : window_(window),
+      ring_(capacity > 0 ? capacity : 1)
+{
+    // keep the index at most half full
+    size_t size = 4;
+    while (size < 2 * ring_.size()) {
+        size *= 2;
+    }
+    index_.assign(size, Slot{0, 0});
+    mask_ = size - 1;
+}
+
+uint64_t Deduplicator::key_of(const uint8_t *frame)
+{
+    const uint8_t len = frame[1];
+    if (frame[0] == MAVLINK_STX_MAVLINK1) {
+        const uint8_t *ck = &frame[MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + len];
+        return make_key(frame[3], frame[4], frame[5], frame[2], uint16_t(ck[0] | (ck[1] << 8)));
+    }
+    const uint8_t *ck = &frame[MAVLINK_NUM_HEADER_BYTES + len];
+    return make_key(frame[5], frame[6], frame[7] | (frame[8] << 8) | (uint32_t(frame[9]) << 16), frame[4],
+                    uint16_t(ck[0] | (ck[1] << 8)));
+}
+
+size_t Deduplicator::home(uint64_t key) const
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return size_t(key) & mask_;
+}
+
+void Deduplicator::pop_oldest()
+{
+    // find the index slot of the oldest entry
+    size_t i = home(ring_[head_].key);
+    while (index_[i].pos != head_ + 1) {
+        i = (i + 1) & mask_;
+    }
+    // empty it, moving later slots of the probe run back so they can still be found
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask_;
+        if (index_[j].pos == 0) {
+            break;
+        }
+        const size_t h = home(index_[j].key);
+        // slot j stays if its home lies cyclically in (i, j]
+        if (((j - h) & mask_) < ((j - i) & mask_)) {
+            continue;
+        }
+        index_[i] = index_[j];
+        i = j;
+    }
+    index_[i].pos = 0;
+    head_ = head_ + 1 == ring_.size() ? 0 : head_ + 1;
+    count_--;
+}
+
+bool Deduplicator::first(uint64_t key, Clock::time_point now)
+{
+    while (count_ > 0 && now - ring_[head_].time > window_) {
+        pop_oldest();
+    }
+    size_t i = home(key);
+    while (index_[i].pos != 0) {
+        if (index_[i].key == key) {
+            duplicates_++;
+            return false;
+        }
+        i = (i + 1) & mask_;
+    }
+    if (count_ == ring_.size()) {
+        pop_oldest();
+        // the slot for key may have moved
+        i = home(key);
+        while (index_[i].pos != 0) {
+            i = (i + 1) & mask_;
+        }
+    }
+    size_t pos = head_ + count_;
+    if (pos >= ring_.size()) {
+        pos -= ring_.size();
+    }
+    ring_[pos] = Entry{key, now};
+    index_[i] = Slot{key, uint32_t(pos + 1)};
+    count_++;
+    return true;
+}
+
+} // namespace mavlink
@@ -0,0 +1,115 @@
+/**
+ * @file egress.cpp
+ * @brief Batches outgoing frames into datagrams per link
+ */
+
+#include "egress.h"
+
+#include "gateway_mavlink.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mavlink {
+
+EgressBatcher::EgressBatcher(const EgressConfig &config)
+    : config_(config)
+{
+    config_.mtu = std::max<size_t>(config_.mtu, MAVLINK_MAX_PACKET_LEN);
+    config_.max_datagrams = std::max<size_t>(config_.max_datagrams, 1);
+}
+
+EgressBatcher::Queue &EgressBatcher::queue_for(Link &link)
+{
+    std::unique_ptr<Queue> &queue = queues_[&link];
+    if (!queue) {
+        queue.reset(new Queue());
+        queue->link = &link;
+        queue->buf.resize(config_.mtu * config_.max_datagrams);
+        queue->datagrams.reserve(config_.max_datagrams);
+        queue->frames.reserve(config_.max_datagrams);
+    }
+    return *queue;
+}
+
+size_t EgressBatcher::add(Link &link, const uint8_t *frame, size_t len, Clock::time_point now)
+{
+    Queue &queue = queue_for(link);
+    size_t sent = 0;
+
+    if (!queue.active) {
+        queue.active = true;
+        queue.deadline = now + config_.max_delay;
+        active_.push_back(&queue);
+    }
+    if (queue.datagrams.empty() || queue.datagrams.back().iov_len + len > config_.mtu) {
+        if (queue.datagrams.size() == config_.max_datagrams) {
+            sent = send(queue);
+            // the queue now starts with this frame
+            queue.deadline = now + config_.max_delay;
+        }
+        queue.datagrams.push_back({&queue.buf[queue.used], 0});
+        queue.frames.push_back(0);
+    }
+    std::memcpy(&queue.buf[queue.used], frame, len);
+    queue.used += len;
+    queue.datagrams.back().iov_len += len;
+    queue.frames.back()++;
+    return sent;
+}
+
+size_t EgressBatcher::flush_due(Clock::time_point now)
+{
+    size_t sent = 0;
+    size_t i = 0;
+    while (i < active_.size()) {
+        Queue &queue = *active_[i];
+        if (queue.deadline > now) {
+            i++;
+            continue;
+        }
+        sent += send(queue);
+        queue.active = false;
+        active_[i] = active_.back();
+        active_.pop_back();
+    }
+    return sent;
+}
+
+size_t EgressBatcher::flush()
+{
+    return flush_due(Clock::time_point::max());
+}
+
+EgressBatcher::Clock::time_point EgressBatcher::next_deadline() const
+{
+    Clock::time_point next = Clock::time_point::max();
+    for (const Queue *queue : active_) {
+        next = std::min(next, queue->deadline);
+    }
+    return next;
+}
+
+size_t EgressBatcher::send(Queue &queue)
+{
+    const size_t count = queue.datagrams.size();
+    const size_t done = count > 0 ? queue.link->write_datagrams(queue.datagrams.data(), count) : 0;
+    size_t sent = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i < done) {
+            sent += queue.frames[i];
+        } else {
+            stats_.dropped += queue.frames[i];
+        }
+    }
+    stats_.flushes++;
+    stats_.datagrams += done;
+    stats_.frames += sent;
+
+    queue.datagrams.clear();
+    queue.frames.clear();
+    queue.used = 0;
+    return sent;
+}
+
+} // namespace mavlink
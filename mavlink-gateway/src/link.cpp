@@ -0,0 +1,446 @@
+/**
+ * @file link.cpp
+ * @brief Byte stream / datagram endpoints served by the router
+ */
+
+#include "link.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace mavlink {
+
+namespace {
+
+constexpr uint64_t PEER_VALID = 1ULL << 48;
+constexpr size_t MAX_DATAGRAMS_PER_CALL = 64;
+
+// a closed TCP peer must fail the write, not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+uint64_t pack_peer(const struct sockaddr_in &addr)
+{
+    return PEER_VALID | (uint64_t(ntohs(addr.sin_port)) << 32) | ntohl(addr.sin_addr.s_addr);
+}
+
+struct sockaddr_in unpack_peer(uint64_t peer)
+{
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(uint16_t(peer >> 32));
+    addr.sin_addr.s_addr = htonl(uint32_t(peer));
+    return addr;
+}
+
+bool baud_to_speed(uint32_t baud, speed_t &speed)
+{
+    switch (baud) {
+    case 9600: speed = B9600; return true;
+    case 19200: speed = B19200; return true;
+    case 38400: speed = B38400; return true;
+    case 57600: speed = B57600; return true;
+    case 115200: speed = B115200; return true;
+    case 230400: speed = B230400; return true;
+#ifdef B460800
+    case 460800: speed = B460800; return true;
+    case 921600: speed = B921600; return true;
+#endif
+    default: return false;
+    }
+}
+
+} // namespace
+
+ssize_t Link::read_datagrams(const struct iovec *datagrams, size_t count, size_t *lens)
+{
+    size_t i = 0;
+    for (; i < count; i++) {
+        const ssize_t n = read(static_cast<uint8_t *>(datagrams[i].iov_base), datagrams[i].iov_len);
+        if (n < 0) {
+            return i > 0 ? ssize_t(i) : -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        lens[i] = size_t(n);
+    }
+    return ssize_t(i);
+}
+
+size_t Link::write_datagrams(const struct iovec *datagrams, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (!write(static_cast<const uint8_t *>(datagrams[i].iov_base), datagrams[i].iov_len)) {
+            return i;
+        }
+    }
+    return count;
+}
+
+UdpLink::UdpLink(uint16_t local_port, const std::string &remote_host, uint16_t remote_port)
+    : local_port_(local_port)
+{
+    sock_ = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock_ < 0) {
+        std::perror("[UdpLink] socket");
+        return;
+    }
+    const int on = 1;
+    ::setsockopt(sock_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    ::setsockopt(sock_, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    ::fcntl(sock_, F_SETFL, ::fcntl(sock_, F_GETFL) | O_NONBLOCK);
+
+    struct sockaddr_in local {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(local_port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(sock_, reinterpret_cast<struct sockaddr *>(&local), sizeof(local)) < 0) {
+        std::perror("[UdpLink] bind");
+        ::close(sock_);
+        sock_ = -1;
+        return;
+    }
+
+    if (!remote_host.empty()) {
+        struct sockaddr_in remote {};
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(remote_port);
+        if (::inet_pton(AF_INET, remote_host.c_str(), &remote.sin_addr) == 1) {
+            peer_.store(pack_peer(remote), std::memory_order_relaxed);
+            fixed_peer_ = true;
+        } else {
+            std::fprintf(stderr, "[UdpLink] invalid address %s\n", remote_host.c_str());
+        }
+    }
+}
+
+UdpLink::~UdpLink()
+{
+    if (sock_ >= 0) {
+        ::close(sock_);
+    }
+}
+
+ssize_t UdpLink::read(uint8_t *buf, size_t len)
+{
+    struct sockaddr_in from {};
+    socklen_t from_len = sizeof(from);
+    const ssize_t n = ::recvfrom(sock_, buf, len, 0, reinterpret_cast<struct sockaddr *>(&from), &from_len);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    learn_peer(from);
+    return n;
+}
+
+ssize_t UdpLink::read_datagrams(const struct iovec *datagrams, size_t count, size_t *lens)
+{
+#ifdef __linux__
+    struct sockaddr_in from[MAX_DATAGRAMS_PER_CALL];
+    struct mmsghdr msgs[MAX_DATAGRAMS_PER_CALL];
+    const size_t n = std::min(count, MAX_DATAGRAMS_PER_CALL);
+    for (size_t i = 0; i < n; i++) {
+        std::memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = &from[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        msgs[i].msg_hdr.msg_iov = const_cast<struct iovec *>(&datagrams[i]);
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    const int r = ::recvmmsg(sock_, msgs, unsigned(n), MSG_DONTWAIT, nullptr);
+    if (r < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    for (int i = 0; i < r; i++) {
+        lens[i] = msgs[i].msg_len;
+    }
+    if (r > 0) {
+        learn_peer(from[r - 1]);
+    }
+    return r;
+#else
+    return Link::read_datagrams(datagrams, count, lens);
+#endif
+}
+
+void UdpLink::learn_peer(const struct sockaddr_in &from)
+{
+    if (!fixed_peer_) {
+        const uint64_t peer = pack_peer(from);
+        if (peer_.load(std::memory_order_relaxed) != peer) {
+            peer_.store(peer, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool UdpLink::write(const uint8_t *buf, size_t len)
+{
+    const uint64_t peer = peer_.load(std::memory_order_relaxed);
+    if (!(peer & PEER_VALID)) {
+        // nobody to send to yet
+        return false;
+    }
+    const struct sockaddr_in to = unpack_peer(peer);
+    return ::sendto(sock_, buf, len, 0, reinterpret_cast<const struct sockaddr *>(&to), sizeof(to)) == ssize_t(len);
+}
+
+size_t UdpLink::write_datagrams(const struct iovec *datagrams, size_t count)
+{
+#ifdef __linux__
+    const uint64_t peer = peer_.load(std::memory_order_relaxed);
+    if (!(peer & PEER_VALID)) {
+        return 0;
+    }
+    struct sockaddr_in to = unpack_peer(peer);
+    struct mmsghdr msgs[MAX_DATAGRAMS_PER_CALL];
+    size_t sent = 0;
+    while (sent < count) {
+        const size_t n = std::min(count - sent, MAX_DATAGRAMS_PER_CALL);
+        for (size_t i = 0; i < n; i++) {
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &to;
+            msgs[i].msg_hdr.msg_namelen = sizeof(to);
+            msgs[i].msg_hdr.msg_iov = const_cast<struct iovec *>(&datagrams[sent + i]);
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int r = ::sendmmsg(sock_, msgs, unsigned(n), 0);
+        if (r <= 0) {
+            break;
+        }
+        sent += size_t(r);
+        if (size_t(r) < n) {
+            // socket buffer full, the rest would be dropped anyway
+            break;
+        }
+    }
+    return sent;
+#else
+    return Link::write_datagrams(datagrams, count);
+#endif
+}
+
+std::string UdpLink::name() const
+{
+    return "udp:" + std::to_string(local_port_);
+}
+
+SerialLink::SerialLink(const std::string &path, uint32_t baud)
+    : path_(path),
+      baud_(baud)
+{
+    speed_t speed;
+    if (!baud_to_speed(baud, speed)) {
+        std::fprintf(stderr, "[SerialLink] unsupported baud rate %u\n", baud);
+        return;
+    }
+    fd_ = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd_ < 0) {
+        std::perror("[SerialLink] open");
+        return;
+    }
+    struct termios tio {};
+    if (::tcgetattr(fd_, &tio) < 0) {
+        std::perror("[SerialLink] tcgetattr");
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+    ::cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    ::cfsetispeed(&tio, speed);
+    ::cfsetospeed(&tio, speed);
+    if (::tcsetattr(fd_, TCSANOW, &tio) < 0) {
+        std::perror("[SerialLink] tcsetattr");
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+SerialLink::~SerialLink()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+ssize_t SerialLink::read(uint8_t *buf, size_t len)
+{
+    const ssize_t n = ::read(fd_, buf, len);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    return n;
+}
+
+bool SerialLink::write(const uint8_t *buf, size_t len)
+{
+    // a frame must not be cut short, wait out a full driver buffer
+    while (len > 0) {
+        const ssize_t n = ::write(fd_, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            struct pollfd pfd {fd_, POLLOUT, 0};
+            if (::poll(&pfd, 1, 100) <= 0) {
+                return false;
+            }
+            continue;
+        }
+        buf += n;
+        len -= size_t(n);
+    }
+    return true;
+}
+
+std::string SerialLink::name() const
+{
+    return "serial:" + path_;
+}
+
+TcpLink::TcpLink(const std::string &host, uint16_t port)
+    : host_(host),
+      port_(port)
+{
+    struct sockaddr_in remote {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &remote.sin_addr) != 1) {
+        std::fprintf(stderr, "[TcpLink] invalid address %s\n", host.c_str());
+        return;
+    }
+    sock_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock_ < 0) {
+        std::perror("[TcpLink] socket");
+        return;
+    }
+    if (::connect(sock_, reinterpret_cast<struct sockaddr *>(&remote), sizeof(remote)) < 0) {
+        std::perror("[TcpLink] connect");
+        ::close(sock_);
+        sock_ = -1;
+        return;
+    }
+    const int on = 1;
+    ::setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+    ::setsockopt(sock_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    ::fcntl(sock_, F_SETFL, ::fcntl(sock_, F_GETFL) | O_NONBLOCK);
+}
+
+TcpLink::~TcpLink()
+{
+    if (sock_ >= 0) {
+        ::close(sock_);
+    }
+}
+
+ssize_t TcpLink::read(uint8_t *buf, size_t len)
+{
+    const ssize_t n = ::recv(sock_, buf, len, 0);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    // 0 means the server closed the connection
+    return n == 0 ? -1 : n;
+}
+
+bool TcpLink::write(const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        const ssize_t n = ::send(sock_, buf, len, SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            struct pollfd pfd {sock_, POLLOUT, 0};
+            if (::poll(&pfd, 1, 100) <= 0) {
+                return false;
+            }
+            continue;
+        }
+        buf += n;
+        len -= size_t(n);
+    }
+    return true;
+}
+
+std::string TcpLink::name() const
+{
+    return "tcp:" + host_ + ":" + std::to_string(port_);
+}
+
+std::unique_ptr<Link> open_link(const std::string &spec)
+{
+    if (spec.compare(0, 7, "serial:") == 0) {
+        const std::string rest = spec.substr(7);
+        const size_t baud_sep = rest.rfind(':');
+        uint32_t baud = 57600;
+        std::string path = rest;
+        if (baud_sep != std::string::npos) {
+            path = rest.substr(0, baud_sep);
+            baud = uint32_t(std::atol(rest.substr(baud_sep + 1).c_str()));
+        }
+        std::unique_ptr<SerialLink> link(new SerialLink(path, baud));
+        if (!link->is_open()) {
+            return nullptr;
+        }
+        return link;
+    }
+    if (spec.compare(0, 4, "tcp:") == 0) {
+        const size_t port_sep = spec.rfind(':');
+        if (port_sep == 3) {
+            return nullptr;
+        }
+        std::unique_ptr<TcpLink> link(new TcpLink(spec.substr(4, port_sep - 4),
+                                                  uint16_t(std::atoi(spec.substr(port_sep + 1).c_str()))));
+        if (!link->is_open()) {
+            return nullptr;
+        }
+        return link;
+    }
+    if (spec.compare(0, 4, "udp:") != 0) {
+        return nullptr;
+    }
+    const std::string rest = spec.substr(4);
+    const size_t host_sep = rest.find(':');
+    const uint16_t local_port = uint16_t(std::atoi(rest.substr(0, host_sep).c_str()));
+    std::unique_ptr<UdpLink> link;
+    if (host_sep == std::string::npos) {
+        link.reset(new UdpLink(local_port));
+    } else {
+        const size_t port_sep = rest.rfind(':');
+        if (port_sep == host_sep) {
+            return nullptr;
+        }
+        link.reset(new UdpLink(local_port, rest.substr(host_sep + 1, port_sep - host_sep - 1),
+                               uint16_t(std::atoi(rest.substr(port_sep + 1).c_str()))));
+    }
+    if (!link->is_open()) {
+        return nullptr;
+    }
+    return link;
+}
+
+} // namespace mavlink
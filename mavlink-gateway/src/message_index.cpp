@@ -0,0 +1,246 @@
+/**
+ * @file message_index.cpp
+ * @brief Constant time lookup of message and field info by name
+ *
+ * The message and field name tables are perfect hashed while compiling
+ * this file: every name gets a 64 bit FNV-1a hash, hashes are spread over
+ * buckets, and each bucket gets the first seed that moves all its names to
+ * free slots. A lookup is one name hash, one bucket seed and one slot.
+ */
+
+#include "message_index.h"
+
+#include <array>
+
+namespace mavlink {
+
+namespace {
+
+constexpr mavlink_message_info_t message_info[] = MAVLINK_MESSAGE_INFO;
+constexpr size_t num_messages = sizeof(message_info) / sizeof(message_info[0]);
+
+constexpr uint64_t hash_name(std::string_view name, uint64_t h = 0xcbf29ce484222325ULL)
+{
+    for (char c : name) {
+        h = (h ^ uint8_t(c)) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+constexpr uint64_t hash_field(uint32_t message, std::string_view name)
+{
+    return hash_name(name, 0xcbf29ce484222325ULL ^ ((message + 1) * 0x9e3779b97f4a7c15ULL));
+}
+
+constexpr size_t table_size(size_t keys)
+{
+    size_t size = 1;
+    while (size < 2 * keys) {
+        size *= 2;
+    }
+    return size;
+}
+
+template <size_t Slots>
+struct PerfectHash {
+    static constexpr size_t buckets = Slots / 4;
+
+    std::array<uint16_t, buckets> seed{};
+    std::array<uint16_t, Slots> slot{};   // key + 1, 0 if empty
+
+    static constexpr size_t bucket_of(uint64_t h)
+    {
+        return size_t(h >> 40) & (buckets - 1);
+    }
+
+    static constexpr size_t slot_of(uint64_t h, uint16_t seed)
+    {
+        h ^= seed * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return size_t(h) & (Slots - 1);
+    }
+
+    /**
+     * key + 1 of the only key that can hash to h, or 0
+     */
+    constexpr uint16_t find(uint64_t h) const
+    {
+        return slot[slot_of(h, seed[bucket_of(h)])];
+    }
+};
+
+template <size_t Slots, size_t Keys>
+constexpr PerfectHash<Slots> build_hash(const std::array<uint64_t, Keys> &hashes)
+{
+    constexpr size_t buckets = PerfectHash<Slots>::buckets;
+    constexpr size_t max_bucket = 16;
+    PerfectHash<Slots> table{};
+    std::array<uint16_t, buckets> size{};
+    std::array<std::array<uint16_t, max_bucket>, buckets> members{};
+    std::array<bool, Slots> used{};
+
+    static_assert(Keys < 0xffff, "too many keys");
+    for (size_t k = 0; k < Keys; k++) {
+        const size_t b = PerfectHash<Slots>::bucket_of(hashes[k]);
+        if (size[b] == max_bucket) {
+            throw "bucket too large";
+        }
+        members[b][size[b]++] = uint16_t(k);
+    }
+
+    // largest buckets first, while there are many free slots
+    for (size_t n = max_bucket; n > 0; n--) {
+        for (size_t b = 0; b < buckets; b++) {
+            if (size[b] != n) {
+                continue;
+            }
+            uint32_t seed = 0;
+            for (;; seed++) {
+                if (seed > 0xffff) {
+                    throw "no seed for bucket";
+                }
+                std::array<size_t, max_bucket> slots{};
+                bool fits = true;
+                for (size_t i = 0; i < n && fits; i++) {
+                    slots[i] = PerfectHash<Slots>::slot_of(hashes[members[b][i]], uint16_t(seed));
+                    fits = !used[slots[i]];
+                    for (size_t j = 0; j < i && fits; j++) {
+                        fits = slots[j] != slots[i];
+                    }
+                }
+                if (fits) {
+                    for (size_t i = 0; i < n; i++) {
+                        used[slots[i]] = true;
+                        table.slot[slots[i]] = uint16_t(members[b][i] + 1);
+                    }
+                    break;
+                }
+            }
+            table.seed[b] = uint16_t(seed);
+        }
+    }
+    return table;
+}
+
+// messages
+
+constexpr std::array<uint64_t, num_messages> message_hashes = [] {
+    std::array<uint64_t, num_messages> hashes{};
+    for (size_t i = 0; i < num_messages; i++) {
+        hashes[i] = hash_name(message_info[i].name);
+    }
+    return hashes;
+}();
+
+constexpr auto message_hash = build_hash<table_size(num_messages)>(message_hashes);
+
+// fields of all messages, in message order
+
+constexpr size_t num_fields = [] {
+    size_t n = 0;
+    for (size_t i = 0; i < num_messages; i++) {
+        n += message_info[i].num_fields;
+    }
+    return n;
+}();
+
+struct FieldKey {
+    uint16_t message;
+    uint8_t field;
+};
+
+constexpr std::array<FieldKey, num_fields> field_keys = [] {
+    std::array<FieldKey, num_fields> keys{};
+    size_t n = 0;
+    for (size_t i = 0; i < num_messages; i++) {
+        for (size_t f = 0; f < message_info[i].num_fields; f++) {
+            keys[n++] = FieldKey{uint16_t(i), uint8_t(f)};
+        }
+    }
+    return keys;
+}();
+
+constexpr std::array<uint64_t, num_fields> field_hashes = [] {
+    std::array<uint64_t, num_fields> hashes{};
+    for (size_t k = 0; k < num_fields; k++) {
+        hashes[k] = hash_field(field_keys[k].message,
+                               message_info[field_keys[k].message].fields[field_keys[k].field].name);
+    }
+    return hashes;
+}();
+
+constexpr auto field_hash = build_hash<table_size(num_fields)>(field_hashes);
+
+} // namespace
+
+const mavlink_message_info_t *find_message(std::string_view name)
+{
+    const uint64_t h = hash_name(name);
+    const uint16_t k = message_hash.find(h);
+    if (k == 0 || message_hashes[k - 1] != h || name != message_info[k - 1].name) {
+        return nullptr;
+    }
+    return &message_info[k - 1];
+}
+
+const mavlink_message_info_t *find_message(uint32_t msgid)
+{
+    // the table is sorted by id
+    size_t low = 0, high = num_messages;
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+        if (message_info[mid].msgid < msgid) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return (low < num_messages && message_info[low].msgid == msgid) ? &message_info[low] : nullptr;
+}
+
+const mavlink_field_info_t *find_field(const mavlink_message_info_t &message, std::string_view name)
+{
+    if (&message < message_info || &message >= message_info + num_messages) {
+        // not from find_message(), search its fields
+        for (unsigned f = 0; f < message.num_fields; f++) {
+            if (name == message.fields[f].name) {
+                return &message.fields[f];
+            }
+        }
+        return nullptr;
+    }
+    const uint32_t index = uint32_t(&message - message_info);
+    const uint64_t h = hash_field(index, name);
+    const uint16_t k = field_hash.find(h);
+    if (k == 0 || field_hashes[k - 1] != h || field_keys[k - 1].message != index) {
+        return nullptr;
+    }
+    const mavlink_field_info_t &field = message.fields[field_keys[k - 1].field];
+    return name == field.name ? &field : nullptr;
+}
+
+size_t field_type_size(mavlink_message_type_t type)
+{
+    switch (type) {
+    case MAVLINK_TYPE_CHAR:
+    case MAVLINK_TYPE_UINT8_T:
+    case MAVLINK_TYPE_INT8_T:
+        return 1;
+    case MAVLINK_TYPE_UINT16_T:
+    case MAVLINK_TYPE_INT16_T:
+        return 2;
+    case MAVLINK_TYPE_UINT32_T:
+    case MAVLINK_TYPE_INT32_T:
+    case MAVLINK_TYPE_FLOAT:
+        return 4;
+    case MAVLINK_TYPE_UINT64_T:
+    case MAVLINK_TYPE_INT64_T:
+    case MAVLINK_TYPE_DOUBLE:
+        return 8;
+    }
+    return 0;
+}
+
+} // namespace mavlink
@@ -0,0 +1,166 @@
+/**
+ * @file parser.cpp
+ * @brief Reentrant MAVLink parser and parser pool
+ */
+
+#include "parser.h"
+
+#include <cstring>
+
+namespace mavlink {
+
+SigningStreamTable::SigningStreamTable(uint32_t max_streams)
+{
+    // at most 3/4 of the slots are used
+    uint32_t slots = 4;
+    while (slots - slots / 4 < max_streams) {
+        slots *= 2;
+    }
+    slots_.resize(slots);
+    mavlink_signing_stream_table_init(&table_, slots_.data(), slots);
+    std::memset(&streams_, 0, sizeof(streams_));
+    streams_.table = &table_;
+}
+
+SequenceStats::SequenceStats(uint32_t max_streams)
+{
+    // at most 3/4 of the streams are used
+    uint32_t size = 4;
+    while (size - size / 4 < max_streams) {
+        size *= 2;
+    }
+    streams_.resize(size);
+    mavlink_seq_table_init(&table_, streams_.data(), size);
+}
+
+SequenceStats::Totals SequenceStats::totals() const
+{
+    Totals totals;
+    for_each([&](uint8_t, uint8_t, const mavlink_seq_stream_t &stream) {
+        totals.received += stream.received;
+        totals.lost += stream.lost;
+        totals.duplicate += stream.duplicate;
+        totals.reordered += stream.reordered;
+    });
+    return totals;
+}
+
+SequenceStats::Totals SequenceStats::update(uint8_t sysid, uint8_t compid, uint8_t seq)
+{
+    Totals before;
+    if (const mavlink_seq_stream_t *stream = find(sysid, compid)) {
+        before = {stream->received, stream->lost, stream->duplicate, stream->reordered};
+    }
+    mavlink_seq_table_update(&table_, sysid, compid, seq);
+    Totals delta;
+    if (const mavlink_seq_stream_t *stream = find(sysid, compid)) {
+        delta = {stream->received - before.received, stream->lost - before.lost,
+                 stream->duplicate - before.duplicate, stream->reordered - before.reordered};
+    }
+    return delta;
+}
+
+void SequenceStats::clear()
+{
+    mavlink_seq_table_init(&table_, streams_.data(), uint32_t(streams_.size()));
+}
+
+Parser::Parser()
+{
+    reset();
+}
+
+void Parser::reset()
+{
+    std::memset(&rxmsg_, 0, sizeof(rxmsg_));
+    std::memset(&status_, 0, sizeof(status_));
+    std::memset(&signing_, 0, sizeof(signing_));
+    std::memset(&signing_streams_, 0, sizeof(signing_streams_));
+    status_.parse_state = MAVLINK_PARSE_STATE_IDLE;
+}
+
+void Parser::enable_signing(const uint8_t key[32], mavlink_accept_unsigned_t accept_unsigned,
+                            SigningStreamTable *streams)
+{
+    std::memcpy(signing_.secret_key, key, sizeof(signing_.secret_key));
+    signing_.accept_unsigned_callback = accept_unsigned;
+    status_.signing = &signing_;
+    status_.signing_streams = streams != nullptr ? streams->streams() : &signing_streams_;
+}
+
+void Parser::disable_signing()
+{
+    status_.signing = nullptr;
+    status_.signing_streams = nullptr;
+}
+
+void Parser::track_sequences(SequenceStats *stats)
+{
+    status_.seq_table = stats != nullptr ? stats->table() : nullptr;
+}
+
+bool Parser::parse_char(uint8_t c, mavlink_message_t &msg)
+{
+    const uint8_t framing = mavlink_frame_char_buffer(&rxmsg_, &status_, c, &msg, nullptr);
+    if (framing == MAVLINK_FRAMING_BAD_CRC || framing == MAVLINK_FRAMING_BAD_SIGNATURE) {
+        // same recovery as mavlink_parse_char()
+        _mav_parse_error(&status_);
+        status_.msg_received = MAVLINK_FRAMING_INCOMPLETE;
+        status_.parse_state = MAVLINK_PARSE_STATE_IDLE;
+        if (c == MAVLINK_STX) {
+            status_.parse_state = MAVLINK_PARSE_STATE_GOT_STX;
+            rxmsg_.len = 0;
+            mavlink_start_checksum(&rxmsg_);
+        }
+        return false;
+    }
+    return framing == MAVLINK_FRAMING_OK;
+}
+
+ParserPool::ParserPool(size_t chunk_size)
+    : chunk_size_(chunk_size > 0 ? chunk_size : 1)
+{
+}
+
+Parser *ParserPool::acquire()
+{
+    Parser *parser;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) {
+            chunks_.emplace_back(new Parser[chunk_size_]);
+            Parser *chunk = chunks_.back().get();
+            // hand out the chunk front to back
+            for (size_t i = chunk_size_; i > 0; i--) {
+                free_.push_back(&chunk[i - 1]);
+            }
+        }
+        parser = free_.back();
+        free_.pop_back();
+    }
+    parser->reset();
+    return parser;
+}
+
+void ParserPool::release(Parser *parser)
+{
+    if (parser == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(parser);
+}
+
+size_t ParserPool::capacity() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size() * chunk_size_;
+}
+
+size_t ParserPool::in_use() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size() * chunk_size_ - free_.size();
+}
+
+} // namespace mavlink
@@ -0,0 +1,510 @@
+/**
+ * @file recorder.cpp
+ * @brief Append-only recording of every frame, with time and message indexes
+ */
+
+#include "recorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mavlink {
+
+namespace {
+
+const uint8_t SEGMENT_MAGIC[8] = {'M', 'A', 'V', 'R', 'E', 'C', '0', '1'};
+const uint8_t INDEX_MAGIC[8] = {'M', 'A', 'V', 'I', 'D', 'X', '0', '1'};
+constexpr uint32_t SEGMENT_VERSION = 1;
+constexpr size_t FLUSH_BATCH = 256;   // records merged per pass before the header is updated
+
+std::string segment_path(const RecorderConfig &config, unsigned n, const char *ext)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "-%06u.%s", n, ext);
+    return config.directory + "/" + config.prefix + name;
+}
+
+std::string index_path(const std::string &segment)
+{
+    return segment.substr(0, segment.size() - 4) + ".idx";
+}
+
+bool write_all(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(buf);
+    while (len > 0) {
+        const ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= size_t(n);
+    }
+    return true;
+}
+
+} // namespace
+
+bool Recorder::Source::record(uint16_t link, const uint8_t *frame, uint16_t len, uint64_t time_us)
+{
+    Item *item = ring_.claim();
+    if (item == nullptr) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    item->time_us = time_us;
+    item->link = link;
+    item->len = len;
+    std::memcpy(item->frame, frame, len);
+    ring_.publish();
+    return true;
+}
+
+Recorder::Recorder(const RecorderConfig &config)
+    : config_(config),
+      sources_(config.max_sources)
+{
+    config_.segment_size = std::max<size_t>(config_.segment_size, sizeof(SegmentHeader) + 64 * 1024);
+}
+
+Recorder::~Recorder()
+{
+    stop();
+}
+
+uint64_t Recorder::now_us()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Recorder::Source *Recorder::add_source()
+{
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    const size_t n = num_sources_.load(std::memory_order_relaxed);
+    if (n == sources_.size()) {
+        return nullptr;
+    }
+    sources_[n].reset(new Source(config_.queue_size));
+    // the flusher picks the new source up on its next pass
+    num_sources_.store(n + 1, std::memory_order_release);
+    return sources_[n].get();
+}
+
+RecorderStats Recorder::stats() const
+{
+    RecorderStats stats;
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.segments = segments_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    const size_t n = num_sources_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; i++) {
+        stats.dropped += sources_[i]->dropped_.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+bool Recorder::start()
+{
+    if (running_.load()) {
+        return true;
+    }
+    if (!open_segment()) {
+        return false;
+    }
+    running_.store(true);
+    flusher_ = std::thread(&Recorder::run_flusher, this);
+    return true;
+}
+
+void Recorder::stop()
+{
+    if (!running_.exchange(false)) {
+        return;
+    }
+    flusher_.join();
+    close_segment();
+}
+
+bool Recorder::open_segment()
+{
+    // never overwrite an earlier recording
+    for (;; next_segment_++) {
+        path_ = segment_path(config_, next_segment_, "rec");
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd_ >= 0 || errno != EEXIST) {
+            break;
+        }
+    }
+    next_segment_++;
+    if (fd_ < 0) {
+        std::perror(("[Recorder] " + path_).c_str());
+        return false;
+    }
+    // allocate the blocks now: a write to a hole of a sparse file through
+    // the mapping raises SIGBUS if the disk fills up
+#ifdef __APPLE__
+    const int err = ::ftruncate(fd_, off_t(config_.segment_size)) < 0 ? errno : 0;
+#else
+    const int err = ::posix_fallocate(fd_, 0, off_t(config_.segment_size));
+#endif
+    if (err != 0) {
+        std::fprintf(stderr, "[Recorder] %s: %s\n", path_.c_str(), std::strerror(err));
+        ::close(fd_);
+        ::unlink(path_.c_str());
+        fd_ = -1;
+        return false;
+    }
+    void *map = ::mmap(nullptr, config_.segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        std::perror("[Recorder] mmap");
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    map_ = static_cast<uint8_t *>(map);
+
+    SegmentHeader header {};
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(header.magic));
+    header.version = SEGMENT_VERSION;
+    header.header_len = sizeof(SegmentHeader);
+    header.end = sizeof(SegmentHeader);
+    std::memcpy(map_, &header, sizeof(header));
+    pos_ = sizeof(SegmentHeader);
+    time_index_.clear();
+    msgid_index_.clear();
+    block_msgids_.clear();
+    block_start_ = 0;
+    segments_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void Recorder::close_segment()
+{
+    if (fd_ < 0) {
+        return;
+    }
+    reinterpret_cast<SegmentHeader *>(map_)->end = pos_;
+    ::munmap(map_, config_.segment_size);
+    map_ = nullptr;
+    if (::ftruncate(fd_, off_t(pos_)) < 0) {
+        std::perror("[Recorder] ftruncate");
+    }
+    ::close(fd_);
+    fd_ = -1;
+
+    const std::string idx = index_path(path_);
+    const int fd = ::open(idx.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::perror(("[Recorder] " + idx).c_str());
+        return;
+    }
+    IndexHeader header {};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.time_entries = uint32_t(time_index_.size());
+    header.msgids = uint32_t(msgid_index_.size());
+    bool ok = write_all(fd, &header, sizeof(header)) &&
+              write_all(fd, time_index_.data(), time_index_.size() * sizeof(TimeEntry));
+    for (const auto &entry : msgid_index_) {
+        const uint32_t head[2] = {entry.first, uint32_t(entry.second.size())};
+        ok = ok && write_all(fd, head, sizeof(head)) &&
+             write_all(fd, entry.second.data(), entry.second.size() * sizeof(uint64_t));
+    }
+    if (!ok) {
+        std::perror(("[Recorder] " + idx).c_str());
+    }
+    ::close(fd);
+}
+
+void Recorder::append(const Source::Item &item)
+{
+    const size_t len = RECORD_HEADER_LEN + item.len;
+    if (pos_ + len > config_.segment_size) {
+        close_segment();
+        if (!open_segment()) {
+            // the flusher stops writing, the sources count what they drop
+            std::fprintf(stderr, "[Recorder] rotation failed, recording stopped\n");
+            failed_.store(true, std::memory_order_relaxed);
+            return;
+        }
+    }
+    SegmentHeader *header = reinterpret_cast<SegmentHeader *>(map_);
+
+    // start a new index block every block_size bytes or block_time_us
+    if (time_index_.empty() || pos_ - block_start_ >= config_.block_size ||
+        item.time_us >= time_index_.back().time_us + config_.block_time_us) {
+        time_index_.push_back(TimeEntry{item.time_us, pos_});
+        block_start_ = pos_;
+        block_msgids_.clear();
+    }
+    const uint32_t msgid = msgid_of(item.frame);
+    if (std::find(block_msgids_.begin(), block_msgids_.end(), msgid) == block_msgids_.end()) {
+        block_msgids_.push_back(msgid);
+        msgid_index_[msgid].push_back(pos_);
+    }
+
+    uint8_t *p = map_ + pos_;
+    std::memcpy(p, &item.time_us, 8);
+    std::memcpy(p + 8, &item.link, 2);
+    std::memcpy(p + 10, &item.len, 2);
+    std::memcpy(p + RECORD_HEADER_LEN, item.frame, item.len);
+    pos_ += len;
+
+    if (header->first_time_us == 0) {
+        header->first_time_us = item.time_us;
+    }
+    header->last_time_us = item.time_us;
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(len, std::memory_order_relaxed);
+}
+
+void Recorder::run_flusher()
+{
+    std::vector<Source *> sources;
+    for (;;) {
+        // stop only once the sources have been drained
+        const bool stopping = !running_.load(std::memory_order_relaxed);
+        const size_t n = num_sources_.load(std::memory_order_acquire);
+        while (sources.size() < n) {
+            sources.push_back(sources_[sources.size()].get());
+        }
+
+        size_t written = 0;
+        while (written < FLUSH_BATCH && fd_ >= 0) {
+            // merge by receive time, each source is in order already
+            Source *oldest = nullptr;
+            Source::Item *item = nullptr;
+            for (Source *source : sources) {
+                Source::Item *front = source->ring_.front();
+                if (front != nullptr && (item == nullptr || front->time_us < item->time_us)) {
+                    oldest = source;
+                    item = front;
+                }
+            }
+            if (item == nullptr) {
+                break;
+            }
+            append(*item);
+            oldest->ring_.pop();
+            written++;
+        }
+        if (written > 0 && fd_ >= 0) {
+            // publish the batch to readers of a live segment
+            std::atomic_thread_fence(std::memory_order_release);
+            reinterpret_cast<SegmentHeader *>(map_)->end = pos_;
+        }
+        if (written == 0) {
+            if (stopping) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+RecordingReader::~RecordingReader()
+{
+    close();
+}
+
+bool RecordingReader::is_recording(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    uint8_t magic[sizeof(SEGMENT_MAGIC)] = {};
+    const bool ok = ::read(fd, magic, sizeof(magic)) == ssize_t(sizeof(magic)) &&
+                    std::memcmp(magic, SEGMENT_MAGIC, sizeof(magic)) == 0;
+    ::close(fd);
+    return ok;
+}
+
+bool RecordingReader::open(const std::string &path)
+{
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::perror(("[RecordingReader] " + path).c_str());
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(Recorder::SegmentHeader)) {
+        std::fprintf(stderr, "[RecordingReader] %s: not a recording\n", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *map = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::perror("[RecordingReader] mmap");
+        return false;
+    }
+    map_ = static_cast<const uint8_t *>(map);
+    map_len_ = size_t(st.st_size);
+
+    Recorder::SegmentHeader header;
+    std::memcpy(&header, map_, sizeof(header));
+    if (std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(header.magic)) != 0 || header.version != SEGMENT_VERSION ||
+        header.header_len < sizeof(header) || header.end > map_len_) {
+        std::fprintf(stderr, "[RecordingReader] %s: not a recording\n", path.c_str());
+        close();
+        return false;
+    }
+    header_len_ = header.header_len;
+    end_ = header.end;
+    first_time_us_ = header.first_time_us;
+    last_time_us_ = header.last_time_us;
+    pos_ = header_len_;
+    if (!load_index(index_path(path))) {
+        build_index();
+    }
+    return true;
+}
+
+void RecordingReader::close()
+{
+    if (map_ != nullptr) {
+        ::munmap(const_cast<uint8_t *>(map_), map_len_);
+        map_ = nullptr;
+    }
+    map_len_ = 0;
+    time_index_.clear();
+    msgid_index_.clear();
+}
+
+bool RecordingReader::load_index(const std::string &path)
+{
+    FILE *f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    Recorder::IndexHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 &&
+              std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0;
+    if (ok) {
+        time_index_.resize(header.time_entries);
+        ok = header.time_entries == 0 ||
+             std::fread(time_index_.data(), sizeof(Recorder::TimeEntry), header.time_entries, f) == header.time_entries;
+    }
+    for (uint32_t i = 0; ok && i < header.msgids; i++) {
+        uint32_t head[2];
+        ok = std::fread(head, sizeof(head), 1, f) == 1;
+        if (ok) {
+            std::vector<uint64_t> &offsets = msgid_index_[head[0]];
+            offsets.resize(head[1]);
+            ok = head[1] == 0 || std::fread(offsets.data(), sizeof(uint64_t), head[1], f) == head[1];
+        }
+    }
+    std::fclose(f);
+    if (!ok) {
+        time_index_.clear();
+        msgid_index_.clear();
+    }
+    return ok;
+}
+
+void RecordingReader::build_index()
+{
+    // same blocks as the recorder would have used with the default config
+    const RecorderConfig config;
+    std::vector<uint32_t> block_msgids;
+    uint64_t block_start = 0;
+    Record record;
+    for (uint64_t offset = header_len_; record_at(offset, record); offset += Recorder::RECORD_HEADER_LEN + record.len) {
+        if (time_index_.empty() || offset - block_start >= config.block_size ||
+            record.time_us >= time_index_.back().time_us + config.block_time_us) {
+            time_index_.push_back(Recorder::TimeEntry{record.time_us, offset});
+            block_start = offset;
+            block_msgids.clear();
+        }
+        if (std::find(block_msgids.begin(), block_msgids.end(), record.msgid) == block_msgids.end()) {
+            block_msgids.push_back(record.msgid);
+            msgid_index_[record.msgid].push_back(offset);
+        }
+    }
+}
+
+bool RecordingReader::record_at(uint64_t offset, Record &record) const
+{
+    if (offset + Recorder::RECORD_HEADER_LEN > end_) {
+        return false;
+    }
+    const uint8_t *p = map_ + offset;
+    std::memcpy(&record.time_us, p, 8);
+    std::memcpy(&record.link, p + 8, 2);
+    std::memcpy(&record.len, p + 10, 2);
+    if (record.len == 0 || offset + Recorder::RECORD_HEADER_LEN + record.len > end_) {
+        return false;
+    }
+    record.frame = p + Recorder::RECORD_HEADER_LEN;
+    record.msgid = Recorder::msgid_of(record.frame);
+    record.offset = offset;
+    return true;
+}
+
+bool RecordingReader::next(Record &record)
+{
+    if (!record_at(pos_, record)) {
+        return false;
+    }
+    pos_ += Recorder::RECORD_HEADER_LEN + record.len;
+    return true;
+}
+
+void RecordingReader::seek(uint64_t time_us)
+{
+    // last block starting before time_us, then scan forward
+    auto it = std::upper_bound(time_index_.begin(), time_index_.end(), time_us,
+                               [](uint64_t t, const Recorder::TimeEntry &e) { return t <= e.time_us; });
+    pos_ = it == time_index_.begin() ? header_len_ : std::prev(it)->offset;
+    Record record;
+    while (record_at(pos_, record) && record.time_us < time_us) {
+        pos_ += Recorder::RECORD_HEADER_LEN + record.len;
+    }
+}
+
+bool RecordingReader::seek(uint32_t msgid, uint64_t time_us)
+{
+    auto found = msgid_index_.find(msgid);
+    if (found == msgid_index_.end()) {
+        return false;
+    }
+    seek(time_us);
+    const uint64_t start = pos_;
+    // blocks are listed by the offset of their first msgid record, so start
+    // with the last block beginning at or before start and skip blocks without msgid
+    const std::vector<uint64_t> &offsets = found->second;
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), start);
+    if (it != offsets.begin()) {
+        --it;
+    }
+    Record record;
+    for (; it != offsets.end(); ++it) {
+        auto block = std::upper_bound(time_index_.begin(), time_index_.end(), *it,
+                                      [](uint64_t offset, const Recorder::TimeEntry &e) { return offset < e.offset; });
+        const uint64_t block_end = block == time_index_.end() ? end_ : block->offset;
+        for (uint64_t offset = std::max(*it, start); offset < block_end && record_at(offset, record);
+             offset += Recorder::RECORD_HEADER_LEN + record.len) {
+            if (record.msgid == msgid && record.time_us >= time_us) {
+                pos_ = offset;
+                return true;
+            }
+        }
+    }
+    pos_ = end_;
+    return false;
+}
+
+} // namespace mavlink
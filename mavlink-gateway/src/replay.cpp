@@ -0,0 +1,169 @@
+/**
+ * @file replay.cpp
+ * @brief Replay of recorded MAVLink traffic, paced by the recorded times
+ */
+
+#include "replay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace mavlink {
+
+namespace {
+
+// waits shorter than this are spun, the scheduler wakes up too late for them
+constexpr std::chrono::microseconds SPIN_TIME(200);
+
+constexpr size_t TLOG_TIME_LEN = 8;
+
+uint64_t read_be64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+} // namespace
+
+ReplayReader::~ReplayReader()
+{
+    close();
+}
+
+bool ReplayReader::open(const std::string &path)
+{
+    close();
+    if (RecordingReader::is_recording(path)) {
+        segment_ = recording_.open(path);
+        return segment_;
+    }
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::perror(("[Replay] " + path).c_str());
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) < 0 || st.st_size == 0) {
+        std::fprintf(stderr, "[Replay] %s: empty\n", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *map = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::perror("[Replay] mmap");
+        return false;
+    }
+    map_ = static_cast<const uint8_t *>(map);
+    map_len_ = size_t(st.st_size);
+    pos_ = 0;
+    return true;
+}
+
+void ReplayReader::close()
+{
+    if (map_ != nullptr) {
+        ::munmap(const_cast<uint8_t *>(map_), map_len_);
+        map_ = nullptr;
+    }
+    map_len_ = 0;
+    if (segment_) {
+        recording_.close();
+        segment_ = false;
+    }
+}
+
+bool ReplayReader::next(Frame &frame)
+{
+    if (segment_) {
+        RecordingReader::Record record;
+        if (!recording_.next(record)) {
+            return false;
+        }
+        frame.time_us = record.time_us;
+        frame.data = record.frame;
+        frame.len = record.len;
+        return true;
+    }
+    if (map_ == nullptr || pos_ + TLOG_TIME_LEN > map_len_) {
+        return false;
+    }
+    const size_t len = frame_length(map_ + pos_ + TLOG_TIME_LEN, map_len_ - pos_ - TLOG_TIME_LEN);
+    if (len == 0) {
+        return false;
+    }
+    frame.time_us = read_be64(map_ + pos_);
+    frame.data = map_ + pos_ + TLOG_TIME_LEN;
+    frame.len = uint16_t(len);
+    pos_ += TLOG_TIME_LEN + len;
+    return true;
+}
+
+void ReplayReader::rewind()
+{
+    if (segment_) {
+        recording_.rewind();
+    }
+    pos_ = 0;
+}
+
+double ReplayStats::jitter_us() const
+{
+    if (frames == 0) {
+        return 0;
+    }
+    const double mean = late_sum_us / frames;
+    return std::sqrt(std::max(0.0, late_sum_sq_us / frames - mean * mean));
+}
+
+uint64_t ReplayStats::late_quantile_us(double q) const
+{
+    const double wanted = q * frames;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS - 1; i++) {
+        seen += late[i];
+        if (seen > 0 && seen >= wanted) {
+            return std::min<uint64_t>(uint64_t(1) << i, late_max_us);
+        }
+    }
+    return late_max_us;
+}
+
+void Replayer::pace(uint64_t time_us)
+{
+    if (config_.speed <= 0) {
+        stats_.late[0]++;
+        return;
+    }
+    // frames stamped earlier than the first one are due at once
+    const int64_t offset_us = int64_t(time_us - base_time_us_);
+    const Clock::time_point due = base_ + std::chrono::microseconds(
+                                              int64_t(double(std::max<int64_t>(offset_us, 0)) / config_.speed));
+    Clock::time_point now = Clock::now();
+    if (due - now > SPIN_TIME) {
+        std::this_thread::sleep_until(due - SPIN_TIME);
+    }
+    while ((now = Clock::now()) < due) {
+    }
+
+    const uint64_t late_us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now - due).count());
+    int bucket = 0;
+    for (uint64_t v = late_us; v != 0 && bucket < ReplayStats::HIST_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    stats_.late[bucket]++;
+    stats_.late_sum_us += double(late_us);
+    stats_.late_sum_sq_us += double(late_us) * double(late_us);
+    stats_.late_max_us = std::max(stats_.late_max_us, late_us);
+}
+
+} // namespace mavlink
@@ -0,0 +1,242 @@
+/**
+ * @file replay_main.cpp
+ * @brief mavlink_replay: play a telemetry log into an endpoint, or through
+ * the parsers as a benchmark
+ *
+ * Usage: mavlink_replay [-s speed | -f] [-l loops] LOG ENDPOINT
+ *        mavlink_replay -B [-l loops] LOG
+ *   LOG is a .tlog or a segment written by mavlink_router -r.
+ *   ENDPOINT is udp:LOCAL_PORT:HOST:PORT or tcp:HOST:PORT.
+ *   -s plays speed times faster than recorded (default 1), -f as fast as
+ *   the endpoint takes it, -l repeats the log (0 until interrupted).
+ *   -B plays the log as fast as possible through mavlink_parse_char() and
+ *   through mavlink_parse_buffer_view(), decoding the messages that have
+ *   a typed codec the same way for both, and reports the throughput of
+ *   each and the frames each rejected.
+ */
+
+#include "link.h"
+#include "message_codec.h"
+#include "parser.h"
+#include "replay.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace {
+
+mavlink::Replayer *active = nullptr;
+
+// where the benchmark leaves its decoded bytes, so decoding is not optimised away
+volatile uint32_t decode_sink;
+
+void on_signal(int)
+{
+    if (active != nullptr) {
+        active->stop();
+    }
+}
+
+void usage(const char *prog)
+{
+    std::fprintf(stderr, "usage: %s [-s speed | -f] [-l loops] LOG udp:PORT:HOST:PORT|tcp:HOST:PORT\n"
+                         "       %s -B [-l loops] LOG\n", prog, prog);
+}
+
+void print_stats(const char *what, const mavlink::ReplayStats &stats, bool paced)
+{
+    std::printf("[Replay] %s: %llu frames in %.3f s, %.0f frames/s, %.1f MB/s", what,
+                (unsigned long long)stats.frames, stats.elapsed_us / 1e6, stats.frames_per_sec(),
+                stats.elapsed_us > 0 ? stats.bytes / double(stats.elapsed_us) : 0.0);
+    if (paced) {
+        std::printf(", late us mean: %.1f, jitter: %.1f, p99 < %llu, max: %llu", stats.late_mean_us(),
+                    stats.jitter_us(), (unsigned long long)stats.late_quantile_us(0.99),
+                    (unsigned long long)stats.late_max_us);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+/*
+  decode frames of the messages with a codec, summing a byte of each into sink
+ */
+template <uint32_t... Ids>
+struct Decoder {
+    template <uint32_t Id>
+    static bool decode_one(const mavlink_frame_view_t &view, uint32_t &sink)
+    {
+        typename mavlink::msg<Id>::type m;
+        mavlink::msg<Id>::decode(view, m);
+        sink += reinterpret_cast<const uint8_t *>(&m)[0];
+        return true;
+    }
+
+    static bool decode(const mavlink_frame_view_t &view, uint32_t &sink)
+    {
+        return ((view.msgid == Ids && decode_one<Ids>(view, sink)) || ...);
+    }
+};
+
+/*
+  view of a message completed by mavlink_parse_char(), so both parsers'
+  messages go through the same codec. frame is left unset, the codecs
+  only read the payload
+ */
+mavlink_frame_view_t view_of(mavlink_message_t &message)
+{
+    mavlink_frame_view_t view;
+    view.msgid = message.msgid;
+    view.magic = message.magic;
+    view.len = message.len;
+    view.incompat_flags = message.incompat_flags;
+    view.compat_flags = message.compat_flags;
+    view.seq = message.seq;
+    view.sysid = message.sysid;
+    view.compid = message.compid;
+    view.frame_len = 0;
+    view.frame = nullptr;
+    view.payload = reinterpret_cast<const uint8_t *>(_MAV_PAYLOAD(&message));
+    view.signature = (message.incompat_flags & MAVLINK_IFLAG_SIGNED) ? message.signature : nullptr;
+    view.entry = mavlink_get_msg_entry(message.msgid);
+    view.scratch = &message;
+    view.scratch_valid = true;
+    return view;
+}
+
+using TelemetryDecoder = Decoder<MAVLINK_MSG_ID_HEARTBEAT, MAVLINK_MSG_ID_SYS_STATUS, MAVLINK_MSG_ID_GPS_RAW_INT,
+                                 MAVLINK_MSG_ID_ATTITUDE, MAVLINK_MSG_ID_ATTITUDE_QUATERNION,
+                                 MAVLINK_MSG_ID_LOCAL_POSITION_NED, MAVLINK_MSG_ID_GLOBAL_POSITION_INT,
+                                 MAVLINK_MSG_ID_RC_CHANNELS, MAVLINK_MSG_ID_SERVO_OUTPUT_RAW,
+                                 MAVLINK_MSG_ID_VFR_HUD, MAVLINK_MSG_ID_MANUAL_CONTROL,
+                                 MAVLINK_MSG_ID_COMMAND_LONG, MAVLINK_MSG_ID_COMMAND_ACK,
+                                 MAVLINK_MSG_ID_BATTERY_STATUS, MAVLINK_MSG_ID_TIMESYNC,
+                                 MAVLINK_MSG_ID_SYSTEM_TIME>;
+
+int run_benchmark(mavlink::ReplayReader &reader, unsigned loops)
+{
+    mavlink::ReplayConfig config;
+    config.speed = 0;
+    config.loops = loops;
+    mavlink::Replayer replayer(reader, config);
+    active = &replayer;
+    uint32_t sink = 0;
+
+    // status().parse_error is reset with every frame, count rejected frames here
+    mavlink::Parser parser;
+    uint64_t parsed = 0;
+    uint64_t decoded = 0;
+    uint64_t rejected = 0;
+    mavlink_message_t message;
+    const mavlink::ReplayStats by_char = replayer.run([&](const mavlink::ReplayReader::Frame &frame) {
+        for (uint16_t i = 0; i < frame.len; i++) {
+            if (parser.parse_char(frame.data[i], message)) {
+                parsed++;
+                decoded += TelemetryDecoder::decode(view_of(message), sink);
+            }
+        }
+        rejected += parser.take_rejected();
+    });
+    print_stats("parse_char", by_char, false);
+    std::printf("[Replay] parse_char: %llu parsed, %llu decoded, %llu rejected\n", (unsigned long long)parsed,
+                (unsigned long long)decoded, (unsigned long long)rejected);
+
+    parser.reset();
+    parsed = 0;
+    decoded = 0;
+    rejected = 0;
+    const mavlink::ReplayStats by_view = replayer.run([&](const mavlink::ReplayReader::Frame &frame) {
+        parser.parse(frame.data, frame.len, [&](const mavlink_frame_view_t &view) {
+            parsed++;
+            decoded += TelemetryDecoder::decode(view, sink);
+        });
+        rejected += parser.take_rejected();
+    });
+    print_stats("parse_buffer_view", by_view, false);
+    std::printf("[Replay] parse_buffer_view: %llu parsed, %llu decoded, %llu rejected\n", (unsigned long long)parsed,
+                (unsigned long long)decoded, (unsigned long long)rejected);
+    decode_sink = sink;
+    active = nullptr;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    mavlink::ReplayConfig config;
+    bool benchmark = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:fl:B")) != -1) {
+        switch (opt) {
+        case 's':
+            config.speed = std::atof(optarg);
+            break;
+        case 'f':
+            config.speed = 0;
+            break;
+        case 'l':
+            config.loops = unsigned(std::atoi(optarg));
+            break;
+        case 'B':
+            benchmark = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind + (benchmark ? 1 : 2) != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    mavlink::ReplayReader reader;
+    if (!reader.open(argv[optind])) {
+        return 1;
+    }
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    if (benchmark) {
+        return run_benchmark(reader, config.loops);
+    }
+
+    std::unique_ptr<mavlink::Link> link = mavlink::open_link(argv[optind + 1]);
+    if (!link) {
+        std::fprintf(stderr, "[Replay] bad endpoint %s\n", argv[optind + 1]);
+        return 1;
+    }
+    mavlink::Replayer replayer(reader, config);
+    active = &replayer;
+    uint64_t write_errors = 0;
+    uint8_t discard[2048];
+    std::chrono::steady_clock::time_point next_print = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    mavlink::ReplayStats last;
+    const mavlink::ReplayStats &stats = replayer.run([&](const mavlink::ReplayReader::Frame &frame) {
+        if (!link->write(frame.data, frame.len)) {
+            write_errors++;
+        }
+        if ((replayer.stats().frames & 63) == 0) {
+            // whatever the consumer sends back is not replayed
+            while (link->read(discard, sizeof(discard)) > 0) {
+            }
+        }
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= next_print) {
+            next_print += std::chrono::seconds(1);
+            const mavlink::ReplayStats &running = replayer.stats();
+            std::printf("[Replay] %llu frames/s, late us mean: %.1f, jitter: %.1f, max: %llu\n",
+                        (unsigned long long)(running.frames - last.frames), running.late_mean_us(),
+                        running.jitter_us(), (unsigned long long)running.late_max_us);
+            std::fflush(stdout);
+            last = running;
+        }
+    });
+    active = nullptr;
+    print_stats(link->name().c_str(), stats, config.speed > 0);
+    if (write_errors > 0) {
+        std::printf("[Replay] %llu frames could not be written\n", (unsigned long long)write_errors);
+    }
+    return 0;
+}
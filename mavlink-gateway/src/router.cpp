@@ -0,0 +1,364 @@
+/**
+ * @file router.cpp
+ * @brief Multi-core MAVLink router
+ */
+
+#include "router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace mavlink {
+
+namespace {
+
+constexpr size_t MAX_DATAGRAM_SIZE = 9216;  // jumbo frames
+constexpr int POLL_TIMEOUT_MS = 10;
+constexpr int POLLED_LINK_WAIT_MS = 1;   // between reads of idle links without a descriptor
+constexpr unsigned READS_PER_POLL = 4;   // batches read from one link before the others get a turn
+
+void pin_to_core(std::thread &thread, unsigned core)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % std::thread::hardware_concurrency(), &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+/*
+  wait a little longer each time a writer finds nothing to do, so an idle
+  router does not burn a core but a busy one never sleeps
+ */
+class Backoff {
+public:
+    void reset() { idle_ = 0; }
+    void wait()
+    {
+        if (idle_ < 64) {
+            idle_++;
+        } else if (idle_ < 128) {
+            idle_++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+private:
+    unsigned idle_ = 0;
+};
+
+} // namespace
+
+Router::Router(const RouterConfig &config)
+    : config_(config),
+      system_link_(new std::atomic<uint32_t>[256])
+{
+    if (config_.workers == 0) {
+        config_.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (config_.writers == 0) {
+        config_.writers = config_.workers;
+    }
+    for (unsigned i = 0; i < 256; i++) {
+        system_link_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+Router::~Router()
+{
+    stop();
+    for (Parser *parser : parsers_) {
+        parser_pool_.release(parser);
+    }
+}
+
+size_t Router::add_link(std::unique_ptr<Link> link)
+{
+    if (running_.load()) {
+        return SIZE_MAX;
+    }
+    links_.push_back(std::move(link));
+    parsers_.push_back(parser_pool_.acquire());
+    sequences_.emplace_back(new LinkSequences());
+    return links_.size() - 1;
+}
+
+void Router::start()
+{
+    if (running_.exchange(true)) {
+        return;
+    }
+    workers_.clear();
+    writers_.clear();
+    rings_.clear();
+    for (unsigned i = 0; i < config_.workers; i++) {
+        workers_.emplace_back(new Worker());
+        if (recorder_ != nullptr) {
+            workers_.back()->record = recorder_->add_source();
+        }
+    }
+    EgressConfig egress;
+    egress.mtu = config_.mtu;
+    egress.max_delay = std::chrono::microseconds(config_.batch_delay_us);
+    for (unsigned i = 0; i < config_.writers; i++) {
+        writers_.emplace_back(new Writer());
+        if (config_.mtu > 0) {
+            writers_.back()->egress.reset(new EgressBatcher(egress));
+        }
+    }
+    for (size_t i = 0; i < size_t(config_.workers) * config_.writers; i++) {
+        rings_.emplace_back(new SpscRing<Frame>(config_.queue_size));
+    }
+    for (size_t i = 0; i < links_.size(); i++) {
+        workers_[i % workers_.size()]->links.push_back(i);
+    }
+    if (config_.dedup_window_ms > 0) {
+        for (auto &writer : writers_) {
+            writer->dedup.resize(links_.size());
+        }
+        for (size_t i = 0; i < links_.size(); i++) {
+            writers_[writer_of(i)]->dedup[i].reset(
+                new Deduplicator(std::chrono::milliseconds(config_.dedup_window_ms)));
+        }
+    }
+
+    for (unsigned i = 0; i < writers_.size(); i++) {
+        writers_[i]->thread = std::thread(&Router::run_writer, this, i);
+        if (config_.pin_threads) {
+            pin_to_core(writers_[i]->thread, config_.workers + i);
+        }
+    }
+    for (unsigned i = 0; i < workers_.size(); i++) {
+        workers_[i]->thread = std::thread(&Router::run_worker, this, i);
+        if (config_.pin_threads) {
+            pin_to_core(workers_[i]->thread, i);
+        }
+    }
+}
+
+void Router::stop()
+{
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto &worker : workers_) {
+        worker->thread.join();
+    }
+    for (auto &writer : writers_) {
+        writer->thread.join();
+    }
+}
+
+RouterStats Router::stats() const
+{
+    RouterStats stats;
+    for (const auto &worker : workers_) {
+        stats.frames_in += worker->counters.frames_in.load(std::memory_order_relaxed);
+        stats.frames_dropped += worker->counters.frames_dropped.load(std::memory_order_relaxed);
+        stats.parse_errors += worker->counters.parse_errors.load(std::memory_order_relaxed);
+        stats.links_closed += worker->counters.links_closed.load(std::memory_order_relaxed);
+    }
+    for (const auto &writer : writers_) {
+        stats.frames_out += writer->counters.frames_out.load(std::memory_order_relaxed);
+        stats.frames_duplicate += writer->counters.frames_duplicate.load(std::memory_order_relaxed);
+    }
+    for (const auto &link : sequences_) {
+        SequenceStats::Totals totals;
+        totals.received = link->received.load(std::memory_order_relaxed);
+        totals.lost = link->lost.load(std::memory_order_relaxed);
+        totals.duplicate = link->duplicate.load(std::memory_order_relaxed);
+        totals.reordered = link->reordered.load(std::memory_order_relaxed);
+        stats.sequences.received += totals.received;
+        stats.sequences.lost += totals.lost;
+        stats.sequences.duplicate += totals.duplicate;
+        stats.sequences.reordered += totals.reordered;
+        stats.link_sequences.push_back(totals);
+    }
+    return stats;
+}
+
+void Router::run_worker(unsigned index)
+{
+    Worker &worker = *workers_[index];
+    DatagramReader reader(config_.read_batch, MAX_DATAGRAM_SIZE);
+    std::vector<struct pollfd> fds;
+    std::vector<bool> closed(worker.links.size(), false);
+    bool must_poll = false;
+    for (size_t link : worker.links) {
+        const int fd = links_[link]->fd();
+        if (fd < 0) {
+            must_poll = true;
+        }
+        fds.push_back({fd, POLLIN, 0});
+    }
+
+    // whether a link without a descriptor had data last round, poll() cannot tell
+    bool polled_busy = false;
+    while (running_.load(std::memory_order_relaxed)) {
+        if (worker.links.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_TIMEOUT_MS));
+            continue;
+        }
+        const int timeout = !must_poll ? POLL_TIMEOUT_MS : polled_busy ? 0 : POLLED_LINK_WAIT_MS;
+        if (::poll(fds.data(), fds.size(), timeout) < 0) {
+            continue;
+        }
+        polled_busy = false;
+        for (size_t i = 0; i < worker.links.size(); i++) {
+            if (closed[i] || (fds[i].fd >= 0 && !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))) {
+                continue;
+            }
+            const size_t src = worker.links[i];
+            auto on_frame = [&](mavlink_frame_view_t &view) {
+                route(index, src, view);
+            };
+            // a few batches at most, so a link fed faster than it is parsed
+            // cannot starve the others; poll() reports whatever is left
+            ssize_t n = reader.read(*links_[src], *parsers_[src], on_frame);
+            const bool hangup = n == 0 && (fds[i].revents & (POLLHUP | POLLERR));
+            for (unsigned reads = 1; n > 0 && reads < READS_PER_POLL; reads++) {
+                n = reader.read(*links_[src], *parsers_[src], on_frame);
+            }
+            if (n > 0 && fds[i].fd < 0) {
+                polled_busy = true;
+            }
+            if (n < 0 || hangup) {
+                // poll would keep reporting it, stop asking
+                std::fprintf(stderr, "[Router] %s closed\n", links_[src]->name().c_str());
+                closed[i] = true;
+                fds[i].fd = -1;
+                must_poll = false;
+                for (size_t j = 0; j < worker.links.size(); j++) {
+                    must_poll |= !closed[j] && links_[worker.links[j]]->fd() < 0;
+                }
+                worker.counters.links_closed.fetch_add(1, std::memory_order_relaxed);
+            }
+            const uint32_t rejected = parsers_[src]->take_rejected();
+            if (rejected > 0) {
+                worker.counters.parse_errors.fetch_add(rejected, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void Router::route(unsigned worker, size_t src, const mavlink_frame_view_t &view)
+{
+    Worker &w = *workers_[worker];
+    w.counters.frames_in.fetch_add(1, std::memory_order_relaxed);
+    if (w.record != nullptr) {
+        w.record->record(uint16_t(src), view.frame, view.frame_len, Recorder::now_us());
+    }
+
+    LinkSequences &seq = *sequences_[src];
+    const SequenceStats::Totals counted = seq.stats.update(view.sysid, view.compid, view.seq);
+    seq.received.fetch_add(counted.received, std::memory_order_relaxed);
+    if (counted.lost | counted.duplicate | counted.reordered) {
+        seq.lost.fetch_add(counted.lost, std::memory_order_relaxed);
+        seq.duplicate.fetch_add(counted.duplicate, std::memory_order_relaxed);
+        seq.reordered.fetch_add(counted.reordered, std::memory_order_relaxed);
+    }
+
+    // learn where the sender lives, without dirtying the line if nothing changed
+    std::atomic<uint32_t> &learned = system_link_[view.sysid];
+    if (learned.load(std::memory_order_relaxed) != src + 1) {
+        learned.store(uint32_t(src + 1), std::memory_order_relaxed);
+    }
+
+    uint8_t target_system, target_component;
+    mavlink_get_target(view.entry, view.payload, view.len, &target_system, &target_component);
+
+    if (target_system != 0) {
+        const uint32_t dest = system_link_[target_system].load(std::memory_order_relaxed);
+        if (dest != 0) {
+            if (dest - 1 != src) {
+                enqueue(worker, dest - 1, view);
+            }
+            return;
+        }
+    }
+    for (size_t dest = 0; dest < links_.size(); dest++) {
+        if (dest != src) {
+            enqueue(worker, dest, view);
+        }
+    }
+}
+
+void Router::enqueue(unsigned worker, size_t dest, const mavlink_frame_view_t &view)
+{
+    SpscRing<Frame> &r = ring(worker, writer_of(dest));
+    Frame *frame = r.claim();
+    if (frame == nullptr) {
+        workers_[worker]->counters.frames_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    frame->link = uint32_t(dest);
+    frame->len = view.frame_len;
+    std::memcpy(frame->data, view.frame, view.frame_len);
+    r.publish();
+}
+
+void Router::run_writer(unsigned index)
+{
+    Writer &writer = *writers_[index];
+    Backoff backoff;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        bool busy = false;
+        size_t sent = 0;
+        const EgressBatcher::Clock::time_point now = EgressBatcher::Clock::now();
+        for (unsigned w = 0; w < workers_.size(); w++) {
+            SpscRing<Frame> &r = ring(w, index);
+            // bounded batch so one worker cannot starve the others
+            for (unsigned n = 0; n < 64; n++) {
+                Frame *frame = r.front();
+                if (frame == nullptr) {
+                    break;
+                }
+                busy = true;
+                if (!writer.dedup.empty() &&
+                    !writer.dedup[frame->link]->first(Deduplicator::key_of(frame->data), now)) {
+                    writer.counters.frames_duplicate.fetch_add(1, std::memory_order_relaxed);
+                    r.pop();
+                    continue;
+                }
+                if (writer.egress) {
+                    sent += writer.egress->add(*links_[frame->link], frame->data, frame->len, now);
+                } else if (links_[frame->link]->write(frame->data, frame->len)) {
+                    sent++;
+                }
+                r.pop();
+            }
+        }
+        if (writer.egress) {
+            sent += writer.egress->flush_due(now);
+        }
+        if (sent > 0) {
+            writer.counters.frames_out.fetch_add(sent, std::memory_order_relaxed);
+        }
+        if (busy) {
+            backoff.reset();
+        } else {
+            backoff.wait();
+        }
+    }
+    if (writer.egress) {
+        writer.counters.frames_out.fetch_add(writer.egress->flush(), std::memory_order_relaxed);
+    }
+}
+
+} // namespace mavlink
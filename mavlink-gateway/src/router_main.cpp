@@ -0,0 +1,133 @@
+/**
+ * @file router_main.cpp
+ * @brief mavlink_router: route MAVLink between UDP endpoints
+ *
+ * Usage: mavlink_router [-w workers] [-W writers] [-p] [-m mtu] [-d usec] [-b batch] [-D ms] [-r dir] ENDPOINT...
+ *   -r records every frame received into dir/mavlink-NNNNNN.rec,
+ *   -D drops copies of frames arriving over redundant links within ms,
+ *   -b is the most datagrams read per recvmmsg() (default 64),
+ *   -m packs frames into datagrams of up to mtu bytes, sent with sendmmsg(),
+ *   -d is the longest a frame waits for its datagram to fill (default 500)
+ *   ENDPOINT is udp:LOCAL_PORT (reply to the last sender) or
+ *   udp:LOCAL_PORT:HOST:PORT (fixed peer)
+ */
+
+#include "router.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+void usage(const char *prog)
+{
+    std::fprintf(stderr, "usage: %s [-w workers] [-W writers] [-p] [-m mtu] [-d usec] [-b batch] [-D ms] [-r dir] udp:PORT[:HOST:PORT]...\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    mavlink::RouterConfig config;
+    const char *record_dir = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:W:pm:d:b:D:r:")) != -1) {
+        switch (opt) {
+        case 'w':
+            config.workers = unsigned(std::atoi(optarg));
+            break;
+        case 'W':
+            config.writers = unsigned(std::atoi(optarg));
+            break;
+        case 'p':
+            config.pin_threads = true;
+            break;
+        case 'm':
+            config.mtu = size_t(std::atoi(optarg));
+            break;
+        case 'd':
+            config.batch_delay_us = unsigned(std::atoi(optarg));
+            break;
+        case 'b':
+            config.read_batch = size_t(std::atoi(optarg));
+            break;
+        case 'D':
+            config.dedup_window_ms = unsigned(std::atoi(optarg));
+            break;
+        case 'r':
+            record_dir = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    mavlink::Router router(config);
+    for (int i = optind; i < argc; i++) {
+        std::unique_ptr<mavlink::Link> link = mavlink::open_link(argv[i]);
+        if (!link) {
+            std::fprintf(stderr, "[Router] bad endpoint %s\n", argv[i]);
+            return 1;
+        }
+        std::printf("[Router] link %zu: %s\n", router.add_link(std::move(link)), argv[i]);
+    }
+
+    std::unique_ptr<mavlink::Recorder> recorder;
+    if (record_dir != nullptr) {
+        mavlink::RecorderConfig record_config;
+        record_config.directory = record_dir;
+        recorder.reset(new mavlink::Recorder(record_config));
+        if (!recorder->start()) {
+            return 1;
+        }
+        router.record_to(recorder.get());
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    router.start();
+
+    mavlink::RouterStats last;
+    while (!stop_requested) {
+        sleep(1);
+        const mavlink::RouterStats now = router.stats();
+        std::printf("[Stats] in: %llu/s, out: %llu/s, dropped: %llu, duplicates: %llu, parse errors: %llu\n",
+                    (unsigned long long)(now.frames_in - last.frames_in),
+                    (unsigned long long)(now.frames_out - last.frames_out),
+                    (unsigned long long)now.frames_dropped,
+                    (unsigned long long)now.frames_duplicate,
+                    (unsigned long long)now.parse_errors);
+        std::printf("[Stats] lost: %llu, reordered: %llu, duplicate seq: %llu, links closed: %llu\n",
+                    (unsigned long long)now.sequences.lost, (unsigned long long)now.sequences.reordered,
+                    (unsigned long long)now.sequences.duplicate, (unsigned long long)now.links_closed);
+        if (recorder) {
+            const mavlink::RecorderStats recorded = recorder->stats();
+            std::printf("[Stats] recorded: %llu frames, %llu bytes, %llu segments, dropped: %llu%s\n",
+                        (unsigned long long)recorded.frames, (unsigned long long)recorded.bytes,
+                        (unsigned long long)recorded.segments, (unsigned long long)recorded.dropped,
+                        recorded.failed ? ", stopped" : "");
+        }
+        last = now;
+    }
+    router.stop();
+    if (recorder) {
+        recorder->stop();
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file serial_bridge_main.cpp
+ * @brief mavlink_serial_bridge: UDP GCS link to a flight controller UART,
+ * with frames to the UART scheduled by priority and paced to the baud rate
+ *
+ * Usage: mavlink_serial_bridge [-s burst] [-i interval_s] GCS serial:PATH[:BAUD]
+ *   GCS is udp:LOCAL_PORT or udp:LOCAL_PORT:HOST:PORT, as for mavlink_router.
+ *   burst is the most bytes handed to the serial driver at once.
+ *   A pty can stand in for the UART, e.g. with socat -d -d pty,raw pty,raw.
+ */
+
+#include "ingest.h"
+#include "link.h"
+#include "parser.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+const char *const CLASS_NAMES[MAVLINK_SCHED_NUM_CLASSES] = {"command", "control", "normal", "bulk"};
+
+void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+void usage(const char *prog)
+{
+    std::fprintf(stderr, "usage: %s [-s burst] [-i interval_s] udp:PORT[:HOST:PORT] serial:PATH[:BAUD]\n", prog);
+}
+
+uint32_t now_us()
+{
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// print and clear the counters of each class that saw traffic
+void print_stats(mavlink_sched_t &sched)
+{
+    for (int c = 0; c < MAVLINK_SCHED_NUM_CLASSES; c++) {
+        mavlink_sched_class_stats_t &stats = sched.queue[c].stats;
+        if (stats.queued == 0 && stats.dropped == 0) {
+            continue;
+        }
+        std::printf("[Sched] %-7s queued: %u, sent: %u, coalesced: %u, dropped: %u, wait ms:", CLASS_NAMES[c],
+                    stats.queued, stats.sent, stats.coalesced, stats.dropped);
+        for (uint8_t i = 0; i < MAVLINK_SCHED_HIST_BUCKETS; i++) {
+            if (stats.latency[i] == 0) {
+                continue;
+            }
+            const uint32_t bound = mavlink_sched_bucket_ms(i);
+            if (bound != 0) {
+                std::printf(" <%u:%u", bound, stats.latency[i]);
+            } else {
+                std::printf(" more:%u", stats.latency[i]);
+            }
+        }
+        std::printf("\n");
+        stats = mavlink_sched_class_stats_t{};
+    }
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t burst = 128;
+    int interval_s = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:i:")) != -1) {
+        switch (opt) {
+        case 's':
+            burst = uint32_t(std::atoi(optarg));
+            break;
+        case 'i':
+            interval_s = std::atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind + 2 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::unique_ptr<mavlink::Link> gcs = mavlink::open_link(argv[optind]);
+    if (!gcs) {
+        std::fprintf(stderr, "[Bridge] bad GCS endpoint %s\n", argv[optind]);
+        return 1;
+    }
+    std::unique_ptr<mavlink::Link> uart_link = mavlink::open_link(argv[optind + 1]);
+    mavlink::SerialLink *uart = dynamic_cast<mavlink::SerialLink *>(uart_link.get());
+    if (!uart) {
+        std::fprintf(stderr, "[Bridge] bad serial endpoint %s\n", argv[optind + 1]);
+        return 1;
+    }
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    mavlink_sched_t sched;
+    mavlink_sched_init(&sched, uart->baud(), burst, now_us());
+    mavlink::Parser gcs_parser;
+    mavlink::Parser uart_parser;
+    mavlink::DatagramReader reader;
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN * 4];
+    std::printf("[Bridge] %s <-> %s @ %u baud\n", gcs->name().c_str(), uart->name().c_str(), uart->baud());
+
+    std::chrono::steady_clock::time_point next_print = std::chrono::steady_clock::now() +
+                                                        std::chrono::seconds(interval_s);
+    while (!stop_requested) {
+        // sleep until input arrives or the line has room for the next frame
+        const uint32_t wait_us = mavlink_sched_wait_us(&sched, now_us());
+        struct pollfd fds[2] = {{gcs->fd(), POLLIN, 0}, {uart->fd(), POLLIN, 0}};
+        const int timeout_ms = wait_us > 0 ? int((wait_us + 999) / 1000) : 100;
+        ::poll(fds, 2, timeout_ms);
+
+        if (fds[0].revents & POLLIN) {
+            reader.read(*gcs, gcs_parser, [&](const mavlink_frame_view_t &view) {
+                mavlink_sched_enqueue(&sched, &view, now_us());
+            });
+        }
+        if (fds[1].revents & POLLIN) {
+            const ssize_t n = uart->read(buf, sizeof(buf));
+            if (n > 0) {
+                uart_parser.parse(buf, uint32_t(n), [&](const mavlink_frame_view_t &view) {
+                    gcs->write(view.frame, view.frame_len);
+                });
+            }
+        }
+
+        uint16_t len;
+        const uint8_t *frame;
+        while ((frame = mavlink_sched_next(&sched, now_us(), &len)) != nullptr) {
+            uart->write(frame, len);
+        }
+
+        if (std::chrono::steady_clock::now() >= next_print) {
+            next_print += std::chrono::seconds(interval_s);
+            print_stats(sched);
+        }
+    }
+    print_stats(sched);
+    return 0;
+}
@@ -0,0 +1,530 @@
+/**
+ * @file server.cpp
+ * @brief Single threaded MAVLink server for many TCP and UDP clients
+ */
+
+#include "server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mavlink {
+
+namespace {
+
+constexpr size_t UDP_BATCH = 64;
+constexpr size_t MAX_DATAGRAM_SIZE = 2048;
+constexpr size_t MAX_EVENTS = 256;
+constexpr size_t VEHICLE_DATAGRAM_SIZE = 9216;
+constexpr int POLLED_VEHICLE_WAIT_MS = 1;   // between reads of an idle vehicle link without a descriptor
+
+uint64_t pack_addr(const struct sockaddr_in &addr)
+{
+    return (uint64_t(ntohs(addr.sin_port)) << 32) | ntohl(addr.sin_addr.s_addr);
+}
+
+struct sockaddr_in unpack_addr(uint64_t addr)
+{
+    struct sockaddr_in to {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(uint16_t(addr >> 32));
+    to.sin_addr.s_addr = htonl(uint32_t(addr));
+    return to;
+}
+
+int bind_socket(int type, uint16_t port)
+{
+    const int fd = ::socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in local {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (::bind(fd, reinterpret_cast<struct sockaddr *>(&local), sizeof(local)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+  move the next frames to out once out is written: the queued commands,
+  else at most slice bytes of telemetry, so commands queued while a slice
+  goes out overtake the rest of the telemetry
+ */
+bool refill(std::vector<uint8_t> &out, size_t &out_head, std::vector<uint8_t> &commands,
+            std::vector<uint8_t> &bulk, size_t &bulk_head, size_t slice)
+{
+    if (out_head < out.size()) {
+        return true;
+    }
+    out.clear();
+    out_head = 0;
+    if (!commands.empty()) {
+        out.swap(commands);
+    } else if (bulk_head < bulk.size()) {
+        // whole frames, at least one; the queues only hold complete frames
+        size_t end = bulk_head + frame_length(&bulk[bulk_head], bulk.size() - bulk_head);
+        while (end < bulk.size() && end + frame_length(&bulk[end], bulk.size() - end) - bulk_head <= slice) {
+            end += frame_length(&bulk[end], bulk.size() - end);
+        }
+        out.assign(bulk.begin() + bulk_head, bulk.begin() + end);
+        bulk_head = end;
+        if (bulk_head == bulk.size()) {
+            bulk.clear();
+            bulk_head = 0;
+        } else if (bulk_head >= bulk.size() / 2) {
+            bulk.erase(bulk.begin(), bulk.begin() + bulk_head);
+            bulk_head = 0;
+        }
+    }
+    return !out.empty();
+}
+
+bool would_block()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+} // namespace
+
+Server::Server(std::unique_ptr<Link> vehicle, const ServerConfig &config)
+    : config_(config),
+      vehicle_(std::move(vehicle)),
+      vehicle_reader_(UDP_BATCH, VEHICLE_DATAGRAM_SIZE),
+      read_buf_(UDP_BATCH * MAX_DATAGRAM_SIZE)
+{
+    vehicle_parser_.track_sequences(&vehicle_sequences_);
+}
+
+Server::~Server()
+{
+    for (auto &client : clients_) {
+        close_client(*client);
+    }
+    for (int fd : {epoll_, tcp_, udp_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+bool Server::open()
+{
+    epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_ < 0) {
+        std::perror("[Server] epoll_create1");
+        return false;
+    }
+    struct epoll_event ev {};
+    if (config_.tcp_port != 0) {
+        tcp_ = bind_socket(SOCK_STREAM, config_.tcp_port);
+        if (tcp_ < 0 || ::listen(tcp_, SOMAXCONN) < 0) {
+            std::perror("[Server] tcp");
+            return false;
+        }
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = tcp_;
+        ::epoll_ctl(epoll_, EPOLL_CTL_ADD, tcp_, &ev);
+    }
+    if (config_.udp_port != 0) {
+        udp_ = bind_socket(SOCK_DGRAM, config_.udp_port);
+        if (udp_ < 0) {
+            std::perror("[Server] udp");
+            return false;
+        }
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.fd = udp_;
+        ::epoll_ctl(epoll_, EPOLL_CTL_ADD, udp_, &ev);
+    }
+    if (vehicle_ && vehicle_->fd() >= 0) {
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = vehicle_->fd();
+        ::epoll_ctl(epoll_, EPOLL_CTL_ADD, vehicle_->fd(), &ev);
+    }
+    next_expire_ = Clock::now() + std::chrono::seconds(1);
+    return true;
+}
+
+void Server::run_once(int timeout_ms)
+{
+    const int vehicle_fd = vehicle_ ? vehicle_->fd() : -1;
+    if (vehicle_ && vehicle_fd < 0) {
+        // has to be polled, right away while it has data, soon when it had none
+        timeout_ms = vehicle_busy_ ? 0
+                     : timeout_ms < 0 ? POLLED_VEHICLE_WAIT_MS
+                                      : std::min(timeout_ms, POLLED_VEHICLE_WAIT_MS);
+    }
+    struct epoll_event events[MAX_EVENTS];
+    const int n = ::epoll_wait(epoll_, events, int(MAX_EVENTS), timeout_ms);
+    for (int i = 0; i < n; i++) {
+        const int fd = events[i].data.fd;
+        const uint32_t mask = events[i].events;
+        if (fd == tcp_) {
+            accept_clients();
+        } else if (fd == udp_) {
+            if (mask & EPOLLOUT) {
+                udp_blocked_ = false;
+                for (Client *client : udp_waiting_) {
+                    client->blocked = false;
+                    if (!client->dirty && !client->closed) {
+                        client->dirty = true;
+                        dirty_.push_back(client);
+                    }
+                }
+                udp_waiting_.clear();
+            }
+            if (mask & EPOLLIN) {
+                read_udp();
+            }
+        } else if (fd == vehicle_fd) {
+            read_vehicle();
+        } else {
+            auto it = tcp_clients_.find(fd);
+            if (it == tcp_clients_.end()) {
+                continue;
+            }
+            Client &client = *it->second;
+            if (mask & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                read_tcp(client);
+            }
+            if ((mask & EPOLLOUT) && !client.closed) {
+                client.blocked = false;
+                if (!client.dirty && client.queued() > 0) {
+                    client.dirty = true;
+                    dirty_.push_back(&client);
+                }
+            }
+        }
+    }
+    if (vehicle_ && vehicle_fd < 0) {
+        vehicle_busy_ = read_vehicle();
+    }
+    flush_dirty();
+
+    const Clock::time_point now = Clock::now();
+    if (now >= next_expire_) {
+        expire_udp(now);
+        next_expire_ = now + std::chrono::seconds(1);
+    }
+    reap();
+}
+
+bool Server::is_command(const mavlink_frame_view_t &view)
+{
+    uint8_t target_system, target_component;
+    mavlink_get_target(view.entry, view.payload, view.len, &target_system, &target_component);
+    if (target_system != 0) {
+        return true;
+    }
+    switch (view.msgid) {
+    case MAVLINK_MSG_ID_HEARTBEAT:
+    case MAVLINK_MSG_ID_COMMAND_ACK:
+    case MAVLINK_MSG_ID_PARAM_VALUE:
+    case MAVLINK_MSG_ID_STATUSTEXT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+Server::Client *Server::add_client(int fd, uint64_t addr)
+{
+    if (stats_.clients >= config_.max_clients) {
+        return nullptr;
+    }
+    clients_.emplace_back(new Client());
+    Client *client = clients_.back().get();
+    client->fd = fd;
+    client->addr = addr;
+    client->parser = parser_pool_.acquire();
+    client->last_heard = Clock::now();
+    if (fd >= 0) {
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (config_.tcp_notsent_lowat > 0) {
+            // keep the backlog in our queues, where commands can overtake it
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &config_.tcp_notsent_lowat,
+                         sizeof(config_.tcp_notsent_lowat));
+        }
+        struct epoll_event ev {};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev);
+        tcp_clients_[fd] = client;
+    } else {
+        udp_clients_[addr] = client;
+    }
+    stats_.clients++;
+    return client;
+}
+
+void Server::close_client(Client &client)
+{
+    if (client.closed) {
+        return;
+    }
+    client.closed = true;
+    if (client.fd >= 0) {
+        ::epoll_ctl(epoll_, EPOLL_CTL_DEL, client.fd, nullptr);
+        ::close(client.fd);
+        tcp_clients_.erase(client.fd);
+    } else {
+        udp_clients_.erase(client.addr);
+    }
+    parser_pool_.release(client.parser);
+    client.parser = nullptr;
+    stats_.clients--;
+    stats_.disconnects++;
+}
+
+void Server::accept_clients()
+{
+    for (;;) {
+        const int fd = ::accept4(tcp_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (!would_block()) {
+                std::perror("[Server] accept");
+            }
+            return;
+        }
+        if (add_client(fd, 0) == nullptr) {
+            ::close(fd);
+        }
+    }
+}
+
+void Server::read_tcp(Client &client)
+{
+    auto up = [this](mavlink_frame_view_t &view) {
+        if (vehicle_ && vehicle_->write(view.frame, view.frame_len)) {
+            stats_.frames_up++;
+        }
+    };
+    for (;;) {
+        const ssize_t n = ::recv(client.fd, read_buf_.data(), read_buf_.size(), 0);
+        if (n > 0) {
+            client.parser->parse(read_buf_.data(), uint32_t(n), up);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0 || !would_block()) {
+            close_client(client);
+        }
+        return;
+    }
+}
+
+void Server::read_udp()
+{
+    auto up = [this](mavlink_frame_view_t &view) {
+        if (vehicle_ && vehicle_->write(view.frame, view.frame_len)) {
+            stats_.frames_up++;
+        }
+    };
+    struct sockaddr_in from[UDP_BATCH];
+    struct iovec datagrams[UDP_BATCH];
+    struct mmsghdr msgs[UDP_BATCH];
+    const Clock::time_point now = Clock::now();
+    for (;;) {
+        for (size_t i = 0; i < UDP_BATCH; i++) {
+            datagrams[i].iov_base = &read_buf_[i * MAX_DATAGRAM_SIZE];
+            datagrams[i].iov_len = MAX_DATAGRAM_SIZE;
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_iov = &datagrams[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int r = ::recvmmsg(udp_, msgs, unsigned(UDP_BATCH), MSG_DONTWAIT, nullptr);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return;
+        }
+        for (int i = 0; i < r; i++) {
+            const uint64_t addr = pack_addr(from[i]);
+            auto it = udp_clients_.find(addr);
+            Client *client = it != udp_clients_.end() ? it->second : add_client(-1, addr);
+            if (client == nullptr) {
+                continue;
+            }
+            client->last_heard = now;
+            client->parser->parse(static_cast<const uint8_t *>(datagrams[i].iov_base), msgs[i].msg_len, up);
+        }
+        if (size_t(r) < UDP_BATCH) {
+            return;
+        }
+    }
+}
+
+bool Server::read_vehicle()
+{
+    auto on_frame = [this](mavlink_frame_view_t &view) {
+        stats_.frames_in++;
+        broadcast(view);
+    };
+    // edge triggered, so read until the link is empty
+    bool read = false;
+    while (vehicle_reader_.read(*vehicle_, vehicle_parser_, on_frame) > 0) {
+        read = true;
+    }
+    return read;
+}
+
+void Server::broadcast(const mavlink_frame_view_t &view)
+{
+    const bool command = is_command(view);
+    for (auto &client : clients_) {
+        if (!client->closed) {
+            enqueue(*client, view.frame, view.frame_len, command);
+        }
+    }
+}
+
+void Server::enqueue(Client &client, const uint8_t *frame, size_t len, bool command)
+{
+    const size_t queued = client.queued() + len;
+    if (command) {
+        if (queued > config_.command_limit) {
+            close_client(client);
+            return;
+        }
+        client.commands.insert(client.commands.end(), frame, frame + len);
+    } else {
+        if (queued > config_.queue_limit) {
+            stats_.dropped_bulk++;
+            return;
+        }
+        client.bulk.insert(client.bulk.end(), frame, frame + len);
+    }
+    if (!client.dirty && !client.blocked) {
+        client.dirty = true;
+        dirty_.push_back(&client);
+    }
+}
+
+void Server::flush_dirty()
+{
+    // flushing once per loop sends everything queued since in one call
+    for (Client *client : dirty_) {
+        client->dirty = false;
+        if (client->closed) {
+            continue;
+        }
+        const bool ok = client->fd >= 0 ? flush_tcp(*client) : flush_udp(*client);
+        if (!ok) {
+            close_client(*client);
+        }
+    }
+    dirty_.clear();
+}
+
+bool Server::flush_tcp(Client &client)
+{
+    while (refill(client.out, client.out_head, client.commands, client.bulk, client.bulk_head,
+                  config_.bulk_slice)) {
+        const ssize_t n = ::send(client.fd, &client.out[client.out_head], client.out.size() - client.out_head,
+                                 MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (would_block()) {
+                client.blocked = true;
+                return true;
+            }
+            return false;
+        }
+        client.out_head += size_t(n);
+    }
+    return true;
+}
+
+bool Server::flush_udp(Client &client)
+{
+    if (udp_blocked_) {
+        client.blocked = true;
+        udp_waiting_.push_back(&client);
+        return true;
+    }
+    const struct sockaddr_in to = unpack_addr(client.addr);
+    while (refill(client.out, client.out_head, client.commands, client.bulk, client.bulk_head,
+                  config_.bulk_slice)) {
+        // as many whole frames as fit in one datagram
+        size_t end = client.out_head;
+        while (end < client.out.size()) {
+            const size_t len = frame_length(&client.out[end], client.out.size() - end);
+            if (end > client.out_head && end + len - client.out_head > config_.udp_mtu) {
+                break;
+            }
+            end += len;
+        }
+        const ssize_t n = ::sendto(udp_, &client.out[client.out_head], end - client.out_head, MSG_DONTWAIT,
+                                   reinterpret_cast<const struct sockaddr *>(&to), sizeof(to));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (would_block() || errno == ENOBUFS) {
+                udp_blocked_ = true;
+                client.blocked = true;
+                udp_waiting_.push_back(&client);
+                return true;
+            }
+            return false;
+        }
+        client.out_head = end;
+    }
+    return true;
+}
+
+void Server::expire_udp(Clock::time_point now)
+{
+    for (auto &client : clients_) {
+        if (!client->closed && client->fd < 0 && now - client->last_heard > config_.udp_timeout) {
+            close_client(*client);
+        }
+    }
+}
+
+void Server::reap()
+{
+    size_t waiting = 0;
+    for (Client *client : udp_waiting_) {
+        if (!client->closed) {
+            udp_waiting_[waiting++] = client;
+        }
+    }
+    udp_waiting_.resize(waiting);
+
+    size_t i = 0;
+    while (i < clients_.size()) {
+        if (clients_[i]->closed) {
+            clients_[i] = std::move(clients_.back());
+            clients_.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+} // namespace mavlink
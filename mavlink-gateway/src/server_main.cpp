@@ -0,0 +1,97 @@
+/**
+ * @file server_main.cpp
+ * @brief mavlink_server: mirror one vehicle to many TCP and UDP clients
+ *
+ * Usage: mavlink_server [-t tcp_port] [-u udp_port] [-c max_clients] [-q queue_kb] VEHICLE
+ *   VEHICLE is udp:LOCAL_PORT or udp:LOCAL_PORT:HOST:PORT, as for mavlink_router.
+ *   Port 0 turns the TCP or UDP listener off.
+ */
+
+#include "server.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+void usage(const char *prog)
+{
+    std::fprintf(stderr, "usage: %s [-t tcp_port] [-u udp_port] [-c max_clients] [-q queue_kb] udp:PORT[:HOST:PORT]\n",
+                 prog);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    mavlink::ServerConfig config;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:u:c:q:")) != -1) {
+        switch (opt) {
+        case 't':
+            config.tcp_port = uint16_t(std::atoi(optarg));
+            break;
+        case 'u':
+            config.udp_port = uint16_t(std::atoi(optarg));
+            break;
+        case 'c':
+            config.max_clients = size_t(std::atoi(optarg));
+            break;
+        case 'q':
+            config.queue_limit = size_t(std::atoi(optarg)) * 1024;
+            config.command_limit = 4 * config.queue_limit;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::unique_ptr<mavlink::Link> vehicle = mavlink::open_link(argv[optind]);
+    if (!vehicle) {
+        std::fprintf(stderr, "[Server] bad vehicle endpoint %s\n", argv[optind]);
+        return 1;
+    }
+
+    mavlink::Server server(std::move(vehicle), config);
+    if (!server.open()) {
+        return 1;
+    }
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    mavlink::ServerStats last;
+    mavlink::Server::Clock::time_point next_print = mavlink::Server::Clock::now() + std::chrono::seconds(1);
+    while (!stop_requested) {
+        server.run_once(100);
+        if (mavlink::Server::Clock::now() < next_print) {
+            continue;
+        }
+        next_print += std::chrono::seconds(1);
+        const mavlink::ServerStats &now = server.stats();
+        const mavlink::SequenceStats::Totals vehicle = server.vehicle_sequences().totals();
+        std::printf("[Stats] clients: %llu, in: %llu/s, up: %llu/s, dropped: %llu, disconnects: %llu, "
+                    "vehicle lost: %llu\n",
+                    (unsigned long long)now.clients,
+                    (unsigned long long)(now.frames_in - last.frames_in),
+                    (unsigned long long)(now.frames_up - last.frames_up),
+                    (unsigned long long)now.dropped_bulk,
+                    (unsigned long long)now.disconnects,
+                    (unsigned long long)vehicle.lost);
+        last = now;
+    }
+    return 0;
+}
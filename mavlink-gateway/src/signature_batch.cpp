@@ -0,0 +1,402 @@
+/**
+ * @file signature_batch.cpp
+ * @brief Signature verification for batches of signed frames
+ */
+
+#include "signature_batch.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define GATEWAY_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace mavlink {
+
+namespace {
+
+// 32 byte key + longest signed part of a frame + 0x80 marker + bit length
+constexpr unsigned max_blocks = (32 + MAVLINK_NUM_HEADER_BYTES + MAVLINK_MAX_PAYLOAD_LEN +
+                                 MAVLINK_NUM_CHECKSUM_BYTES + 7 + 1 + 8 + 63) / 64;
+
+struct Pending {
+    const uint8_t *data;   // frame from the magic byte to the signature timestamp
+    uint16_t len;
+    uint8_t blocks;        // SHA-256 blocks including the key
+    uint8_t digest[6];
+};
+
+unsigned block_count(uint16_t len)
+{
+    return (32 + len + 1 + 8 + 63) / 64;
+}
+
+void hash_scalar(const mavlink_sha256_key_state_t &ks, Pending *const *pending, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        mavlink_sha256_key_48(&ks, pending[i]->data, pending[i]->len, pending[i]->digest);
+    }
+}
+
+#ifdef GATEWAY_SHA256_X86
+
+/*
+  key || data with SHA-256 padding. The key bytes are left out, they are
+  taken from the key state
+ */
+unsigned pad_message(const Pending &p, uint8_t out[max_blocks * 64])
+{
+    const uint32_t total = 32 + p.len;
+    const uint32_t end = p.blocks * 64;
+    const uint64_t bits = uint64_t(total) * 8;
+
+    std::memcpy(out + 32, p.data, p.len);
+    out[total] = 0x80;
+    std::memset(out + total + 1, 0, end - 8 - (total + 1));
+    for (unsigned i = 0; i < 8; i++) {
+        out[end - 8 + i] = uint8_t(bits >> (56 - 8 * i));
+    }
+    return p.blocks;
+}
+
+uint32_t load_be32(const uint8_t *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return __builtin_bswap32(v);
+}
+
+bool cpu_has_sha_ni()
+{
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & (1u << 29)) != 0;
+}
+
+/*
+  AVX2: one frame per 32 bit lane, all lanes sharing the key. Lanes whose
+  frame has fewer blocks keep their state once they are done
+ */
+#define AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define AVX2_ROUND(a, b, c, d, e, f, g, h, i) do { \
+        if ((i) >= 16) { \
+            const __m256i w2 = w[((i) - 2) & 15], w15 = w[((i) - 15) & 15]; \
+            const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(w2, 17), AVX2_ROTR(w2, 19)), \
+                                                _mm256_srli_epi32(w2, 10)); \
+            const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(w15, 7), AVX2_ROTR(w15, 18)), \
+                                                _mm256_srli_epi32(w15, 3)); \
+            w[(i) & 15] = _mm256_add_epi32(_mm256_add_epi32(w[(i) & 15], s1), \
+                                           _mm256_add_epi32(w[((i) - 7) & 15], s0)); \
+        } \
+        const __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(e, 6), AVX2_ROTR(e, 11)), AVX2_ROTR(e, 25)); \
+        const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)); \
+        const __m256i T1 = _mm256_add_epi32(_mm256_add_epi32(h, S1), \
+                                            _mm256_add_epi32(ch, _mm256_add_epi32( \
+                                                _mm256_set1_epi32(int(mavlink_sha256_constant_256[i])), w[(i) & 15]))); \
+        const __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(a, 2), AVX2_ROTR(a, 13)), AVX2_ROTR(a, 22)); \
+        const __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b))); \
+        d = _mm256_add_epi32(d, T1); \
+        h = _mm256_add_epi32(T1, _mm256_add_epi32(S0, maj)); \
+    } while (0)
+
+__attribute__((target("avx2")))
+void hash_avx2_8(const mavlink_sha256_key_state_t &ks, Pending *const *pending, size_t count)
+{
+    alignas(32) uint8_t buf[8][max_blocks * 64];
+    alignas(32) uint32_t words[16][8];
+    alignas(32) int32_t lane_blocks[8];
+    alignas(32) uint32_t out[2][8];
+    unsigned blocks = 0;
+    __m256i state[8];
+
+    for (unsigned j = 0; j < 8; j++) {
+        // spare lanes repeat the first frame
+        lane_blocks[j] = int32_t(pad_message(*pending[j < count ? j : 0], buf[j]));
+        if (unsigned(lane_blocks[j]) > blocks) {
+            blocks = unsigned(lane_blocks[j]);
+        }
+    }
+    const __m256i lane_blocks_v = _mm256_load_si256(reinterpret_cast<const __m256i *>(lane_blocks));
+
+    mavlink_sha256_ctx iv;
+    mavlink_sha256_init(&iv);
+    for (unsigned k = 0; k < 8; k++) {
+        state[k] = _mm256_set1_epi32(int(iv.counter[k]));
+    }
+
+    for (unsigned b = 0; b < blocks; b++) {
+        __m256i w[16];
+        __m256i A, B, C, D, E, F, G, H;
+        const unsigned from = (b == 0) ? 8 : 0;
+
+        for (unsigned t = from; t < 16; t++) {
+            for (unsigned j = 0; j < 8; j++) {
+                words[t][j] = load_be32(&buf[j][b * 64 + t * 4]);
+            }
+            w[t] = _mm256_load_si256(reinterpret_cast<const __m256i *>(words[t]));
+        }
+        if (b == 0) {
+            for (unsigned t = 0; t < 8; t++) {
+                w[t] = _mm256_set1_epi32(int(ks.key_words[t]));
+            }
+            A = _mm256_set1_epi32(int(ks.state[0]));
+            B = _mm256_set1_epi32(int(ks.state[1]));
+            C = _mm256_set1_epi32(int(ks.state[2]));
+            D = _mm256_set1_epi32(int(ks.state[3]));
+            E = _mm256_set1_epi32(int(ks.state[4]));
+            F = _mm256_set1_epi32(int(ks.state[5]));
+            G = _mm256_set1_epi32(int(ks.state[6]));
+            H = _mm256_set1_epi32(int(ks.state[7]));
+        } else {
+            A = state[0];
+            B = state[1];
+            C = state[2];
+            D = state[3];
+            E = state[4];
+            F = state[5];
+            G = state[6];
+            H = state[7];
+        }
+
+        for (unsigned i = from; i < 64; i += 8) {
+            AVX2_ROUND(A, B, C, D, E, F, G, H, i + 0);
+            AVX2_ROUND(H, A, B, C, D, E, F, G, i + 1);
+            AVX2_ROUND(G, H, A, B, C, D, E, F, i + 2);
+            AVX2_ROUND(F, G, H, A, B, C, D, E, i + 3);
+            AVX2_ROUND(E, F, G, H, A, B, C, D, i + 4);
+            AVX2_ROUND(D, E, F, G, H, A, B, C, i + 5);
+            AVX2_ROUND(C, D, E, F, G, H, A, B, i + 6);
+            AVX2_ROUND(B, C, D, E, F, G, H, A, i + 7);
+        }
+
+        const __m256i active = _mm256_cmpgt_epi32(lane_blocks_v, _mm256_set1_epi32(int(b)));
+        const __m256i vars[8] = {A, B, C, D, E, F, G, H};
+        for (unsigned k = 0; k < 8; k++) {
+            state[k] = _mm256_blendv_epi8(state[k], _mm256_add_epi32(state[k], vars[k]), active);
+        }
+    }
+
+    _mm256_store_si256(reinterpret_cast<__m256i *>(out[0]), state[0]);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(out[1]), state[1]);
+    for (size_t j = 0; j < count; j++) {
+        uint8_t *digest = pending[j]->digest;
+        digest[0] = uint8_t(out[0][j] >> 24);
+        digest[1] = uint8_t(out[0][j] >> 16);
+        digest[2] = uint8_t(out[0][j] >> 8);
+        digest[3] = uint8_t(out[0][j]);
+        digest[4] = uint8_t(out[1][j] >> 24);
+        digest[5] = uint8_t(out[1][j] >> 16);
+    }
+}
+
+#undef AVX2_ROUND
+#undef AVX2_ROTR
+
+void hash_avx2(const mavlink_sha256_key_state_t &ks, Pending *const *pending, size_t count)
+{
+    while (count >= 2) {
+        const size_t n = count < 8 ? count : 8;
+        hash_avx2_8(ks, pending, n);
+        pending += n;
+        count -= n;
+    }
+    // a lone frame is quicker on its own
+    hash_scalar(ks, pending, count);
+}
+
+/*
+  SHA extensions keep the working variables as ABEF and CDGH
+ */
+__attribute__((target("sha,sse4.1")))
+inline void sha_ni_pack(const uint32_t v[8], __m128i &abef, __m128i &cdgh)
+{
+    __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&v[0]));
+    __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&v[4]));
+    dcba = _mm_shuffle_epi32(dcba, 0xB1);                 // CDAB
+    hgfe = _mm_shuffle_epi32(hgfe, 0x1B);                 // EFGH
+    abef = _mm_alignr_epi8(dcba, hgfe, 8);
+    cdgh = _mm_blend_epi16(hgfe, dcba, 0xF0);
+}
+
+__attribute__((target("sha,sse4.1")))
+void hash_sha_ni(const mavlink_sha256_key_state_t &ks, Pending *const *pending, size_t count)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    const __m128i *K = reinterpret_cast<const __m128i *>(mavlink_sha256_constant_256);
+    alignas(16) uint8_t buf[max_blocks * 64];
+    mavlink_sha256_ctx iv;
+    __m128i iv_abef, iv_cdgh, key_abef, key_cdgh;
+
+    mavlink_sha256_init(&iv);
+    sha_ni_pack(iv.counter, iv_abef, iv_cdgh);
+    sha_ni_pack(ks.state, key_abef, key_cdgh);
+
+    for (size_t n = 0; n < count; n++) {
+        Pending &p = *pending[n];
+        const unsigned blocks = pad_message(p, buf);
+        __m128i abef = iv_abef, cdgh = iv_cdgh;
+
+        for (unsigned b = 0; b < blocks; b++) {
+            const uint8_t *block = &buf[b * 64];
+            __m128i w[16];
+            __m128i s0, s1;
+            unsigned first;
+
+            if (b == 0) {
+                w[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ks.key_words[0]));
+                w[1] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ks.key_words[4]));
+                s0 = key_abef;
+                s1 = key_cdgh;
+                first = 2;
+            } else {
+                w[0] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(block)), bswap);
+                w[1] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16)), bswap);
+                s0 = abef;
+                s1 = cdgh;
+                first = 0;
+            }
+            w[2] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 32)), bswap);
+            w[3] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 48)), bswap);
+            for (unsigned g = 4; g < 16; g++) {
+                __m128i t = _mm_sha256msg1_epu32(w[g - 4], w[g - 3]);
+                t = _mm_add_epi32(t, _mm_alignr_epi8(w[g - 1], w[g - 2], 4));
+                w[g] = _mm_sha256msg2_epu32(t, w[g - 1]);
+            }
+            // four rounds per group of schedule words
+            for (unsigned g = first; g < 16; g++) {
+                __m128i wk = _mm_add_epi32(w[g], _mm_loadu_si128(&K[g]));
+                s1 = _mm_sha256rnds2_epu32(s1, s0, wk);
+                wk = _mm_shuffle_epi32(wk, 0x0E);
+                s0 = _mm_sha256rnds2_epu32(s0, s1, wk);
+            }
+            abef = _mm_add_epi32(abef, s0);
+            cdgh = _mm_add_epi32(cdgh, s1);
+        }
+
+        const uint32_t a = uint32_t(_mm_extract_epi32(abef, 3));
+        const uint32_t bb = uint32_t(_mm_extract_epi32(abef, 2));
+        p.digest[0] = uint8_t(a >> 24);
+        p.digest[1] = uint8_t(a >> 16);
+        p.digest[2] = uint8_t(a >> 8);
+        p.digest[3] = uint8_t(a);
+        p.digest[4] = uint8_t(bb >> 24);
+        p.digest[5] = uint8_t(bb >> 16);
+    }
+}
+
+#endif // GATEWAY_SHA256_X86
+
+} // namespace
+
+Sha256Impl SignatureVerifier::best_impl()
+{
+#ifdef GATEWAY_SHA256_X86
+    if (cpu_has_sha_ni()) {
+        return Sha256Impl::sha_ni;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Sha256Impl::avx2;
+    }
+#endif
+    return Sha256Impl::scalar;
+}
+
+const char *SignatureVerifier::impl_name(Sha256Impl impl)
+{
+    switch (impl) {
+    case Sha256Impl::avx2:
+        return "avx2";
+    case Sha256Impl::sha_ni:
+        return "sha-ni";
+    case Sha256Impl::scalar:
+        break;
+    }
+    return "scalar";
+}
+
+SignatureVerifier::SignatureVerifier(Sha256Impl impl)
+    : impl_(Sha256Impl::scalar)
+{
+#ifdef GATEWAY_SHA256_X86
+    if ((impl == Sha256Impl::sha_ni && cpu_has_sha_ni()) ||
+        (impl == Sha256Impl::avx2 && __builtin_cpu_supports("avx2"))) {
+        impl_ = impl;
+    }
+#else
+    (void)impl;
+#endif
+}
+
+size_t SignatureVerifier::verify(mavlink_signing_t &signing, mavlink_signing_streams_t &streams,
+                                 const uint8_t *const *frames, size_t count, bool *ok) const
+{
+    const mavlink_sha256_key_state_t &ks = *_mav_signing_key_state(&signing);
+    size_t good = 0;
+
+    for (size_t base = 0; base < count; base += max_batch) {
+        const size_t n = (count - base < max_batch) ? count - base : max_batch;
+        Pending pending[max_batch];
+        Pending *order[max_batch];
+        size_t hashed = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t *frame = frames[base + i];
+            Pending &p = pending[i];
+            if (frame[0] != MAVLINK_STX || !(frame[2] & MAVLINK_IFLAG_SIGNED)) {
+                p.data = nullptr;
+                continue;
+            }
+            p.data = frame;
+            p.len = uint16_t(MAVLINK_NUM_HEADER_BYTES + frame[1] + MAVLINK_NUM_CHECKSUM_BYTES + 7);
+            p.blocks = uint8_t(block_count(p.len));
+        }
+
+        // hash frames of the same block count side by side
+        for (unsigned blocks = 1; blocks <= max_blocks; blocks++) {
+            for (size_t i = 0; i < n; i++) {
+                if (pending[i].data != nullptr && pending[i].blocks == blocks) {
+                    order[hashed++] = &pending[i];
+                }
+            }
+        }
+        switch (impl_) {
+#ifdef GATEWAY_SHA256_X86
+        case Sha256Impl::avx2:
+            hash_avx2(ks, order, hashed);
+            break;
+        case Sha256Impl::sha_ni:
+            hash_sha_ni(ks, order, hashed);
+            break;
+#endif
+        default:
+            hash_scalar(ks, order, hashed);
+            break;
+        }
+
+        // the rest of mavlink_signature_check(), in frame order
+        for (size_t i = 0; i < n; i++) {
+            const Pending &p = pending[i];
+            bool passed = false;
+            if (p.data != nullptr) {
+                const uint8_t *psig = p.data + p.len - 7;
+                if (std::memcmp(p.digest, psig + 7, 6) != 0) {
+                    signing.last_status = MAVLINK_SIGNING_STATUS_BAD_SIGNATURE;
+                } else {
+                    passed = _mav_signature_check_replay(&signing, &streams, p.data[5], p.data[6], psig);
+                }
+            }
+            ok[base + i] = passed;
+            good += passed ? 1 : 0;
+        }
+    }
+    return good;
+}
+
+} // namespace mavlink
@@ -0,0 +1,413 @@
+/**
+ * @file attitude_batch_test.cpp
+ * @brief AttitudeConverter's SSE2 / NEON and AVX2 conversions against the
+ * scalar mavlink_conversions.h functions and exact double results, over
+ * random rotations and the gimbal lock edge cases, with their throughput
+ *
+ * Usage: attitude_batch_test [samples]
+ */
+
+#include "attitude_batch.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using mavlink::AttitudeConverter;
+using mavlink::AttitudeImpl;
+
+// bounds from attitude_batch.h (6e-7 rad, 2e-7 measured) with some headroom
+constexpr double ANGLE_TOL = 1e-6;
+constexpr double ELEMENT_TOL = 3e-7;
+// the scalar functions' own error comes on top when comparing with them
+constexpr double SCALAR_ELEMENT_TOL = 5e-7;
+constexpr double SCALAR_PITCH_TOL = 5e-4;   // asinf() near +-90 degrees
+constexpr double SCALAR_ANGLE_TOL = 2e-6;   // roll and yaw away from gimbal lock
+constexpr double LOCK = M_PI_2 - 1e-3;      // pitch beyond which both lock
+
+int failures = 0;
+
+double wrap(double a)
+{
+    return std::remainder(a, 2 * M_PI);
+}
+
+/*
+  largest difference of one output, reports it if over the bound
+ */
+class Error {
+public:
+    Error(const char *impl, std::string what, double bound) : impl_(impl), what_(std::move(what)), bound_(bound) {}
+    ~Error()
+    {
+        if (max_ > bound_ || std::isnan(max_)) {
+            std::fprintf(stderr, "FAIL: %s %s: max error %.3g > %.3g (sample %zu)\n", impl_, what_.c_str(), max_, bound_,
+                         worst_);
+            failures++;
+        }
+    }
+
+    void add(size_t i, double error)
+    {
+        if (!(error <= max_)) {
+            max_ = error;
+            worst_ = i;
+        }
+    }
+
+private:
+    const char *impl_;
+    std::string what_;
+    double bound_;
+    double max_ = 0;
+    size_t worst_ = 0;
+};
+
+void exact_dcm(const float q[4], double d[9])
+{
+    const double a = q[0], b = q[1], c = q[2], e = q[3];
+    d[0] = a * a + b * b - c * c - e * e;
+    d[1] = 2 * (b * c - a * e);
+    d[2] = 2 * (a * c + b * e);
+    d[3] = 2 * (b * c + a * e);
+    d[4] = a * a - b * b + c * c - e * e;
+    d[5] = 2 * (c * e - a * b);
+    d[6] = 2 * (b * e - a * c);
+    d[7] = 2 * (a * b + c * e);
+    d[8] = a * a - b * b - c * c + e * e;
+}
+
+struct Euler {
+    double roll, pitch, yaw;
+    bool lock;
+};
+
+/*
+  angles of a rotation matrix, with the gimbal lock convention of
+  attitude_batch.h
+ */
+Euler exact_euler(const double d[9])
+{
+    Euler e;
+    e.pitch = std::atan2(-d[6], std::hypot(d[0], d[3]));
+    e.lock = std::fabs(e.pitch) > LOCK;
+    if (!e.lock) {
+        e.roll = std::atan2(d[7], d[8]);
+        e.yaw = std::atan2(d[3], d[0]);
+    } else if (e.pitch > 0) {
+        e.roll = 0;
+        e.yaw = std::atan2(d[5] - d[1], d[2] + d[4]);
+    } else {
+        e.roll = 0;
+        e.yaw = std::atan2(-(d[5] + d[1]), d[4] - d[2]);
+    }
+    return e;
+}
+
+void exact_quaternion(double roll, double pitch, double yaw, double q[4])
+{
+    const double cr = std::cos(roll / 2), sr = std::sin(roll / 2);
+    const double cp = std::cos(pitch / 2), sp = std::sin(pitch / 2);
+    const double cy = std::cos(yaw / 2), sy = std::sin(yaw / 2);
+    q[0] = cr * cp * cy + sr * sp * sy;
+    q[1] = sr * cp * cy - cr * sp * sy;
+    q[2] = cr * sp * cy + sr * cp * sy;
+    q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+/*
+  one array per component, as the converter takes them
+ */
+template <int N>
+struct Columns {
+    explicit Columns(size_t count)
+    {
+        for (int k = 0; k < N; k++) {
+            col[k].resize(count);
+            in[k] = col[k].data();
+            out[k] = col[k].data();
+        }
+    }
+    std::vector<float> col[N];
+    const float *in[N];
+    float *out[N];
+};
+
+struct Samples {
+    explicit Samples(size_t count) : q(count), dcm(count), euler(count), interleaved(4 * count) {}
+    Columns<4> q;
+    Columns<9> dcm;            // float rotation matrices of q
+    Columns<3> euler;          // roll, pitch, yaw
+    std::vector<float> interleaved;   // q as w, x, y, z of each sample in turn, as ODOMETRY.q
+};
+
+/*
+  random rotations, one in 50 within 1e-7..0.1 rad of gimbal lock, plus the
+  exact edge cases at the start
+ */
+Samples make_samples(size_t count)
+{
+    Samples s(count);
+    std::mt19937_64 rng(25);
+    std::normal_distribution<double> normal;
+    std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+    std::vector<std::array<double, 4>> edges;
+    for (double pitch : {M_PI_2, -M_PI_2}) {
+        for (double off : {0.0, 1e-7, 1e-5, 5e-4, 9e-4, 1.1e-3, 2e-3, 1e-2, 1e-1}) {
+            for (double roll : {0.0, 0.5, -2.5}) {
+                std::array<double, 4> q;
+                exact_quaternion(roll, pitch > 0 ? pitch - off : pitch + off, 1.0, q.data());
+                edges.push_back(q);
+            }
+        }
+    }
+    edges.push_back({1, 0, 0, 0});
+    edges.push_back({0, 1, 0, 0});
+    edges.push_back({0, 0, 1, 0});
+    edges.push_back({0, 0, 0, 1});
+    edges.push_back({-1, 0, 0, 0});
+    edges.push_back({M_SQRT1_2, 0, M_SQRT1_2, 0});
+    edges.push_back({M_SQRT1_2, 0, -M_SQRT1_2, 0});
+
+    for (size_t i = 0; i < count; i++) {
+        double q[4];
+        if (i < edges.size()) {
+            std::copy(edges[i].begin(), edges[i].end(), q);
+        } else if (i % 50 == 0) {
+            const double off = std::pow(10.0, -1 - 6.0 * double(rng() % 1000) / 1000);
+            exact_quaternion(angle(rng), (i % 100 == 0 ? 1 : -1) * (M_PI_2 - off), angle(rng), q);
+        } else {
+            double norm = 0;
+            for (double &v : q) {
+                v = normal(rng);
+                norm += v * v;
+            }
+            for (double &v : q) {
+                v /= std::sqrt(norm);
+            }
+        }
+        for (int k = 0; k < 4; k++) {
+            s.q.col[k][i] = float(q[k]);
+            s.interleaved[4 * i + k] = float(q[k]);
+        }
+        const float qf[4] = {s.q.col[0][i], s.q.col[1][i], s.q.col[2][i], s.q.col[3][i]};
+        double d[9];
+        exact_dcm(qf, d);
+        for (int k = 0; k < 9; k++) {
+            s.dcm.col[k][i] = float(d[k]);
+        }
+        s.euler.col[0][i] = float(angle(rng));
+        s.euler.col[1][i] = float(angle(rng) / 2);
+        s.euler.col[2][i] = float(angle(rng));
+        if (i % 97 == 0) {
+            // wound up angles, e.g. an integrated yaw
+            s.euler.col[0][i] *= 1000;
+            s.euler.col[2][i] *= 3000;
+        }
+    }
+    return s;
+}
+
+double time_ms(const std::function<void()> &run)
+{
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+  Euler angles of the impl against the exact ones and the scalar functions'.
+  dcm is the float matrix they were computed from
+ */
+void check_euler(const char *impl, const char *what, const Columns<3> &got, const Columns<3> &scalar,
+                 const std::function<void(size_t, double[9])> &dcm, size_t count)
+{
+    std::string name(what);
+    Error pitch(impl, name + " pitch", ANGLE_TOL);
+    Error angles(impl, name + " roll/yaw", ANGLE_TOL);
+    Error locked(impl, name + " gimbal lock yaw", ANGLE_TOL);
+    Error lock_roll(impl, name + " gimbal lock roll", 0);
+    Error lock_state(impl, name + " gimbal lock detection", 0);
+    Error scalar_pitch(impl, name + " pitch vs scalar", SCALAR_PITCH_TOL);
+    Error scalar_angles(impl, name + " roll/yaw vs scalar", SCALAR_ANGLE_TOL);
+    Error scalar_locked(impl, name + " gimbal lock yaw vs scalar at +90", SCALAR_ANGLE_TOL);
+    for (size_t i = 0; i < count; i++) {
+        double d[9];
+        dcm(i, d);
+        const Euler want = exact_euler(d);
+        const double roll = got.col[0][i], p = got.col[1][i], yaw = got.col[2][i];
+        const bool lock = roll == 0 && std::fabs(p) > LOCK - 1e-5;
+        pitch.add(i, std::fabs(p - want.pitch));
+        if (std::fabs(std::fabs(want.pitch) - LOCK) < 1e-5) {
+            // float rounding decides, either answer is right
+            continue;
+        }
+        lock_state.add(i, lock != want.lock);
+        if (want.lock) {
+            lock_roll.add(i, std::fabs(roll));
+            locked.add(i, std::fabs(wrap(yaw - want.yaw)));
+        } else {
+            angles.add(i, std::max(std::fabs(wrap(roll - want.roll)), std::fabs(wrap(yaw - want.yaw))));
+        }
+
+        // the scalar functions: asinf() pitch, float matrix elements
+        const double s_roll = scalar.col[0][i], s_pitch = scalar.col[1][i], s_yaw = scalar.col[2][i];
+        if (std::isnan(s_pitch)) {
+            continue;
+        }
+        scalar_pitch.add(i, std::fabs(p - s_pitch));
+        if (std::fabs(want.pitch) < M_PI_2 - 0.1) {
+            scalar_angles.add(i, std::max(std::fabs(wrap(roll - s_roll)), std::fabs(wrap(yaw - s_yaw))));
+        } else if (want.pitch > LOCK + SCALAR_PITCH_TOL) {
+            // at -90 degrees the scalar yaw is degenerate, see attitude_batch.h
+            scalar_locked.add(i, std::fabs(wrap(yaw - s_yaw)));
+        }
+    }
+}
+
+void check_elements(const char *impl, const char *what, const float *const *got, const float *const *scalar,
+                    int n, const std::function<void(size_t, double *)> &exact, size_t count)
+{
+    std::string name(what);
+    Error vs_exact(impl, what, ELEMENT_TOL);
+    Error vs_scalar(impl, name + " vs scalar", SCALAR_ELEMENT_TOL);
+    double want[9];
+    for (size_t i = 0; i < count; i++) {
+        exact(i, want);
+        for (int k = 0; k < n; k++) {
+            vs_exact.add(i, std::fabs(got[k][i] - want[k]));
+            vs_scalar.add(i, std::fabs(got[k][i] - scalar[k][i]));
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t count = argc > 1 ? size_t(std::atol(argv[1])) : 200000;
+    const Samples s = make_samples(count);
+    const float *const interleaved[4] = {&s.interleaved[0], &s.interleaved[1], &s.interleaved[2],
+                                         &s.interleaved[3]};
+
+    // scalar results, and its throughput to compare against
+    const AttitudeConverter scalar(AttitudeImpl::scalar);
+    Columns<3> s_q_euler(count), s_dcm_euler(count);
+    Columns<9> s_q_dcm(count), s_e_dcm(count);
+    Columns<4> s_e_q(count);
+    const auto &e = s.euler.col;
+    double scalar_ms[5] = {
+        time_ms([&] { scalar.quaternion_to_euler(s.q.in, count, s_q_euler.out[0], s_q_euler.out[1], s_q_euler.out[2]); }),
+        time_ms([&] { scalar.quaternion_to_dcm(s.q.in, count, s_q_dcm.out); }),
+        time_ms([&] { scalar.dcm_to_euler(s.dcm.in, count, s_dcm_euler.out[0], s_dcm_euler.out[1], s_dcm_euler.out[2]); }),
+        time_ms([&] { scalar.euler_to_quaternion(e[0].data(), e[1].data(), e[2].data(), count, s_e_q.out); }),
+        time_ms([&] { scalar.euler_to_dcm(e[0].data(), e[1].data(), e[2].data(), count, s_e_dcm.out); }),
+    };
+    const char *const names[5] = {"quaternion_to_euler", "quaternion_to_dcm", "dcm_to_euler", "euler_to_quaternion",
+                                  "euler_to_dcm"};
+
+    auto q_dcm = [&](size_t i, double d[9]) {
+        const float q[4] = {s.q.col[0][i], s.q.col[1][i], s.q.col[2][i], s.q.col[3][i]};
+        exact_dcm(q, d);
+    };
+    auto float_dcm = [&](size_t i, double d[9]) {
+        for (int k = 0; k < 9; k++) {
+            d[k] = s.dcm.col[k][i];
+        }
+    };
+    auto e_q = [&](size_t i, double q[4]) {
+        exact_quaternion(e[0][i], e[1][i], e[2][i], q);
+    };
+    auto e_dcm = [&](size_t i, double d[9]) {
+        const double cr = std::cos(double(e[0][i])), sr = std::sin(double(e[0][i]));
+        const double cp = std::cos(double(e[1][i])), sp = std::sin(double(e[1][i]));
+        const double cy = std::cos(double(e[2][i])), sy = std::sin(double(e[2][i]));
+        const double want[9] = {cp * cy, -cr * sy + sr * sp * cy, sr * sy + cr * sp * cy,
+                                cp * sy, cr * cy + sr * sp * sy, -sr * cy + cr * sp * sy,
+                                -sp, sr * cp, cr * cp};
+        std::copy(want, want + 9, d);
+    };
+
+    std::vector<Columns<3>> simd_euler;
+    for (AttitudeImpl impl : {AttitudeImpl::simd128, AttitudeImpl::avx2}) {
+        const AttitudeConverter conv(impl);
+        const char *name = AttitudeConverter::impl_name(conv.impl());
+        if (conv.impl() != impl) {
+            std::printf("%s not supported here, skipped\n", AttitudeConverter::impl_name(impl));
+            continue;
+        }
+        Columns<3> q_euler(count), q_euler_strided(count), dcm_euler(count);
+        Columns<9> dcm(count), e_dcm_out(count);
+        Columns<4> e_q_out(count);
+        const double ms[5] = {
+            time_ms([&] { conv.quaternion_to_euler(s.q.in, count, q_euler.out[0], q_euler.out[1], q_euler.out[2]); }),
+            time_ms([&] { conv.quaternion_to_dcm(s.q.in, count, dcm.out); }),
+            time_ms([&] { conv.dcm_to_euler(s.dcm.in, count, dcm_euler.out[0], dcm_euler.out[1], dcm_euler.out[2]); }),
+            time_ms([&] { conv.euler_to_quaternion(e[0].data(), e[1].data(), e[2].data(), count, e_q_out.out); }),
+            time_ms([&] { conv.euler_to_dcm(e[0].data(), e[1].data(), e[2].data(), count, e_dcm_out.out); }),
+        };
+        conv.quaternion_to_euler(interleaved, count, q_euler_strided.out[0], q_euler_strided.out[1],
+                                 q_euler_strided.out[2], 4);
+        for (int k = 0; k < 5; k++) {
+            std::printf("%-7s %-20s %8.1f Msamples/s, scalar %6.1f, %5.1fx\n", name, names[k],
+                        count / ms[k] / 1e3, count / scalar_ms[k] / 1e3, scalar_ms[k] / ms[k]);
+        }
+
+        check_euler(name, "quaternion_to_euler", q_euler, s_q_euler, q_dcm, count);
+        check_euler(name, "quaternion_to_euler stride 4", q_euler_strided, s_q_euler, q_dcm, count);
+        check_euler(name, "dcm_to_euler", dcm_euler, s_dcm_euler, float_dcm, count);
+        check_elements(name, "quaternion_to_dcm", dcm.out, s_q_dcm.out, 9, q_dcm, count);
+        check_elements(name, "euler_to_quaternion", e_q_out.out, s_e_q.out, 4, e_q, count);
+        check_elements(name, "euler_to_dcm", e_dcm_out.out, s_e_dcm.out, 9, e_dcm, count);
+        simd_euler.push_back(std::move(q_euler));
+    }
+
+    // both widths run the same kernel, so they differ by FMA rounding only
+    if (simd_euler.size() == 2) {
+        Error same("sse2/avx2", "quaternion_to_euler agreement", 1e-6);
+        for (size_t i = 0; i < count; i++) {
+            for (int k = 0; k < 3; k++) {
+                same.add(i, std::fabs(wrap(simd_euler[0].col[k][i] - simd_euler[1].col[k][i])));
+            }
+        }
+    }
+
+    // counts that leave a partial vector, nothing written past the end
+    for (AttitudeImpl impl : {AttitudeImpl::simd128, AttitudeImpl::avx2}) {
+        const AttitudeConverter conv(impl);
+        for (size_t n = 1; n <= 17 && n < count; n++) {
+            Columns<3> out(n + 8);
+            for (int k = 0; k < 3; k++) {
+                std::fill(out.col[k].begin(), out.col[k].end(), -9.0f);
+            }
+            conv.quaternion_to_euler(s.q.in, n, out.out[0], out.out[1], out.out[2]);
+            for (int k = 0; k < 3; k++) {
+                for (size_t i = 0; i < n + 8; i++) {
+                    const bool untouched = out.col[k][i] == -9.0f;
+                    if (untouched != (i >= n) ||
+                        (i < n && std::fabs(wrap(out.col[k][i] - s_q_euler.col[k][i])) > SCALAR_PITCH_TOL)) {
+                        std::fprintf(stderr, "FAIL: %s count %zu: element %zu of output %d\n",
+                                     AttitudeConverter::impl_name(conv.impl()), n, i, k);
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
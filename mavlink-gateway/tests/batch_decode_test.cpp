@@ -0,0 +1,270 @@
+/**
+ * @file batch_decode_test.cpp
+ * @brief BatchDecoder with each implementation against the generated
+ * mavlink_msg_*_decode() functions, on messages with 1, 2, 4 and 8 byte
+ * fields, arrays and unaligned extension fields, payloads trimmed to every
+ * length and frame counts that are not a multiple of 8. Each payload ends
+ * where an unmapped page begins, so a read past it faults.
+ */
+
+#include "batch_decode.h"
+#include "message_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using mavlink::BatchDecoder;
+using mavlink::DecodeImpl;
+
+constexpr size_t MAX_FRAMES = 203;
+constexpr uint8_t CANARY = 0xA5;
+constexpr size_t CANARY_LEN = 64;   // bytes checked past the end of each column
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/*
+  the generated decode function of a message, into its C structure
+ */
+struct Message {
+    uint32_t msgid;
+    size_t struct_len;
+    void (*decode)(const mavlink_message_t *msg, void *out);
+};
+
+template <typename T, void (*Decode)(const mavlink_message_t *, T *)>
+Message message(uint32_t msgid)
+{
+    return Message{msgid, sizeof(T), [](const mavlink_message_t *msg, void *out) {
+                       Decode(msg, static_cast<T *>(out));
+                   }};
+}
+
+const Message MESSAGES[] = {
+    // 4 byte fields only
+    message<mavlink_attitude_t, mavlink_msg_attitude_decode>(MAVLINK_MSG_ID_ATTITUDE),
+    // 1 and 4 byte fields
+    message<mavlink_heartbeat_t, mavlink_msg_heartbeat_decode>(MAVLINK_MSG_ID_HEARTBEAT),
+    // 2 byte fields, an aligned extension
+    message<mavlink_scaled_imu_t, mavlink_msg_scaled_imu_decode>(MAVLINK_MSG_ID_SCALED_IMU),
+    // 8 byte field, a second chunk, unaligned 4 byte extensions
+    message<mavlink_gps_raw_int_t, mavlink_msg_gps_raw_int_decode>(MAVLINK_MSG_ID_GPS_RAW_INT),
+    // a char array, an unaligned 2 byte extension
+    message<mavlink_statustext_t, mavlink_msg_statustext_decode>(MAVLINK_MSG_ID_STATUSTEXT),
+    // float arrays over three chunks
+    message<mavlink_attitude_quaternion_cov_t, mavlink_msg_attitude_quaternion_cov_decode>(
+        MAVLINK_MSG_ID_ATTITUDE_QUATERNION_COV),
+    // two 8 byte fields, a float array
+    message<mavlink_hil_actuator_controls_t, mavlink_msg_hil_actuator_controls_decode>(
+        MAVLINK_MSG_ID_HIL_ACTUATOR_CONTROLS),
+    // unaligned 8 byte extensions, in the first and in the second chunk
+    message<mavlink_set_gps_global_origin_t, mavlink_msg_set_gps_global_origin_decode>(
+        MAVLINK_MSG_ID_SET_GPS_GLOBAL_ORIGIN),
+    message<mavlink_set_home_position_t, mavlink_msg_set_home_position_decode>(MAVLINK_MSG_ID_SET_HOME_POSITION),
+};
+
+/*
+  one page per payload, each followed by an unmapped page
+ */
+class GuardedSlots {
+public:
+    explicit GuardedSlots(size_t count) : page_(size_t(::sysconf(_SC_PAGESIZE))), count_(count)
+    {
+        void *map = ::mmap(nullptr, 2 * page_ * count, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            std::perror("mmap");
+            return;
+        }
+        base_ = static_cast<uint8_t *>(map);
+        for (size_t i = 0; i < count; i++) {
+            ::mprotect(base_ + (2 * i + 1) * page_, page_, PROT_NONE);
+        }
+    }
+    ~GuardedSlots()
+    {
+        if (base_ != nullptr) {
+            ::munmap(base_, 2 * page_ * count_);
+        }
+    }
+    GuardedSlots(const GuardedSlots &) = delete;
+    GuardedSlots &operator=(const GuardedSlots &) = delete;
+
+    bool ok() const { return base_ != nullptr; }
+
+    // room for len bytes that end at the guard page of slot i
+    uint8_t *slot(size_t i, size_t len) { return base_ + (2 * i + 1) * page_ - len; }
+
+private:
+    size_t page_;
+    size_t count_;
+    uint8_t *base_ = nullptr;
+};
+
+struct Frames {
+    std::vector<mavlink_frame_view_t> views;
+    std::vector<std::vector<uint8_t>> decoded;   // C structure from the generated decode function
+};
+
+/*
+  count frames of a message with random payloads, trimmed to random
+  lengths, or to every length from 1 up for the first frames
+ */
+Frames make_frames(const Message &m, GuardedSlots &slots, size_t count, std::mt19937 &rng)
+{
+    const mavlink_msg_entry_t *entry = mavlink_get_msg_entry(m.msgid);
+    Frames frames;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t len = i < entry->max_msg_len ? uint8_t(i + 1) : uint8_t(1 + rng() % entry->max_msg_len);
+        if (rng() % 4 == 0) {
+            len = entry->max_msg_len;
+        }
+        mavlink_message_t msg{};
+        msg.msgid = m.msgid;
+        msg.len = len;
+        uint8_t *payload = slots.slot(i, len);
+        for (uint8_t k = 0; k < len; k++) {
+            payload[k] = uint8_t(rng());
+        }
+        std::memcpy(_MAV_PAYLOAD_NON_CONST(&msg), payload, len);
+
+        mavlink_frame_view_t view{};
+        view.msgid = m.msgid;
+        view.magic = MAVLINK_STX;
+        view.len = len;
+        view.payload = payload;
+        view.entry = entry;
+        frames.views.push_back(view);
+
+        std::vector<uint8_t> decoded(m.struct_len);
+        m.decode(&msg, decoded.data());
+        frames.decoded.push_back(std::move(decoded));
+    }
+    return frames;
+}
+
+/*
+  decode the first count frames, with only the fields in wanted if it is
+  not empty, and compare every value with the generated decode function
+ */
+void run(const BatchDecoder &decoder, const Frames &frames, size_t count, const std::vector<int> &wanted)
+{
+    const mavlink_message_info_t &info = decoder.info();
+    std::vector<std::vector<uint8_t>> storage(info.num_fields);
+    std::vector<void *> columns(info.num_fields, nullptr);
+    for (unsigned f = 0; f < info.num_fields; f++) {
+        if (!wanted.empty() && std::find(wanted.begin(), wanted.end(), int(f)) == wanted.end()) {
+            continue;
+        }
+        const mavlink_field_info_t &field = info.fields[f];
+        const size_t width = field.array_length > 0 ? field.array_length : 1;
+        storage[f].assign(count * width * mavlink::field_type_size(field.type) + CANARY_LEN, CANARY);
+        columns[f] = storage[f].data();
+    }
+
+    const size_t n = decoder.decode(frames.views.data(), count, columns.data());
+    if (n != count) {
+        std::fprintf(stderr, "FAIL: %s %s: %zu of %zu frames decoded\n", BatchDecoder::impl_name(decoder.impl()),
+                     info.name, n, count);
+        failures++;
+        return;
+    }
+    for (unsigned f = 0; f < info.num_fields; f++) {
+        if (columns[f] == nullptr) {
+            continue;
+        }
+        const mavlink_field_info_t &field = info.fields[f];
+        const size_t width = field.array_length > 0 ? field.array_length : 1;
+        const size_t row_bytes = width * mavlink::field_type_size(field.type);
+        for (size_t j = 0; j < count; j++) {
+            if (std::memcmp(&storage[f][j * row_bytes], &frames.decoded[j][field.structure_offset], row_bytes) != 0) {
+                std::fprintf(stderr, "FAIL: %s %s.%s: frame %zu of %zu (len %u) differs\n",
+                             BatchDecoder::impl_name(decoder.impl()), info.name, field.name, j, count,
+                             frames.views[j].len);
+                failures++;
+                return;
+            }
+        }
+        const uint8_t *tail = &storage[f][count * row_bytes];
+        if (std::any_of(tail, tail + CANARY_LEN, [](uint8_t b) { return b != CANARY; })) {
+            std::fprintf(stderr, "FAIL: %s %s.%s: written past %zu rows\n", BatchDecoder::impl_name(decoder.impl()),
+                         info.name, field.name, count);
+            failures++;
+            return;
+        }
+    }
+}
+
+void test_message(const Message &m, GuardedSlots &slots, std::mt19937 &rng)
+{
+    const Frames frames = make_frames(m, slots, MAX_FRAMES, rng);
+    for (DecodeImpl impl : {DecodeImpl::scalar, DecodeImpl::avx2}) {
+        const BatchDecoder decoder(m.msgid, impl);
+        check(decoder.valid(), "message known to the decoder");
+        if (!decoder.valid() || decoder.impl() != impl) {
+            continue;
+        }
+        for (size_t count : {size_t(0), size_t(1), size_t(7), size_t(8), size_t(9), size_t(15), size_t(16),
+                             size_t(17), size_t(64), MAX_FRAMES}) {
+            run(decoder, frames, count, {});
+        }
+        // every field on its own, so a store into the wrong column shows
+        for (unsigned f = 0; f < decoder.info().num_fields; f++) {
+            run(decoder, frames, MAX_FRAMES, {int(f)});
+        }
+    }
+}
+
+/*
+  decoding stops at the first frame of another message
+ */
+void test_mixed(GuardedSlots &slots, std::mt19937 &rng)
+{
+    Frames frames = make_frames(MESSAGES[0], slots, 20, rng);
+    frames.views[11].msgid = MAVLINK_MSG_ID_HEARTBEAT;
+    for (DecodeImpl impl : {DecodeImpl::scalar, DecodeImpl::avx2}) {
+        const BatchDecoder decoder(MESSAGES[0].msgid, impl);
+        std::vector<float> column(20);
+        std::vector<void *> columns(decoder.info().num_fields, nullptr);
+        columns[decoder.field_index("roll")] = column.data();
+        check(decoder.decode(frames.views.data(), frames.views.size(), columns.data()) == 11,
+              "decoding stops at another message");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    GuardedSlots slots(MAX_FRAMES);
+    if (!slots.ok()) {
+        return 1;
+    }
+    std::printf("best implementation here: %s\n", BatchDecoder::impl_name(BatchDecoder::best_impl()));
+    check(!BatchDecoder(0xBBAA).valid(), "unknown message not valid");
+
+    std::mt19937 rng(24);
+    for (const Message &m : MESSAGES) {
+        test_message(m, slots, rng);
+    }
+    test_mixed(slots, rng);
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
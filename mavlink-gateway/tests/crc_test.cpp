@@ -0,0 +1,64 @@
+/**
+ * @file crc_test.cpp
+ * @brief checksum.h against a bitwise CRC-16/MCRF4XX over random buffers,
+ * built once per MAVLINK_CRC_FAST setting
+ */
+
+#include "checksum.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+uint16_t crc_bitwise(uint16_t crc, const uint8_t *p, size_t len)
+{
+    while (len--) {
+        crc ^= *p++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? uint16_t((crc >> 1) ^ 0x8408) : uint16_t(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(2);
+    std::vector<uint8_t> buf(1024 + 8), copy(1024 + 8);
+    int failures = 0;
+    for (int i = 0; i < 50000 && failures < 10; i++) {
+        // unaligned starts and every length up to the largest frame and beyond
+        const size_t offset = rng() % 8;
+        const size_t len = rng() % 1024;
+        uint8_t *p = buf.data() + offset;
+        for (size_t k = 0; k < len; k++) {
+            p[k] = uint8_t(rng());
+        }
+        const uint16_t seed = uint16_t(rng());
+        const uint16_t want = crc_bitwise(X25_INIT_CRC, p, len);
+        const uint16_t want_seeded = crc_bitwise(seed, p, len);
+
+        const uint16_t calculated = crc_calculate(p, uint16_t(len));
+        uint16_t buffered = seed;
+        crc_accumulate_buffer(&buffered, reinterpret_cast<const char *>(p), uint16_t(len));
+        uint16_t bytewise = seed;
+        for (size_t k = 0; k < len; k++) {
+            crc_accumulate(p[k], &bytewise);
+        }
+        const uint16_t copied = crc_accumulate_copy(seed, copy.data(), p, uint16_t(len));
+
+        if (calculated != want || buffered != want_seeded || bytewise != want_seeded || copied != want_seeded ||
+            std::memcmp(copy.data(), p, len) != 0) {
+            std::fprintf(stderr, "len %zu offset %zu seed %04x: want %04x/%04x, calculate %04x, buffer %04x, "
+                                 "accumulate %04x, copy %04x\n",
+                         len, offset, seed, want, want_seeded, calculated, buffered, bytewise, copied);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file parse_buffer_bench.cpp
+ * @brief mavlink_parse_buffer() against mavlink_parse_char() on a stream
+ * of telemetry cut into random chunks, as datagrams and serial reads arrive
+ *
+ * Usage: parse_buffer_bench [passes]
+ * Fails if the two parsers do not find the same messages, then prints the
+ * throughput of each.
+ */
+
+#include "gateway_mavlink.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Found {
+    uint32_t msgid;
+    uint8_t seq;
+    uint16_t checksum;
+
+    bool operator==(const Found &o) const { return msgid == o.msgid && seq == o.seq && checksum == o.checksum; }
+};
+
+std::vector<uint8_t> make_stream(std::mt19937 &rng, size_t frames)
+{
+    std::vector<uint8_t> stream;
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+    mavlink_message_t msg;
+    for (size_t i = 0; i < frames; i++) {
+        msg.seq = 0;
+        switch (rng() % 5) {
+        case 0:
+            mavlink_msg_heartbeat_pack(1, 1, &msg, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_ARDUPILOTMEGA, 0, rng(), 0);
+            break;
+        case 1:
+            mavlink_msg_attitude_pack(1, 1, &msg, rng(), 0.1f, 0.2f, rng() % 2 ? 0.3f : 0.0f, 0, 0, 0);
+            break;
+        case 2:
+            mavlink_msg_global_position_int_pack(1, 1, &msg, rng(), rng(), rng(), rng(), rng(), 1, 2, 3, 4);
+            break;
+        case 3:
+            mavlink_msg_rc_channels_pack(1, 1, &msg, rng(), 8, 1500, 1500, 1000, 1500, 2000, 1000, 1000, 1000, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0, 200);
+            break;
+        default: {
+            const char text[MAVLINK_MSG_STATUSTEXT_FIELD_TEXT_LEN] = "EKF3 IMU0 is using GPS";
+            mavlink_msg_statustext_pack(1, 1, &msg, MAV_SEVERITY_INFO, text, 0, 0);
+            break;
+        }
+        }
+        msg.seq = uint8_t(i);
+        const uint16_t len = mavlink_msg_to_send_buffer(buf, &msg);
+        stream.insert(stream.end(), buf, buf + len);
+    }
+    return stream;
+}
+
+void on_message(const mavlink_message_t *msg, const mavlink_status_t *, void *arg)
+{
+    static_cast<std::vector<Found> *>(arg)->push_back(Found{msg->msgid, msg->seq, msg->checksum});
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int passes = argc > 1 ? std::atoi(argv[1]) : 20;
+    std::mt19937 rng(1);
+    const std::vector<uint8_t> stream = make_stream(rng, 20000);
+    std::vector<size_t> cuts;
+    for (size_t pos = 0; pos < stream.size(); pos += 1 + rng() % 512) {
+        cuts.push_back(pos);
+    }
+    cuts.push_back(stream.size());
+
+    std::vector<Found> by_char, by_buffer;
+    by_char.reserve(20000 * passes);
+    by_buffer.reserve(20000 * passes);
+    mavlink_message_t rxmsg{}, msg{};
+    mavlink_status_t status{}, char_status{};
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point t0 = Clock::now();
+    for (int p = 0; p < passes; p++) {
+        for (size_t c = 0; c + 1 < cuts.size(); c++) {
+            for (size_t i = cuts[c]; i < cuts[c + 1]; i++) {
+                if (mavlink_frame_char_buffer(&rxmsg, &char_status, stream[i], &msg, &char_status) ==
+                    MAVLINK_FRAMING_OK) {
+                    by_char.push_back(Found{msg.msgid, msg.seq, msg.checksum});
+                }
+            }
+        }
+    }
+    const Clock::time_point t1 = Clock::now();
+    mavlink_message_t buffer_rxmsg{};
+    for (int p = 0; p < passes; p++) {
+        for (size_t c = 0; c + 1 < cuts.size(); c++) {
+            mavlink_parse_buffer(&buffer_rxmsg, &status, stream.data() + cuts[c], uint32_t(cuts[c + 1] - cuts[c]),
+                                 on_message, &by_buffer);
+        }
+    }
+    const Clock::time_point t2 = Clock::now();
+
+    if (by_char.size() != size_t(20000) * passes || by_char != by_buffer) {
+        std::fprintf(stderr, "parse_char found %zu messages, parse_buffer %zu, expected %zu\n", by_char.size(),
+                     by_buffer.size(), size_t(20000) * passes);
+        return 1;
+    }
+    const double bytes = double(stream.size()) * passes;
+    const double char_s = std::chrono::duration<double>(t1 - t0).count();
+    const double buffer_s = std::chrono::duration<double>(t2 - t1).count();
+    std::printf("mavlink_parse_char:   %.1f MB/s\n", bytes / char_s / 1e6);
+    std::printf("mavlink_parse_buffer: %.1f MB/s (%.2fx)\n", bytes / buffer_s / 1e6, char_s / buffer_s);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file parse_unknown_test.cpp
+ * @brief mavlink_parse_buffer_view() with MAVLINK_STATUS_FLAG_PASS_UNKNOWN,
+ * as the ESP32 bridge runs it: unknown messages between good frames are
+ * passed on, bytes after a corrupted frame are not taken for one. Each
+ * stream is parsed whole and split at every point, so both the in-buffer
+ * and the byte-wise path see every frame.
+ */
+
+#include "gateway_mavlink.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t UNKNOWN_MSGID = 0xBBAA;
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+void append(std::vector<uint8_t> &stream, const uint8_t *frame, size_t len)
+{
+    stream.insert(stream.end(), frame, frame + len);
+}
+
+/*
+  a heartbeat with sequence number seq
+ */
+uint16_t pack_heartbeat(uint8_t *buf, uint8_t seq)
+{
+    mavlink_get_channel_status(MAVLINK_COMM_0)->current_tx_seq = seq;
+    mavlink_message_t msg;
+    mavlink_msg_heartbeat_pack(1, 1, &msg, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_ARDUPILOTMEGA, 0, 0, 0);
+    return mavlink_msg_to_send_buffer(buf, &msg);
+}
+
+void append_heartbeat(std::vector<uint8_t> &stream, uint8_t seq)
+{
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+    append(stream, buf, pack_heartbeat(buf, seq));
+}
+
+/*
+  a heartbeat renumbered to a message the dialect does not have, its CRC
+  cannot be checked
+ */
+void append_unknown(std::vector<uint8_t> &stream, uint8_t seq)
+{
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t len = pack_heartbeat(buf, seq);
+    buf[7] = UNKNOWN_MSGID & 0xFF;
+    buf[8] = (UNKNOWN_MSGID >> 8) & 0xFF;
+    buf[9] = UNKNOWN_MSGID >> 16;
+    append(stream, buf, len);
+}
+
+/*
+  an ATTITUDE with a bad CRC whose payload holds what looks like the
+  header of a 132 byte unknown frame
+ */
+void append_corrupted_attitude(std::vector<uint8_t> &stream)
+{
+    mavlink_message_t msg;
+    mavlink_msg_attitude_pack(1, 1, &msg, 1000, 0.1f, 0.2f, 0.3f, 0, 0, 0);
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t len = mavlink_msg_to_send_buffer(buf, &msg);
+    const uint8_t fake[] = {MAVLINK_STX, 120, 0, 0, 7, 1, 1, UNKNOWN_MSGID & 0xFF, (UNKNOWN_MSGID >> 8) & 0xFF, 0};
+    std::memcpy(&buf[MAVLINK_NUM_HEADER_BYTES + 4], fake, sizeof(fake));
+    append(stream, buf, len);
+}
+
+struct Result {
+    unsigned known = 0;
+    unsigned unknown = 0;
+    uint64_t received = 0;   // by the sequence table
+};
+
+void on_view(mavlink_frame_view_t *view, const mavlink_status_t *, void *arg)
+{
+    Result &result = *static_cast<Result *>(arg);
+    if (view->entry == NULL) {
+        result.unknown++;
+        // no length to zero-extend to, the received payload as is
+        const bool ok = std::memcmp(mavlink_frame_view_payload(view), view->payload, view->len) == 0;
+        check(ok && view->msgid == UNKNOWN_MSGID, "unknown frame passed on as received");
+    } else {
+        result.known++;
+    }
+}
+
+Result parse(const std::vector<uint8_t> &stream, size_t split)
+{
+    mavlink_message_t rxmsg{};
+    mavlink_status_t status{};
+    mavlink_seq_stream_t streams[4];
+    mavlink_seq_table_t table;
+    mavlink_seq_table_init(&table, streams, 4);
+    status.seq_table = &table;
+    status.flags |= MAVLINK_STATUS_FLAG_PASS_UNKNOWN;
+
+    Result result;
+    mavlink_parse_buffer_view(&rxmsg, &status, stream.data(), uint32_t(split), on_view, &result);
+    mavlink_parse_buffer_view(&rxmsg, &status, stream.data() + split, uint32_t(stream.size() - split), on_view,
+                              &result);
+    const mavlink_seq_stream_t *seq = mavlink_seq_table_find(&table, 1, 1);
+    result.received = seq != NULL ? seq->received : 0;
+    return result;
+}
+
+void expect(const std::vector<uint8_t> &stream, unsigned known, unsigned unknown, const char *what)
+{
+    for (size_t split = 0; split <= stream.size(); split++) {
+        const Result result = parse(stream, split);
+        if (result.known != known || result.unknown != unknown || result.received != known + unknown) {
+            std::fprintf(stderr, "FAIL: %s (split at %zu): %u known, %u unknown, %llu counted in sequence, "
+                                 "expected %u, %u\n",
+                         what, split, result.known, result.unknown, (unsigned long long)result.received, known,
+                         unknown);
+            failures++;
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    if (mavlink_get_msg_entry(UNKNOWN_MSGID) != NULL) {
+        std::fprintf(stderr, "message %u is in the dialect, pick another\n", UNKNOWN_MSGID);
+        return 1;
+    }
+
+    // unknown messages between good frames, the last one at the end of the stream
+    std::vector<uint8_t> stream;
+    append_heartbeat(stream, 0);
+    append_unknown(stream, 1);
+    append_heartbeat(stream, 2);
+    append_unknown(stream, 3);
+    append_unknown(stream, 4);
+    append_heartbeat(stream, 5);
+    append_unknown(stream, 6);
+    expect(stream, 3, 4, "unknown frames between good ones");
+
+    // a corrupted frame, then heartbeats: nothing in it is taken for a
+    // frame, and unknown messages pass again once a heartbeat is checked
+    stream.clear();
+    append_heartbeat(stream, 0);
+    append_corrupted_attitude(stream);
+    for (uint8_t seq = 1; seq <= 10; seq++) {
+        append_heartbeat(stream, seq);
+    }
+    append_unknown(stream, 11);
+    append_heartbeat(stream, 12);
+    expect(stream, 12, 1, "heartbeats after a corrupted frame");
+
+    // an unknown message straight after a corrupted one is not trusted
+    stream.clear();
+    append_corrupted_attitude(stream);
+    append_unknown(stream, 0);
+    append_heartbeat(stream, 1);
+    expect(stream, 1, 0, "unknown frame after a corrupted one");
+
+    // nor after bytes that are not a frame
+    stream.clear();
+    stream.push_back(0x55);
+    append_unknown(stream, 0);
+    append_heartbeat(stream, 1);
+    append_unknown(stream, 2);
+    expect(stream, 1, 1, "unknown frame after noise");
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file server_priority_test.cpp
+ * @brief mavlink::Server with a TCP client that is not reading: a command
+ * from the vehicle has to overtake the telemetry queued for it
+ */
+
+#include "server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdio>
+#include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t BACKLOG = 200 * 1024;   // telemetry queued before the command, under queue_limit
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/*
+  vehicle link without a descriptor, fed by the test
+ */
+class FakeVehicle : public mavlink::Link {
+public:
+    ssize_t read(uint8_t *buf, size_t len) override
+    {
+        const size_t n = pending.size() < len ? pending.size() : len;
+        std::copy(pending.begin(), pending.begin() + n, buf);
+        pending.erase(pending.begin(), pending.begin() + n);
+        return ssize_t(n);
+    }
+    bool write(const uint8_t *, size_t) override { return true; }
+    std::string name() const override { return "fake vehicle"; }
+
+    void send(mavlink_message_t &msg)
+    {
+        uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+        const uint16_t len = mavlink_msg_to_send_buffer(buf, &msg);
+        pending.insert(pending.end(), buf, buf + len);
+    }
+
+    std::vector<uint8_t> pending;
+};
+
+int connect_client(uint16_t port)
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    // a small window, so the kernel holds little of the backlog
+    int rcvbuf = 4096;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        std::perror("connect");
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+int main()
+{
+    // any free port
+    std::unique_ptr<mavlink::Server> server;
+    FakeVehicle *vehicle = nullptr;
+    uint16_t port = 0;
+    for (unsigned attempt = 0; attempt < 50 && !server; attempt++) {
+        mavlink::ServerConfig config;
+        config.tcp_port = uint16_t(20000 + (unsigned(::getpid()) * 7 + attempt * 101) % 40000);
+        config.udp_port = 0;
+        std::unique_ptr<FakeVehicle> link(new FakeVehicle());
+        FakeVehicle *raw = link.get();
+        server.reset(new mavlink::Server(std::move(link), config));
+        if (server->open()) {
+            vehicle = raw;
+            port = config.tcp_port;
+        } else {
+            server.reset();
+        }
+    }
+    if (!server) {
+        std::fprintf(stderr, "FAIL: no free port to listen on\n");
+        return 1;
+    }
+
+    const int client = connect_client(port);
+    if (client < 0) {
+        return 1;
+    }
+    for (int i = 0; i < 10 && server->stats().clients == 0; i++) {
+        server->run_once(10);
+    }
+    check(server->stats().clients == 1, "client accepted");
+
+    // a burst of telemetry the client does not read, queued in one go
+    mavlink_message_t msg;
+    size_t queued = 0;
+    uint32_t attitudes = 0;
+    while (queued < BACKLOG) {
+        mavlink_msg_attitude_pack(1, 1, &msg, attitudes++, 0.1f, 0.2f, 0.3f, 0.01f, 0.02f, 0.03f);
+        queued += msg.len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+        vehicle->send(msg);
+    }
+    server->run_once(0);
+
+    // the client takes a little, which lets the server write again, then
+    // the vehicle acks a command
+    uint8_t buf[4096];
+    size_t taken = 0;
+    for (int round = 0; round < 100 && taken < sizeof(buf); round++) {
+        const ssize_t n = ::recv(client, buf + taken, sizeof(buf) - taken, MSG_DONTWAIT);
+        taken += n > 0 ? size_t(n) : 0;
+        server->run_once(1);
+    }
+    mavlink_msg_command_ack_pack(1, 1, &msg, MAV_CMD_COMPONENT_ARM_DISARM, MAV_RESULT_ACCEPTED, 0, 0, 255, 190);
+    vehicle->send(msg);
+    server->run_once(0);
+
+    // now read everything, count the telemetry that arrives ahead of the ack
+    mavlink::Parser parser;
+    uint32_t before_ack = 0, received = 0, next_time = 0;
+    bool ack_seen = false, in_order = true;
+    auto on_frame = [&](mavlink_frame_view_t &view) {
+        if (view.msgid == MAVLINK_MSG_ID_COMMAND_ACK) {
+            ack_seen = true;
+        } else if (view.msgid == MAVLINK_MSG_ID_ATTITUDE) {
+            mavlink_message_t attitude;
+            mavlink_frame_view_to_message(&view, &attitude);
+            in_order &= mavlink_msg_attitude_get_time_boot_ms(&attitude) == next_time++;
+            received++;
+            before_ack += ack_seen ? 0 : 1;
+        }
+    };
+    parser.parse(buf, uint32_t(taken), on_frame);
+    for (int round = 0; round < 10000 && received < attitudes; round++) {
+        const ssize_t n = ::recv(client, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            parser.parse(buf, uint32_t(n), on_frame);
+        }
+        server->run_once(n > 0 ? 0 : 1);
+    }
+    ::close(client);
+
+    const size_t frame_len = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_ATTITUDE_LEN;
+    std::printf("%u telemetry frames (%zu bytes) queued, %u arrived ahead of the ack (%zu bytes), %llu dropped\n",
+                attitudes, queued, before_ack, size_t(before_ack) * frame_len,
+                (unsigned long long)server->stats().dropped_bulk);
+    check(server->stats().dropped_bulk == 0, "backlog under queue_limit, nothing dropped");
+    check(ack_seen, "ack arrives");
+    check(received == attitudes && in_order && parser.take_rejected() == 0, "all telemetry arrives intact, in order");
+    // a slice of telemetry and what the sockets buffer, not the whole backlog
+    check(size_t(before_ack) * frame_len < BACKLOG / 2, "ack not held behind the queued telemetry");
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+/**
+ * @file signature_batch_test.cpp
+ * @brief SignatureVerifier with each SHA-256 implementation against
+ * _mav_signature_check_parts() frame by frame, on signed frames of every
+ * length mixed with bad signatures, replays, stale streams and unsigned
+ * frames, with the signing stream list and the stream table
+ *
+ * Usage: signature_batch_test [frames]
+ */
+
+#include "signature_batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using mavlink::Sha256Impl;
+using mavlink::SignatureVerifier;
+
+constexpr unsigned SENDERS = 24;   // more streams than MAVLINK_MAX_SIGNING_STREAMS
+constexpr uint64_t START = 1000000000ULL;
+constexpr size_t TABLE_SLOTS = 64;
+
+int failures = 0;
+
+const uint8_t KEY[32] = {0x4d, 0x41, 0x56, 0x4c, 0x69, 0x6e, 0x6b, 0x20, 0x73, 0x69, 0x67, 0x6e,
+                         0x69, 0x6e, 0x67, 0x20, 0x74, 0x65, 0x73, 0x74, 0x20, 0x6b, 0x65, 0x79,
+                         0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+
+using Frame = std::vector<uint8_t>;
+
+/*
+  a MAVLink 2 frame with a random payload of len bytes, signed by signing
+  if it is not null
+ */
+Frame make_frame(std::mt19937 &rng, uint8_t len, uint8_t sysid, uint8_t compid, mavlink_signing_t *signing)
+{
+    Frame f(MAVLINK_NUM_HEADER_BYTES + len + MAVLINK_NUM_CHECKSUM_BYTES);
+    const uint32_t msgid = rng() % 1000;
+    const uint8_t header[MAVLINK_NUM_HEADER_BYTES] = {
+        MAVLINK_STX, len, uint8_t(signing != nullptr ? MAVLINK_IFLAG_SIGNED : 0), 0, uint8_t(rng()), sysid, compid,
+        uint8_t(msgid), uint8_t(msgid >> 8), uint8_t(msgid >> 16)};
+    std::memcpy(f.data(), header, sizeof(header));
+    for (size_t i = MAVLINK_NUM_HEADER_BYTES; i < f.size(); i++) {
+        f[i] = uint8_t(rng());
+    }
+    if (signing != nullptr) {
+        uint8_t signature[MAVLINK_SIGNATURE_BLOCK_LEN];
+        const uint8_t *payload = &f[MAVLINK_NUM_HEADER_BYTES];
+        mavlink_sign_packet(signing, signature, f.data(), MAVLINK_NUM_HEADER_BYTES, payload, len, payload + len);
+        f.insert(f.end(), signature, signature + sizeof(signature));
+    }
+    return f;
+}
+
+Frame make_mavlink1(std::mt19937 &rng)
+{
+    const uint8_t len = uint8_t(rng());
+    Frame f(MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + len + MAVLINK_NUM_CHECKSUM_BYTES);
+    for (uint8_t &b : f) {
+        b = uint8_t(rng());
+    }
+    f[0] = MAVLINK_STX_MAVLINK1;
+    f[1] = len;
+    return f;
+}
+
+/*
+  signed frames from SENDERS streams, a few of them with timestamps too old
+  for a new stream, mixed with the frames verify() has to turn down
+ */
+std::vector<Frame> make_frames(size_t count)
+{
+    std::mt19937 rng(9);
+    std::vector<mavlink_signing_t> senders(SENDERS);
+    for (unsigned s = 0; s < SENDERS; s++) {
+        mavlink_signing_t &signing = senders[s];
+        std::memset(&signing, 0, sizeof(signing));
+        signing.flags = MAVLINK_SIGNING_FLAG_SIGN_OUTGOING;
+        signing.link_id = uint8_t(s % 3);
+        std::memcpy(signing.secret_key, KEY, sizeof(KEY));
+        signing.timestamp = s % 8 == 7 ? START - 2 * MAVLINK_SIGNING_TIMESTAMP_LIMIT * 100000ULL : START + s;
+    }
+
+    std::vector<Frame> frames;
+    std::vector<size_t> good;
+    for (size_t i = 0; i < count; i++) {
+        const unsigned kind = rng() % 100;
+        const unsigned s = rng() % SENDERS;
+        const uint8_t len = uint8_t(rng());
+        if (kind < 6) {
+            frames.push_back(make_frame(rng, len, uint8_t(1 + s / 2), uint8_t(1 + s % 2), nullptr));
+        } else if (kind < 9) {
+            frames.push_back(make_mavlink1(rng));
+        } else if (kind < 16 && !good.empty()) {
+            // replay of an earlier frame
+            frames.push_back(frames[good[rng() % good.size()]]);
+        } else {
+            Frame f = make_frame(rng, len, uint8_t(1 + s / 2), uint8_t(1 + s % 2), &senders[s]);
+            if (kind < 24) {
+                // anything but the magic, length and flags, up to the last byte of the signature
+                f[3 + rng() % (f.size() - 3)] ^= uint8_t(1 + rng() % 255);
+            } else {
+                good.push_back(frames.size());
+            }
+            frames.push_back(std::move(f));
+        }
+        // senders drift apart, so new streams show up with old timestamps
+        senders[rng() % SENDERS].timestamp += rng() % 50;
+    }
+    return frames;
+}
+
+/*
+  receiving side: signing state and streams, in the fixed list or a table
+ */
+struct Receiver {
+    explicit Receiver(bool table)
+    {
+        std::memset(&signing, 0, sizeof(signing));
+        std::memset(&streams, 0, sizeof(streams));
+        std::memcpy(signing.secret_key, KEY, sizeof(KEY));
+        signing.timestamp = START;
+        if (table) {
+            std::memset(&stream_table, 0, sizeof(stream_table));
+            mavlink_signing_stream_table_init(&stream_table, slots, TABLE_SLOTS);
+            streams.table = &stream_table;
+        }
+    }
+    Receiver(const Receiver &) = delete;
+    Receiver &operator=(const Receiver &) = delete;
+
+    bool same_state(const Receiver &o) const
+    {
+        if (signing.timestamp != o.signing.timestamp || signing.last_status != o.signing.last_status) {
+            return false;
+        }
+        if (streams.table != nullptr) {
+            return stream_table.count == o.stream_table.count && stream_table.evicted == o.stream_table.evicted &&
+                   std::memcmp(slots, o.slots, sizeof(slots)) == 0;
+        }
+        return streams.num_signing_streams == o.streams.num_signing_streams &&
+               std::memcmp(streams.stream, o.streams.stream, sizeof(streams.stream)) == 0;
+    }
+
+    mavlink_signing_t signing;
+    mavlink_signing_streams_t streams;
+    mavlink_signing_stream_table_t stream_table;
+    mavlink_signing_stream_slot_t slots[TABLE_SLOTS];
+};
+
+bool check_reference(Receiver &r, const Frame &f)
+{
+    if (f[0] != MAVLINK_STX || !(f[2] & MAVLINK_IFLAG_SIGNED)) {
+        return false;
+    }
+    const uint8_t *payload = &f[MAVLINK_NUM_HEADER_BYTES];
+    return _mav_signature_check_parts(&r.signing, &r.streams, f.data(), payload, f[1], payload + f[1],
+                                      payload + f[1] + MAVLINK_NUM_CHECKSUM_BYTES);
+}
+
+/*
+  verify() in calls of 1..40 frames, so batches are split and partly
+  filled, against the reference after every call
+ */
+void run(const SignatureVerifier &verifier, const std::vector<Frame> &frames, bool table)
+{
+    const char *name = SignatureVerifier::impl_name(verifier.impl());
+    const char *streams = table ? "stream table" : "stream list";
+    Receiver got(table), want(table);
+    std::mt19937 rng(3);
+    std::vector<const uint8_t *> ptrs(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        ptrs[i] = frames[i].data();
+    }
+    size_t passed = 0;
+
+    for (size_t base = 0; base < frames.size();) {
+        const size_t n = std::min<size_t>(1 + rng() % 40, frames.size() - base);
+        bool results[64];
+        const size_t good = verifier.verify(got.signing, got.streams, &ptrs[base], n, results);
+        size_t want_good = 0;
+        for (size_t i = 0; i < n; i++) {
+            const bool want_ok = check_reference(want, frames[base + i]);
+            want_good += want_ok ? 1 : 0;
+            if (results[i] != want_ok) {
+                std::fprintf(stderr, "FAIL: %s, %s: frame %zu (len %u) %s, expected %s\n", name, streams, base + i,
+                             frames[base + i][1], results[i] ? "passed" : "failed", want_ok ? "pass" : "fail");
+                failures++;
+                return;
+            }
+        }
+        if (good != want_good || !got.same_state(want)) {
+            std::fprintf(stderr, "FAIL: %s, %s: signing state differs after frames %zu..%zu\n", name, streams, base,
+                         base + n - 1);
+            failures++;
+            return;
+        }
+        passed += good;
+        base += n;
+    }
+
+    // the whole run again in full batches, for the throughput
+    Receiver timed(table);
+    bool results[SignatureVerifier::max_batch];
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t base = 0; base < frames.size(); base += SignatureVerifier::max_batch) {
+        verifier.verify(timed.signing, timed.streams, &ptrs[base],
+                        std::min(SignatureVerifier::max_batch, frames.size() - base), results);
+    }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-7s %-12s %zu frames, %zu passed, %.2f Mframes/s\n", name, streams, frames.size(), passed,
+                frames.size() / s / 1e6);
+    if (!timed.same_state(want)) {
+        std::fprintf(stderr, "FAIL: %s, %s: signing state differs after full batches\n", name, streams);
+        failures++;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t count = argc > 1 ? size_t(std::atol(argv[1])) : 20000;
+    const std::vector<Frame> frames = make_frames(count);
+
+    for (Sha256Impl impl : {Sha256Impl::scalar, Sha256Impl::avx2, Sha256Impl::sha_ni}) {
+        const SignatureVerifier verifier(impl);
+        if (verifier.impl() != impl) {
+            std::printf("%s not supported here, skipped\n", SignatureVerifier::impl_name(impl));
+            continue;
+        }
+        run(verifier, frames, false);
+        run(verifier, frames, true);
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}